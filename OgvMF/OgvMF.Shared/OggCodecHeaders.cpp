@@ -0,0 +1,79 @@
+#include "pch.h"
+
+#include "OggCodecHeaders.h"
+
+#include <cstring>
+
+static uint32_t ReadBE16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+static uint32_t ReadBE24(const uint8_t *p) { return (p[0] << 16) | (p[1] << 8) | p[2]; }
+static uint32_t ReadBE32(const uint8_t *p) { return (static_cast<uint32_t>(p[0]) << 24) | ReadBE24(p + 1); }
+static uint32_t ReadLE32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+
+OgvStreamType OgvIdentifyStream(const uint8_t *packet, size_t length)
+{
+	if (length >= 7 && memcmp(packet, "\x80theora", 7) == 0)
+	{
+		return OGV_STREAM_THEORA;
+	}
+	if (length >= 7 && memcmp(packet, "\x01vorbis", 7) == 0)
+	{
+		return OGV_STREAM_VORBIS;
+	}
+	if (length >= 8 && memcmp(packet, "fishead\0", 8) == 0)
+	{
+		return OGV_STREAM_SKELETON;
+	}
+	return OGV_STREAM_UNKNOWN;
+}
+
+bool OgvParseTheoraIdent(const uint8_t *packet, size_t length, OgvTheoraInfo &info)
+{
+	if (length < 42 || OgvIdentifyStream(packet, length) != OGV_STREAM_THEORA)
+	{
+		return false;
+	}
+	// Only the 3.2 bitstream exists.
+	if (packet[7] != 3 || packet[8] != 2)
+	{
+		return false;
+	}
+
+	info.versionRevision = packet[9];
+	info.frameWidth = ReadBE16(packet + 10) << 4;
+	info.frameHeight = ReadBE16(packet + 12) << 4;
+	info.pictureWidth = ReadBE24(packet + 14);
+	info.pictureHeight = ReadBE24(packet + 17);
+	info.pictureX = packet[20];
+	// Stored from the bottom of the frame; flip to the usual top-left origin.
+	info.pictureY = info.frameHeight - info.pictureHeight - packet[21];
+	info.fpsNumerator = ReadBE32(packet + 22);
+	info.fpsDenominator = ReadBE32(packet + 26);
+
+	// QUAL(6) KFGSHIFT(5) PF(2) reserved(3)
+	uint32_t bits = ReadBE16(packet + 40);
+	info.keyframeShift = static_cast<uint8_t>((bits >> 5) & 0x1f);
+	info.pixelFormat = static_cast<uint8_t>((bits >> 3) & 0x03);
+
+	return info.fpsNumerator != 0 && info.fpsDenominator != 0 &&
+		info.pictureWidth <= info.frameWidth && info.pictureHeight <= info.frameHeight;
+}
+
+bool OgvParseVorbisIdent(const uint8_t *packet, size_t length, OgvVorbisInfo &info)
+{
+	if (length < 30 || OgvIdentifyStream(packet, length) != OGV_STREAM_VORBIS)
+	{
+		return false;
+	}
+	if (ReadLE32(packet + 7) != 0)
+	{
+		return false;
+	}
+
+	info.channels = packet[11];
+	info.sampleRate = ReadLE32(packet + 12);
+	info.bitrateNominal = ReadLE32(packet + 20);
+	info.blocksizeShort = static_cast<uint16_t>(1 << (packet[28] & 0x0f));
+	info.blocksizeLong = static_cast<uint16_t>(1 << (packet[28] >> 4));
+
+	return info.channels != 0 && info.sampleRate != 0 && (packet[29] & 1) != 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+enum OgvStreamType {
+	OGV_STREAM_UNKNOWN,
+	OGV_STREAM_VORBIS,
+	OGV_STREAM_THEORA,
+	OGV_STREAM_SKELETON
+};
+
+// Fields of the Theora identification header that the source needs.
+struct OgvTheoraInfo
+{
+	uint8_t versionRevision;
+	uint32_t frameWidth;
+	uint32_t frameHeight;
+	uint32_t pictureWidth;
+	uint32_t pictureHeight;
+	uint32_t pictureX;
+	uint32_t pictureY;
+	uint32_t fpsNumerator;
+	uint32_t fpsDenominator;
+	uint8_t pixelFormat;	// 0 = 4:2:0, 2 = 4:2:2, 3 = 4:4:4
+	uint8_t keyframeShift;
+};
+
+// Fields of the Vorbis identification header that the source needs.
+struct OgvVorbisInfo
+{
+	uint8_t channels;
+	uint32_t sampleRate;
+	uint32_t bitrateNominal;
+	uint16_t blocksizeShort;
+	uint16_t blocksizeLong;
+};
+
+// Works out which codec a stream carries from its first packet.
+OgvStreamType OgvIdentifyStream(const uint8_t *packet, size_t length);
+
+bool OgvParseTheoraIdent(const uint8_t *packet, size_t length, OgvTheoraInfo &info);
+bool OgvParseVorbisIdent(const uint8_t *packet, size_t length, OgvVorbisInfo &info);
+
+// Header packets: Theora sets the top bit of the first byte, Vorbis uses odd packet types.
+inline bool OgvIsTheoraHeader(const uint8_t *packet, size_t length) { return length > 0 && (packet[0] & 0x80) != 0; }
+inline bool OgvIsVorbisHeader(const uint8_t *packet, size_t length) { return length > 0 && (packet[0] & 0x01) != 0; }
+
+// Theora granule positions pack the frame number of the last keyframe in the
+// high bits and the number of frames since it in the low bits.
+inline int64_t OgvTheoraKeyframeGranule(const OgvTheoraInfo &info, int64_t granulepos)
+{
+	return granulepos >> info.keyframeShift;
+}
+
+inline int64_t OgvTheoraFrameCount(const OgvTheoraInfo &info, int64_t granulepos)
+{
+	int64_t mask = (static_cast<int64_t>(1) << info.keyframeShift) - 1;
+	return (granulepos >> info.keyframeShift) + (granulepos & mask);
+}
+
+// Zero-based index of the frame a granulepos refers to. Streams from 3.2.1
+// onwards count frames from one.
+inline int64_t OgvTheoraFrameIndex(const OgvTheoraInfo &info, int64_t granulepos)
+{
+	return OgvTheoraFrameCount(info, granulepos) - (info.versionRevision >= 1 ? 1 : 0);
+}
+
+// Presentation time in seconds of the frame a granulepos refers to.
+inline double OgvTheoraGranuleTime(const OgvTheoraInfo &info, int64_t granulepos)
+{
+	if (info.fpsNumerator == 0)
+	{
+		return 0.0;
+	}
+	return static_cast<double>(OgvTheoraFrameIndex(info, granulepos)) * info.fpsDenominator / info.fpsNumerator;
+}
+
+// End time in seconds of the audio a Vorbis granulepos refers to.
+inline double OgvVorbisGranuleTime(const OgvVorbisInfo &info, int64_t granulepos)
+{
+	if (info.sampleRate == 0)
+	{
+		return 0.0;
+	}
+	return static_cast<double>(granulepos) / info.sampleRate;
+}
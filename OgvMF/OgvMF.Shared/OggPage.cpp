@@ -0,0 +1,602 @@
+#include "pch.h"
+
+#include "OggPage.h"
+
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define OGG_PAGE_X86 1
+#include <immintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(_M_ARM) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OGG_PAGE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC and clang only emit code for optional instruction sets in functions
+// that ask for it.
+#if defined(__GNUC__)
+#define OGG_TARGET_CLMUL __attribute__((target("pclmul,ssse3")))
+#define OGG_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define OGG_TARGET_CLMUL
+#define OGG_TARGET_AVX2
+#endif
+
+static const uint8_t OggCapture[4] = { 'O', 'g', 'g', 'S' };
+
+OggParseResult OggParsePageHeader(const uint8_t *data, size_t length, OggPageHeader &header)
+{
+	if (length < OggPageMinHeaderSize)
+	{
+		return OGG_PAGE_NEED_MORE;
+	}
+	if (memcmp(data, OggCapture, 4) != 0 || data[4] != 0)
+	{
+		return OGG_PAGE_INVALID;
+	}
+
+	header.flags = data[5];
+	header.granulepos = static_cast<int64_t>(OggReadLE64(data + 6));
+	header.serialno = OggReadLE32(data + 14);
+	header.sequence = OggReadLE32(data + 18);
+	header.checksum = OggReadLE32(data + 22);
+	header.segments = data[26];
+	header.headerSize = OggPageMinHeaderSize + header.segments;
+
+	if (length < header.headerSize)
+	{
+		return OGG_PAGE_NEED_MORE;
+	}
+
+	header.lacing = data + OggPageMinHeaderSize;
+	header.bodySize = 0;
+	for (int i = 0; i < header.segments; i++)
+	{
+		header.bodySize += header.lacing[i];
+	}
+	return OGG_PAGE_OK;
+}
+
+// Table-driven CRC, eight bytes per step: s_crcTable[k][b] is the CRC of
+// byte b followed by k zero bytes, so the eight lookups for a word can be
+// done independently and XORed together.
+static uint32_t s_crcTable[8][256];
+
+static bool InitCrcTable()
+{
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t r = i << 24;
+		for (int bit = 0; bit < 8; bit++)
+		{
+			r = (r & 0x80000000) ? (r << 1) ^ 0x04c11db7 : (r << 1);
+		}
+		s_crcTable[0][i] = r;
+	}
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		for (int k = 1; k < 8; k++)
+		{
+			uint32_t prev = s_crcTable[k - 1][i];
+			s_crcTable[k][i] = (prev << 8) ^ s_crcTable[0][prev >> 24];
+		}
+	}
+	return true;
+}
+
+// Built at load time; function-local statics aren't thread-safe on every compiler we use.
+static const bool s_crcTableReady = InitCrcTable();
+
+static uint32_t CrcBytewise(uint32_t crc, const uint8_t *data, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		crc = (crc << 8) ^ s_crcTable[0][(crc >> 24) ^ data[i]];
+	}
+	return crc;
+}
+
+static uint32_t CrcSlicing8(uint32_t crc, const uint8_t *data, size_t length)
+{
+	while (length >= 8)
+	{
+		// The CRC is most significant bit first, so it lines up with the
+		// first four bytes read big-endian.
+		uint32_t hi = crc ^ ((static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+			(static_cast<uint32_t>(data[2]) << 8) | data[3]);
+		crc = s_crcTable[7][hi >> 24] ^ s_crcTable[6][(hi >> 16) & 0xff] ^
+			s_crcTable[5][(hi >> 8) & 0xff] ^ s_crcTable[4][hi & 0xff] ^
+			s_crcTable[3][data[4]] ^ s_crcTable[2][data[5]] ^
+			s_crcTable[1][data[6]] ^ s_crcTable[0][data[7]];
+		data += 8;
+		length -= 8;
+	}
+	return CrcBytewise(crc, data, length);
+}
+
+#ifdef OGG_PAGE_X86
+static bool CpuHasClmul()
+{
+	int info[4];
+#ifdef _MSC_VER
+	__cpuid(info, 1);
+#else
+	unsigned int a, b, c, d;
+	if (!__get_cpuid(1, &a, &b, &c, &d))
+	{
+		return false;
+	}
+	info[2] = static_cast<int>(c);
+#endif
+	const int ssse3 = 1 << 9, pclmulqdq = 1 << 1;
+	return (info[2] & (ssse3 | pclmulqdq)) == (ssse3 | pclmulqdq);
+}
+
+static bool CpuHasAVX2()
+{
+	int info[4];
+#ifdef _MSC_VER
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+	__cpuid(info, 1);
+#else
+	unsigned int a, b, c, d;
+	if (!__get_cpuid(1, &a, &b, &c, &d))
+	{
+		return false;
+	}
+	info[2] = static_cast<int>(c);
+#endif
+	// The OS must save the YMM registers across context switches.
+	const int osxsave = 1 << 27, avx = 1 << 28;
+	if ((info[2] & (osxsave | avx)) != (osxsave | avx))
+	{
+		return false;
+	}
+#ifdef _MSC_VER
+	if ((_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	unsigned int xcr0Lo, xcr0Hi;
+	__asm__("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+	if ((xcr0Lo & 6) != 6)
+	{
+		return false;
+	}
+	if (!__get_cpuid_count(7, 0, &a, &b, &c, &d))
+	{
+		return false;
+	}
+	return (b & (1 << 5)) != 0;
+#endif
+}
+
+// Probed once at startup; function-local statics aren't thread-safe on
+// every compiler we use.
+static const bool s_cpuHasClmul = CpuHasClmul();
+static const bool s_cpuHasAVX2 = CpuHasAVX2();
+
+// x^n mod P, for the folding constants.
+static uint32_t CrcPowerOfX(int n)
+{
+	uint32_t r = 1;
+	for (int i = 0; i < n; i++)
+	{
+		r = (r & 0x80000000) ? (r << 1) ^ 0x04c11db7 : (r << 1);
+	}
+	return r;
+}
+
+static const uint32_t s_foldHigh = CrcPowerOfX(192);
+static const uint32_t s_foldLow = CrcPowerOfX(128);
+
+// Carry-less multiply folding, 16 bytes per step. The running remainder is
+// kept as a 128-bit polynomial congruent to the message so far; each step
+// multiplies it by x^128 through the folding constants and adds the next
+// block. Its CRC is the message's, so the table finishes it off.
+OGG_TARGET_CLMUL static uint32_t CrcClmul(uint32_t crc, const uint8_t *data, size_t length)
+{
+	if (length < 32)
+	{
+		return CrcSlicing8(crc, data, length);
+	}
+
+	// Loads are byte-reversed so the first byte holds the top coefficients.
+	const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i fold = _mm_set_epi32(0, static_cast<int>(s_foldHigh), 0, static_cast<int>(s_foldLow));
+
+	__m128i x = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), reverse);
+	x = _mm_xor_si128(x, _mm_set_epi32(static_cast<int>(crc), 0, 0, 0));
+	data += 16;
+	length -= 16;
+
+	while (length >= 16)
+	{
+		__m128i block = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), reverse);
+		__m128i high = _mm_clmulepi64_si128(x, fold, 0x11);
+		__m128i low = _mm_clmulepi64_si128(x, fold, 0x00);
+		x = _mm_xor_si128(_mm_xor_si128(high, low), block);
+		data += 16;
+		length -= 16;
+	}
+
+	uint8_t folded[16];
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(folded), _mm_shuffle_epi8(x, reverse));
+	crc = CrcSlicing8(0, folded, sizeof(folded));
+	return CrcSlicing8(crc, data, length);
+}
+#endif
+
+bool OggCrcKernelSupported(OggCrcKernel kernel)
+{
+	switch (kernel)
+	{
+	case OGG_CRC_AUTO:
+	case OGG_CRC_BYTEWISE:
+	case OGG_CRC_SLICING8:
+		return true;
+#ifdef OGG_PAGE_X86
+	case OGG_CRC_CLMUL_X86:
+		return s_cpuHasClmul;
+#endif
+	default:
+		return false;
+	}
+}
+
+uint32_t OggCrcUpdate(uint32_t crc, const uint8_t *data, size_t length, OggCrcKernel kernel)
+{
+	if (kernel == OGG_CRC_AUTO)
+	{
+#ifdef OGG_PAGE_X86
+		kernel = s_cpuHasClmul ? OGG_CRC_CLMUL_X86 : OGG_CRC_SLICING8;
+#else
+		kernel = OGG_CRC_SLICING8;
+#endif
+	}
+
+	switch (kernel)
+	{
+	case OGG_CRC_BYTEWISE:
+		return CrcBytewise(crc, data, length);
+#ifdef OGG_PAGE_X86
+	case OGG_CRC_CLMUL_X86:
+		if (s_cpuHasClmul)
+		{
+			return CrcClmul(crc, data, length);
+		}
+		break;
+#endif
+	default:
+		break;
+	}
+	return CrcSlicing8(crc, data, length);
+}
+
+uint32_t OggPageChecksum(const uint8_t *page, size_t length)
+{
+	static const uint8_t zeros[4] = { 0, 0, 0, 0 };
+
+	uint32_t crc = OggCrcUpdate(0, page, 22);
+	crc = OggCrcUpdate(crc, zeros, 4);
+	return OggCrcUpdate(crc, page + 26, length - 26);
+}
+
+bool OggVerifyPage(const uint8_t *page, const OggPageHeader &header)
+{
+	return OggPageChecksum(page, header.PageSize()) == header.checksum;
+}
+
+bool OggPagePlausible(const uint8_t *data, size_t available, const OggPageHeader &header)
+{
+	if ((header.flags & ~(OGG_PAGE_CONTINUED | OGG_PAGE_BOS | OGG_PAGE_EOS)) != 0)
+	{
+		return false;
+	}
+	size_t size = header.PageSize();
+	if (available >= size + 4 && memcmp(data + size, OggCapture, 4) != 0)
+	{
+		return false;
+	}
+	return true;
+}
+
+// The scanners return the offset of the first capture pattern that starts
+// at or after data and fits within length, or length if there is none.
+
+static size_t FindCaptureScalar(const uint8_t *data, size_t length)
+{
+	const uint8_t *p = data;
+	const uint8_t *end = data + length;
+	while (end - p >= 4)
+	{
+		// memchr is vectorized in most C runtimes, which helps even here.
+		p = static_cast<const uint8_t *>(memchr(p, 'O', (end - p) - 3));
+		if (p == nullptr)
+		{
+			break;
+		}
+		if (p[1] == 'g' && p[2] == 'g' && p[3] == 'S')
+		{
+			return p - data;
+		}
+		p++;
+	}
+	return length;
+}
+
+#ifdef OGG_PAGE_X86
+static inline int LowestBit(uint32_t mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// Matches the first and last bytes of the pattern across a block at once,
+// which leaves very few candidates in compressed data, then checks the
+// middle two of each. Blocks read three bytes past their end, hence the
+// loop bounds.
+static inline bool MiddleMatches(const uint8_t *p)
+{
+	return p[1] == 'g' && p[2] == 'g';
+}
+
+static size_t FindCaptureSSE2(const uint8_t *data, size_t length)
+{
+	const __m128i o = _mm_set1_epi8('O');
+	const __m128i s = _mm_set1_epi8('S');
+
+	size_t i = 0;
+	for (; i + 16 + 3 <= length; i += 16)
+	{
+		__m128i first = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)), o);
+		__m128i last = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 3)), s);
+		uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(first, last)));
+		while (mask != 0)
+		{
+			int bit = LowestBit(mask);
+			if (MiddleMatches(data + i + bit))
+			{
+				return i + bit;
+			}
+			mask &= mask - 1;
+		}
+	}
+	return i + FindCaptureScalar(data + i, length - i);
+}
+
+OGG_TARGET_AVX2 static size_t FindCaptureAVX2(const uint8_t *data, size_t length)
+{
+	const __m256i o = _mm256_set1_epi8('O');
+	const __m256i s = _mm256_set1_epi8('S');
+
+	size_t i = 0;
+	for (; i + 32 + 3 <= length; i += 32)
+	{
+		__m256i first = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i)), o);
+		__m256i last = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 3)), s);
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(first, last)));
+		while (mask != 0)
+		{
+			int bit = LowestBit(mask);
+			if (MiddleMatches(data + i + bit))
+			{
+				return i + bit;
+			}
+			mask &= mask - 1;
+		}
+	}
+	return i + FindCaptureSSE2(data + i, length - i);
+}
+#endif
+
+#ifdef OGG_PAGE_NEON
+static size_t FindCaptureNEON(const uint8_t *data, size_t length)
+{
+	const uint8x16_t o = vdupq_n_u8('O');
+	const uint8x16_t s = vdupq_n_u8('S');
+
+	size_t i = 0;
+	for (; i + 16 + 3 <= length; i += 16)
+	{
+		uint8x16_t first = vceqq_u8(vld1q_u8(data + i), o);
+		uint8x16_t last = vceqq_u8(vld1q_u8(data + i + 3), s);
+		uint8x16_t m = vandq_u8(first, last);
+
+		// No movemask here; test for any candidate, then check the block the slow way.
+		uint8x8_t any = vorr_u8(vget_low_u8(m), vget_high_u8(m));
+		if (vget_lane_u64(vreinterpret_u64_u8(any), 0) != 0)
+		{
+			size_t found = FindCaptureScalar(data + i, 16 + 3);
+			if (found < 16)
+			{
+				return i + found;
+			}
+		}
+	}
+	return i + FindCaptureScalar(data + i, length - i);
+}
+#endif
+
+bool OggScanKernelSupported(OggScanKernel kernel)
+{
+	switch (kernel)
+	{
+	case OGG_SCAN_AUTO:
+	case OGG_SCAN_SCALAR:
+		return true;
+#ifdef OGG_PAGE_X86
+	case OGG_SCAN_SSE2:
+		return true;
+	case OGG_SCAN_AVX2:
+		return s_cpuHasAVX2;
+#endif
+#ifdef OGG_PAGE_NEON
+	case OGG_SCAN_NEON:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+size_t OggFindCapture(const uint8_t *data, size_t length, OggScanKernel kernel)
+{
+	if (length < 4)
+	{
+		return length;
+	}
+
+	if (kernel == OGG_SCAN_AUTO)
+	{
+#if defined(OGG_PAGE_X86)
+		kernel = s_cpuHasAVX2 ? OGG_SCAN_AVX2 : OGG_SCAN_SSE2;
+#elif defined(OGG_PAGE_NEON)
+		kernel = OGG_SCAN_NEON;
+#else
+		kernel = OGG_SCAN_SCALAR;
+#endif
+	}
+
+	switch (kernel)
+	{
+#ifdef OGG_PAGE_X86
+	case OGG_SCAN_SSE2:
+		return FindCaptureSSE2(data, length);
+	case OGG_SCAN_AVX2:
+		if (s_cpuHasAVX2)
+		{
+			return FindCaptureAVX2(data, length);
+		}
+		return FindCaptureSSE2(data, length);
+#endif
+#ifdef OGG_PAGE_NEON
+	case OGG_SCAN_NEON:
+		return FindCaptureNEON(data, length);
+#endif
+	default:
+		return FindCaptureScalar(data, length);
+	}
+}
+
+OggPacketAssembler::OggPacketAssembler() :
+	m_next(0),
+	m_havePartial(false),
+	m_expectedSequence(0),
+	m_haveSequence(false)
+{
+}
+
+void OggPacketAssembler::Reset()
+{
+	m_packets.clear();
+	m_next = 0;
+	m_partial.clear();
+	m_havePartial = false;
+	m_haveSequence = false;
+}
+
+void OggPacketAssembler::PushPage(const uint8_t *page, const OggPageHeader &header)
+{
+	// Compact the queue once everything handed out so far has been consumed.
+	if (m_next == m_packets.size())
+	{
+		m_packets.clear();
+		m_next = 0;
+	}
+
+	// A gap in the sequence means the partial packet can't be completed.
+	if (m_haveSequence && header.sequence != m_expectedSequence)
+	{
+		m_partial.clear();
+		m_havePartial = false;
+	}
+	m_expectedSequence = header.sequence + 1;
+	m_haveSequence = true;
+
+	// Likewise a fresh page while a packet is still open.
+	if (!header.IsContinued())
+	{
+		m_partial.clear();
+		m_havePartial = false;
+	}
+
+	const uint8_t *body = page + header.headerSize;
+	bool skipping = header.IsContinued() && !m_havePartial;
+	bool first = true;
+	int lastComplete = -1;
+
+	for (int i = 0; i < header.segments; i++)
+	{
+		if (header.lacing[i] < 255)
+		{
+			lastComplete = i;
+		}
+	}
+
+	size_t start = 0;
+	size_t pos = 0;
+	for (int i = 0; i < header.segments; i++)
+	{
+		pos += header.lacing[i];
+		if (header.lacing[i] == 255 && i + 1 < header.segments)
+		{
+			continue;
+		}
+
+		bool complete = header.lacing[i] < 255;
+		if (skipping)
+		{
+			// Tail of a packet whose beginning we never saw. If it runs on
+			// past this page, the next page's continuation is skipped too.
+			skipping = false;
+			m_havePartial = false;
+		}
+		else
+		{
+			m_partial.insert(m_partial.end(), body + start, body + pos);
+			if (complete)
+			{
+				OggPacket packet;
+				packet.data.swap(m_partial);
+				packet.granulepos = (i == lastComplete) ? header.granulepos : -1;
+				packet.bos = first && header.IsBOS();
+				packet.eos = (i == lastComplete) && header.IsEOS();
+				m_packets.push_back(std::move(packet));
+			}
+			m_havePartial = !complete;
+		}
+		first = false;
+		start = pos;
+	}
+}
+
+bool OggPacketAssembler::PopPacket(OggPacket &packet)
+{
+	if (m_next >= m_packets.size())
+	{
+		return false;
+	}
+	packet = std::move(m_packets[m_next++]);
+	return true;
+}
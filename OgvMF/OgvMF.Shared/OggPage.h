@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Minimal, allocation-free Ogg framing helpers. These work directly on byte
+// buffers so they can be shared by the seek index, the stream demuxer and
+// anything else that needs to look at pages without a full libogg setup.
+
+static const size_t OggPageMinHeaderSize = 27;
+static const size_t OggPageMaxSize = 65307;	// 27 + 255 + 255 * 255
+
+enum OggPageFlags
+{
+	OGG_PAGE_CONTINUED = 0x01,
+	OGG_PAGE_BOS = 0x02,
+	OGG_PAGE_EOS = 0x04
+};
+
+struct OggPageHeader
+{
+	uint8_t flags;
+	int64_t granulepos;		// -1 if no packet finishes on this page
+	uint32_t serialno;
+	uint32_t sequence;
+	uint32_t checksum;
+	uint8_t segments;
+	const uint8_t *lacing;	// points into the parsed buffer
+	size_t headerSize;
+	size_t bodySize;
+
+	size_t PageSize() const { return headerSize + bodySize; }
+	bool IsBOS() const { return (flags & OGG_PAGE_BOS) != 0; }
+	bool IsEOS() const { return (flags & OGG_PAGE_EOS) != 0; }
+	bool IsContinued() const { return (flags & OGG_PAGE_CONTINUED) != 0; }
+};
+
+enum OggParseResult
+{
+	OGG_PAGE_OK,
+	OGG_PAGE_NEED_MORE,		// buffer ends before the page does
+	OGG_PAGE_INVALID		// not a page, or a corrupt one
+};
+
+// Parses the page header at the start of data. The page body is not checked;
+// use OggVerifyPage for that once the whole page is in memory.
+OggParseResult OggParsePageHeader(const uint8_t *data, size_t length, OggPageHeader &header);
+
+// Ways of computing the Ogg CRC. Auto picks the fastest this CPU supports.
+enum OggCrcKernel
+{
+	OGG_CRC_AUTO,
+	OGG_CRC_BYTEWISE,		// one table lookup per byte
+	OGG_CRC_SLICING8,		// eight tables, eight bytes per step
+	OGG_CRC_CLMUL_X86		// PCLMULQDQ folding, 16 bytes per step
+};
+
+bool OggCrcKernelSupported(OggCrcKernel kernel);
+
+// Continues the Ogg CRC-32 (polynomial 0x04c11db7, no reflection, zero
+// initial value) over more data. Every kernel gives the same result.
+uint32_t OggCrcUpdate(uint32_t crc, const uint8_t *data, size_t length, OggCrcKernel kernel = OGG_CRC_AUTO);
+
+// Computes the Ogg CRC-32 of a page, treating its checksum field as zero.
+uint32_t OggPageChecksum(const uint8_t *page, size_t length);
+
+// Checks a fully buffered page against the checksum in its header.
+bool OggVerifyPage(const uint8_t *page, const OggPageHeader &header);
+
+// Cheap checks that rule out most false capture patterns found while
+// scanning, before paying for a CRC: no unknown flag bits, and if enough
+// is buffered to see it, another capture pattern straight after the page.
+// Not for pages reached by following on from a good one, as a valid page
+// next to damage would be rejected.
+bool OggPagePlausible(const uint8_t *data, size_t available, const OggPageHeader &header);
+
+// Ways of scanning for capture patterns. Auto picks the fastest this CPU supports.
+enum OggScanKernel
+{
+	OGG_SCAN_AUTO,
+	OGG_SCAN_SCALAR,
+	OGG_SCAN_SSE2,
+	OGG_SCAN_AVX2,
+	OGG_SCAN_NEON
+};
+
+bool OggScanKernelSupported(OggScanKernel kernel);
+
+// Returns the offset of the next "OggS" capture pattern at or after data,
+// or length if there is none.
+size_t OggFindCapture(const uint8_t *data, size_t length, OggScanKernel kernel = OGG_SCAN_AUTO);
+
+// Little-endian readers for header and packet fields.
+inline uint32_t OggReadLE32(const uint8_t *p)
+{
+	return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+		(static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline uint64_t OggReadLE64(const uint8_t *p)
+{
+	return static_cast<uint64_t>(OggReadLE32(p)) | (static_cast<uint64_t>(OggReadLE32(p + 4)) << 32);
+}
+
+struct OggPacket
+{
+	std::vector<uint8_t> data;
+	int64_t granulepos;		// granulepos of the page it ended on, if it was the last there; else -1
+	bool bos;
+	bool eos;
+};
+
+// Reassembles the packets of one logical stream from its pages, which must
+// be pushed in order. Packets continued across a gap are dropped.
+class OggPacketAssembler
+{
+public:
+	OggPacketAssembler();
+
+	void PushPage(const uint8_t *page, const OggPageHeader &header);
+	bool PopPacket(OggPacket &packet);
+	void Reset();
+
+	size_t GetQueuedPackets() const { return m_packets.size() - m_next; }
+
+private:
+	std::vector<OggPacket> m_packets;
+	size_t m_next;
+	std::vector<uint8_t> m_partial;
+	bool m_havePartial;
+	uint32_t m_expectedSequence;
+	bool m_haveSequence;
+};
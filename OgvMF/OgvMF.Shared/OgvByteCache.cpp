@@ -0,0 +1,214 @@
+#include "pch.h"
+
+#include "OgvByteCache.h"
+
+#include <cstring>
+
+OgvCachedByteSource::OgvCachedByteSource(const std::shared_ptr<OgvByteSource> &source, size_t maxBlocks, size_t readAheadBlocks) :
+	m_source(source),
+	m_length(source->GetLength()),
+	m_maxBlocks(std::max<size_t>(maxBlocks, readAheadBlocks + 1)),
+	m_readAheadBlocks(readAheadBlocks),
+	m_useClock(0),
+	m_stopping(false)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+	// Started last, once everything it touches is initialized.
+	m_thread = std::thread([this] { Run(); });
+}
+
+OgvCachedByteSource::~OgvCachedByteSource()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+		m_queue.clear();
+	}
+	m_wake.notify_one();
+	m_thread.join();
+}
+
+size_t OgvCachedByteSource::ReadAt(uint64_t offset, uint8_t *buffer, size_t length)
+{
+	if (offset >= m_length)
+	{
+		return 0;
+	}
+	if (length > m_length - offset)
+	{
+		length = static_cast<size_t>(m_length - offset);
+	}
+
+	size_t total = 0;
+	while (total < length)
+	{
+		uint64_t position = offset + total;
+		uint64_t index = position / BlockSize;
+		BlockData block = GetBlock(index);
+		size_t within = static_cast<size_t>(position - index * BlockSize);
+		if (block == nullptr || within >= block->size())
+		{
+			break;
+		}
+		size_t count = std::min(length - total, block->size() - within);
+		memcpy(buffer + total, block->data() + within, count);
+		total += count;
+	}
+
+	if (length > 0)
+	{
+		QueuePrefetch((offset + length - 1) / BlockSize + 1, m_readAheadBlocks);
+	}
+	return total;
+}
+
+void OgvCachedByteSource::Prefetch(uint64_t offset, size_t length)
+{
+	if (offset >= m_length || length == 0)
+	{
+		return;
+	}
+	uint64_t first = offset / BlockSize;
+	uint64_t last = (std::min<uint64_t>(offset + length, m_length) - 1) / BlockSize;
+	QueuePrefetch(first, last - first + 1);
+}
+
+OgvByteCacheStats OgvCachedByteSource::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+OgvCachedByteSource::BlockData OgvCachedByteSource::GetBlock(uint64_t index)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	auto found = m_blocks.find(index);
+	if (found != m_blocks.end() && found->second.data == nullptr)
+	{
+		// The read-ahead thread has it in hand; waiting beats fetching it twice.
+		m_stats.stalls++;
+		m_loaded.wait(lock, [this, index] {
+			auto block = m_blocks.find(index);
+			return block == m_blocks.end() || block->second.data != nullptr;
+		});
+		found = m_blocks.find(index);
+	}
+	else if (found != m_blocks.end())
+	{
+		m_stats.hits++;
+	}
+
+	if (found != m_blocks.end())
+	{
+		found->second.lastUse = ++m_useClock;
+		return found->second.data;
+	}
+
+	// Not cached, or the read-ahead fetch failed: fetch it here.
+	m_stats.misses++;
+	m_blocks[index].lastUse = ++m_useClock;
+	lock.unlock();
+
+	BlockData data = Fetch(index);
+	Store(index, data);
+	return data;
+}
+
+OgvCachedByteSource::BlockData OgvCachedByteSource::Fetch(uint64_t index)
+{
+	uint64_t offset = index * BlockSize;
+	size_t size = static_cast<size_t>(std::min<uint64_t>(BlockSize, m_length - offset));
+
+	std::shared_ptr<std::vector<uint8_t>> data = std::make_shared<std::vector<uint8_t>>(size);
+	if (m_source->ReadAt(offset, data->data(), size) != size)
+	{
+		return nullptr;
+	}
+	return data;
+}
+
+// Fills in a block marked as loading, or forgets it if the fetch failed,
+// and wakes anyone waiting on it.
+void OgvCachedByteSource::Store(uint64_t index, const BlockData &data)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (data == nullptr)
+		{
+			m_blocks.erase(index);
+		}
+		else
+		{
+			m_blocks[index].data = data;
+			m_stats.bytesFetched += data->size();
+		}
+
+		while (m_blocks.size() > m_maxBlocks)
+		{
+			auto oldest = m_blocks.end();
+			for (auto block = m_blocks.begin(); block != m_blocks.end(); ++block)
+			{
+				if (block->second.data != nullptr && (oldest == m_blocks.end() || block->second.lastUse < oldest->second.lastUse))
+				{
+					oldest = block;
+				}
+			}
+			if (oldest == m_blocks.end())
+			{
+				break;
+			}
+			m_blocks.erase(oldest);
+		}
+	}
+	m_loaded.notify_all();
+}
+
+void OgvCachedByteSource::QueuePrefetch(uint64_t first, uint64_t count)
+{
+	uint64_t blocks = (m_length + BlockSize - 1) / BlockSize;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.clear();
+		for (uint64_t index = first; index < first + count && index < blocks; index++)
+		{
+			if (m_blocks.find(index) == m_blocks.end())
+			{
+				m_queue.push_back(index);
+			}
+		}
+		if (m_queue.empty())
+		{
+			return;
+		}
+	}
+	m_wake.notify_one();
+}
+
+void OgvCachedByteSource::Run()
+{
+	for (;;)
+	{
+		uint64_t index;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+			if (m_stopping)
+			{
+				return;
+			}
+			index = m_queue.front();
+			m_queue.pop_front();
+
+			// A reader may have got to it first.
+			if (m_blocks.find(index) != m_blocks.end())
+			{
+				continue;
+			}
+			m_blocks[index].lastUse = ++m_useClock;
+			m_stats.prefetched++;
+		}
+
+		Store(index, Fetch(index));
+	}
+}
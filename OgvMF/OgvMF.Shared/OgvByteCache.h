@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "OgvByteSource.h"
+
+struct OgvByteCacheStats
+{
+	uint64_t hits;			// blocks found cached
+	uint64_t misses;		// blocks a reader had to fetch itself
+	uint64_t stalls;		// blocks a reader waited on the read-ahead thread for
+	uint64_t prefetched;	// blocks fetched by the read-ahead thread
+	uint64_t bytesFetched;
+};
+
+// Fronts a slow source with a cache of fixed-size blocks and a thread that
+// fetches ahead of the reader.
+//
+// Every read queues the blocks just past it for the read-ahead thread, so
+// a reader moving through the file finds its next blocks already there.
+// The queue is replaced rather than added to, so after a seek the thread
+// stops fetching around the old position. Least recently used blocks are
+// dropped once the cache is full.
+class OgvCachedByteSource : public OgvByteSource
+{
+public:
+	static const size_t BlockSize = 64 * 1024;
+
+	OgvCachedByteSource(const std::shared_ptr<OgvByteSource> &source, size_t maxBlocks, size_t readAheadBlocks);
+	virtual ~OgvCachedByteSource();
+
+	virtual uint64_t GetLength() const { return m_length; }
+	virtual size_t ReadAt(uint64_t offset, uint8_t *buffer, size_t length);
+	virtual void Prefetch(uint64_t offset, size_t length);
+
+	OgvByteCacheStats GetStats() const;
+
+private:
+	typedef std::shared_ptr<const std::vector<uint8_t>> BlockData;
+
+	struct Block
+	{
+		BlockData data;		// null while loading
+		uint64_t lastUse;
+	};
+
+	OgvCachedByteSource(const OgvCachedByteSource &);
+	OgvCachedByteSource &operator=(const OgvCachedByteSource &);
+
+	BlockData GetBlock(uint64_t index);
+	BlockData Fetch(uint64_t index);
+	void Store(uint64_t index, const BlockData &data);
+	void QueuePrefetch(uint64_t first, uint64_t count);
+	void Run();
+
+	std::shared_ptr<OgvByteSource> m_source;
+	uint64_t m_length;
+	size_t m_maxBlocks;
+	size_t m_readAheadBlocks;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_loaded;
+	std::condition_variable m_wake;
+	std::map<uint64_t, Block> m_blocks;
+	std::deque<uint64_t> m_queue;
+	uint64_t m_useClock;
+	bool m_stopping;
+	OgvByteCacheStats m_stats;
+
+	std::thread m_thread;
+};
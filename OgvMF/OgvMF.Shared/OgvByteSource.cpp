@@ -0,0 +1,251 @@
+#include "pch.h"
+
+#include "OgvByteSource.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+
+OgvReadFunc OgvByteSource::MakeReadFunc(const std::shared_ptr<OgvByteSource> &source)
+{
+	return [source](uint64_t offset, uint8_t *buffer, size_t length) {
+		return source->ReadAt(offset, buffer, length);
+	};
+}
+
+size_t OgvMemoryByteSource::ReadAt(uint64_t offset, uint8_t *buffer, size_t length)
+{
+	if (offset >= m_data.size())
+	{
+		return 0;
+	}
+	size_t count = std::min(length, static_cast<size_t>(m_data.size() - offset));
+	memcpy(buffer, m_data.data() + offset, count);
+	return count;
+}
+
+#ifdef _WIN32
+
+using namespace Windows::Foundation;
+using namespace Windows::Storage::Streams;
+using namespace Windows::Web::Http;
+
+OgvFileByteSource::OgvFileByteSource() :
+	m_file(INVALID_HANDLE_VALUE),
+	m_length(0)
+{
+}
+
+OgvFileByteSource::~OgvFileByteSource()
+{
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+	}
+}
+
+bool OgvFileByteSource::Open(const std::wstring &path)
+{
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	CREATEFILE2_EXTENDED_PARAMETERS params = {};
+	params.dwSize = sizeof(params);
+	params.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+	params.dwFileFlags = FILE_FLAG_SEQUENTIAL_SCAN;
+
+	m_file = CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, &params);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	FILE_STANDARD_INFO standard;
+	if (!GetFileInformationByHandleEx(m_file, FileStandardInfo, &standard, sizeof(standard)))
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+		return false;
+	}
+	m_length = static_cast<uint64_t>(standard.EndOfFile.QuadPart);
+	return true;
+}
+
+size_t OgvFileByteSource::ReadAt(uint64_t offset, uint8_t *buffer, size_t length)
+{
+	size_t total = 0;
+	while (total < length && offset + total < m_length)
+	{
+		// Reads carry their own offset, so they don't contend over the file pointer.
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = static_cast<DWORD>(offset + total);
+		overlapped.OffsetHigh = static_cast<DWORD>((offset + total) >> 32);
+
+		DWORD cbRead = 0;
+		DWORD cbWanted = static_cast<DWORD>(std::min<size_t>(length - total, MAXDWORD));
+		if (!ReadFile(m_file, buffer + total, cbWanted, &cbRead, &overlapped) || cbRead == 0)
+		{
+			break;
+		}
+		total += cbRead;
+	}
+	return total;
+}
+
+OgvMFByteSource::OgvMFByteSource() :
+	m_length(0)
+{
+}
+
+bool OgvMFByteSource::Open(IMFByteStream *pStream)
+{
+	QWORD length = 0;
+	if (FAILED(pStream->GetLength(&length)) || length == 0 || length == static_cast<QWORD>(-1))
+	{
+		return false;
+	}
+	m_spByteStream = pStream;
+	m_length = length;
+	return true;
+}
+
+size_t OgvMFByteSource::ReadAt(uint64_t offset, uint8_t *buffer, size_t length)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_spByteStream == nullptr || FAILED(m_spByteStream->SetCurrentPosition(offset)))
+	{
+		return 0;
+	}
+
+	size_t total = 0;
+	while (total < length)
+	{
+		ULONG cbRead = 0;
+		ULONG cbWanted = static_cast<ULONG>(std::min<size_t>(length - total, ULONG_MAX));
+		if (FAILED(m_spByteStream->Read(buffer + total, cbWanted, &cbRead)) || cbRead == 0)
+		{
+			break;
+		}
+		total += cbRead;
+	}
+	return total;
+}
+
+OgvHttpByteSource::OgvHttpByteSource() :
+	m_length(0)
+{
+}
+
+bool OgvHttpByteSource::IsHttpUrl(const std::wstring &url)
+{
+	return url.compare(0, 7, L"http://") == 0 || url.compare(0, 8, L"https://") == 0;
+}
+
+bool OgvHttpByteSource::Open(Uri ^uri)
+{
+	m_client = ref new HttpClient();
+	m_uri = uri;
+
+	try
+	{
+		HttpResponseMessage ^response = RequestRange(0, 1);
+		if (response == nullptr)
+		{
+			return false;
+		}
+		auto range = response->Content->Headers->ContentRange;
+		if (range == nullptr || range->Length == nullptr)
+		{
+			return false;
+		}
+		m_length = range->Length->Value;
+	}
+	catch (Exception ^)
+	{
+		return false;
+	}
+	return m_length > 0;
+}
+
+// Sends a GET for the given range, returning the response only if the
+// server answered with just that range.
+HttpResponseMessage ^OgvHttpByteSource::RequestRange(uint64_t offset, size_t length)
+{
+	std::wstring range = L"bytes=" + std::to_wstring(offset) + L"-" + std::to_wstring(offset + length - 1);
+
+	auto request = ref new HttpRequestMessage(HttpMethod::Get, m_uri);
+	request->Headers->Append(L"Range", ref new Platform::String(range.c_str()));
+
+	// Called from worker threads only, never the UI thread, so blocking is fine.
+	HttpResponseMessage ^response = concurrency::create_task(m_client->SendRequestAsync(request, HttpCompletionOption::ResponseHeadersRead)).get();
+	if (response->StatusCode != HttpStatusCode::PartialContent)
+	{
+		return nullptr;
+	}
+	return response;
+}
+
+size_t OgvHttpByteSource::ReadAt(uint64_t offset, uint8_t *buffer, size_t length)
+{
+	if (offset >= m_length || length == 0)
+	{
+		return 0;
+	}
+	if (length > m_length - offset)
+	{
+		length = static_cast<size_t>(m_length - offset);
+	}
+
+	// Connections drop and servers time out mid-file; a short read here
+	// would otherwise look to the demuxer like the end of the stream.
+	size_t total = 0;
+	int failures = 0;
+	while (total < length && failures < MaxAttempts)
+	{
+		size_t count = ReadRange(offset + total, buffer + total, length - total);
+		if (count == 0)
+		{
+			failures++;
+			if (failures < MaxAttempts)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(RetryDelayMs * failures));
+			}
+			continue;
+		}
+		total += count;
+		failures = 0;
+	}
+	return total;
+}
+
+// One range request, returning however much of the body arrived; zero on
+// any failure.
+size_t OgvHttpByteSource::ReadRange(uint64_t offset, uint8_t *buffer, size_t length)
+{
+	try
+	{
+		HttpResponseMessage ^response = RequestRange(offset, length);
+		if (response == nullptr)
+		{
+			return 0;
+		}
+		IBuffer ^body = concurrency::create_task(response->Content->ReadAsBufferAsync()).get();
+		size_t count = std::min(length, static_cast<size_t>(body->Length));
+		DataReader::FromBuffer(body)->ReadBytes(Platform::ArrayReference<uint8_t>(buffer, static_cast<unsigned int>(count)));
+		return count;
+	}
+	catch (Exception ^)
+	{
+		return 0;
+	}
+	catch (...)
+	{
+		// Task continuations can rethrow standard exceptions too.
+		return 0;
+	}
+}
+
+#endif
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "OgvSeekIndex.h"
+
+// Random access to the bytes of a media file, wherever they live.
+//
+// ReadAt blocks until the data is there and may be called from several
+// threads at once. Prefetch is a hint that a range will be wanted soon;
+// sources that can do something useful with it, like the block cache,
+// start fetching in the background.
+class OgvByteSource
+{
+public:
+	virtual ~OgvByteSource() {}
+
+	virtual uint64_t GetLength() const = 0;
+
+	// Reads up to length bytes at offset, returning the count read; fewer
+	// only at the end of the source or on error.
+	virtual size_t ReadAt(uint64_t offset, uint8_t *buffer, size_t length) = 0;
+
+	virtual void Prefetch(uint64_t, size_t) {}
+
+	// Adapts the source for the seek index and the demuxer. The function
+	// keeps the source alive.
+	static OgvReadFunc MakeReadFunc(const std::shared_ptr<OgvByteSource> &source);
+};
+
+// Bytes already in memory.
+class OgvMemoryByteSource : public OgvByteSource
+{
+public:
+	explicit OgvMemoryByteSource(std::vector<uint8_t> data) : m_data(std::move(data)) {}
+
+	virtual uint64_t GetLength() const { return m_data.size(); }
+	virtual size_t ReadAt(uint64_t offset, uint8_t *buffer, size_t length);
+
+private:
+	std::vector<uint8_t> m_data;
+};
+
+#ifdef _WIN32
+
+// A local file, read with positioned reads.
+class OgvFileByteSource : public OgvByteSource
+{
+public:
+	OgvFileByteSource();
+	virtual ~OgvFileByteSource();
+
+	bool Open(const std::wstring &path);
+
+	virtual uint64_t GetLength() const { return m_length; }
+	virtual size_t ReadAt(uint64_t offset, uint8_t *buffer, size_t length);
+
+private:
+	OgvFileByteSource(const OgvFileByteSource &);
+	OgvFileByteSource &operator=(const OgvFileByteSource &);
+
+	HANDLE m_file;
+	uint64_t m_length;
+};
+
+// The byte stream Media Foundation opened us with. Its reads go through a
+// shared position, so they are serialized here.
+class OgvMFByteSource : public OgvByteSource
+{
+public:
+	OgvMFByteSource();
+
+	// Fails for streams that can't say how long they are.
+	bool Open(IMFByteStream *pStream);
+
+	virtual uint64_t GetLength() const { return m_length; }
+	virtual size_t ReadAt(uint64_t offset, uint8_t *buffer, size_t length);
+
+private:
+	ComPtr<IMFByteStream> m_spByteStream;
+	uint64_t m_length;
+	std::mutex m_mutex;
+};
+
+// A file on a web server, fetched a range request at a time. The server
+// has to honor Range; one that sends the whole file instead is refused
+// rather than downloaded on every read. A failed or short response is
+// retried from where it left off a few times, backing off in between,
+// before the read gives up and comes back short.
+class OgvHttpByteSource : public OgvByteSource
+{
+public:
+	OgvHttpByteSource();
+
+	// Learns the length from a one-byte range request.
+	bool Open(Windows::Foundation::Uri ^uri);
+
+	virtual uint64_t GetLength() const { return m_length; }
+	virtual size_t ReadAt(uint64_t offset, uint8_t *buffer, size_t length);
+
+	static bool IsHttpUrl(const std::wstring &url);
+
+private:
+	static const int MaxAttempts = 4;
+	static const int RetryDelayMs = 250;
+
+	Windows::Web::Http::HttpResponseMessage ^RequestRange(uint64_t offset, size_t length);
+	size_t ReadRange(uint64_t offset, uint8_t *buffer, size_t length);
+
+	Windows::Web::Http::HttpClient ^m_client;
+	Windows::Foundation::Uri ^m_uri;
+	uint64_t m_length;
+};
+
+#endif
@@ -72,7 +72,7 @@ HRESULT OgvByteStreamHandler::BeginCreateObject(
 		// When it completes, the source will invoke our callback
 		// and then we will invoke the caller's callback.
 		ComPtr<OgvByteStreamHandler> spThis = this;
-		spSource->OpenAsync(pByteStream).then([this, spThis, spResult, spSource](concurrency::task<void>& openTask)
+		spSource->OpenAsync(pByteStream, pwszURL).then([this, spThis, spResult, spSource](concurrency::task<void>& openTask)
 		{
 			try
 			{
@@ -154,6 +154,13 @@ HRESULT OgvByteStreamHandler::CancelObjectCreation(IUnknown *pIUnknownCancelCook
 
 HRESULT OgvByteStreamHandler::GetMaxNumberOfBytesRequiredForResolution(QWORD* pqwBytes)
 {
-	return E_NOTIMPL;
+	if (pqwBytes == nullptr)
+	{
+		return E_POINTER;
+	}
+	// The first page says whether this is an Ogg stream at all;
+	// the rest of the headers aren't needed to turn a file away.
+	*pqwBytes = OggPageMaxSize;
+	return S_OK;
 }
 
@@ -0,0 +1,48 @@
+#include "pch.h"
+
+#include "OgvDeadlinePolicy.h"
+#include "OgvDemuxer.h"
+
+#include <cstring>
+
+OgvDeadlinePolicy::OgvDeadlinePolicy(OgvDemuxer &demuxer, int64_t skipThreshold) :
+	m_demuxer(demuxer),
+	m_skipThreshold(skipThreshold)
+{
+	ResetStats();
+}
+
+bool OgvDeadlinePolicy::FrameDemuxed(int64_t lateness, bool keyframe)
+{
+	if (lateness > m_skipThreshold && !keyframe)
+	{
+		m_stats.framesDropped++;
+		m_stats.keyframeSkips++;
+		m_demuxer.SkipToKeyframe();
+		return false;
+	}
+
+	if (lateness > 0)
+	{
+		m_stats.framesLate++;
+	}
+	else
+	{
+		m_stats.framesOnTime++;
+	}
+	return true;
+}
+
+OgvDeadlineStats OgvDeadlinePolicy::GetStats() const
+{
+	// Frames the demuxer passed over never came through here.
+	OgvDeadlineStats stats = m_stats;
+	stats.framesDropped += m_demuxer.GetSkippedFrames() - m_skippedBase;
+	return stats;
+}
+
+void OgvDeadlinePolicy::ResetStats()
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_skippedBase = m_demuxer.GetSkippedFrames();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+class OgvDemuxer;
+
+struct OgvDeadlineStats
+{
+	uint64_t framesOnTime;
+	uint64_t framesLate;		// delivered anyway, behind the clock
+	uint64_t framesDropped;		// not delivered, while skipping to a keyframe
+	uint64_t keyframeSkips;
+};
+
+// Decides, as each video frame is demuxed, whether playback has fallen too
+// far behind the clock to catch up a frame at a time. Past the threshold
+// the frame is dropped and the demuxer skips to the next keyframe, dropping
+// the rest of the group of pictures; playback carries on in step with the
+// clock from there, instead of drifting further and further behind it.
+//
+// Lateness is in 100 ns units, positive when behind; where it comes from
+// is up to the caller. Not thread-safe.
+class OgvDeadlinePolicy
+{
+public:
+	static const int64_t DefaultSkipThreshold = 2500000;	// 250 ms
+
+	explicit OgvDeadlinePolicy(OgvDemuxer &demuxer, int64_t skipThreshold = DefaultSkipThreshold);
+
+	void SetSkipThreshold(int64_t skipThreshold) { m_skipThreshold = skipThreshold; }
+	int64_t GetSkipThreshold() const { return m_skipThreshold; }
+
+	// Returns false if the frame should be dropped. A keyframe is always
+	// delivered, late or not, as it's where a skip has to land anyway.
+	bool FrameDemuxed(int64_t lateness, bool keyframe);
+
+	OgvDeadlineStats GetStats() const;
+	void ResetStats();
+
+private:
+	OgvDeadlinePolicy(const OgvDeadlinePolicy &);
+	OgvDeadlinePolicy &operator=(const OgvDeadlinePolicy &);
+
+	OgvDemuxer &m_demuxer;
+	int64_t m_skipThreshold;
+	uint64_t m_skippedBase;		// the demuxer's count at the last reset
+	OgvDeadlineStats m_stats;
+};
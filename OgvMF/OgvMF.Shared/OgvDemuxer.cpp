@@ -0,0 +1,416 @@
+#include "pch.h"
+
+#include "OgvDemuxer.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Bytes fetched per read from the byte source, beyond what was asked for.
+// Each refill reads the last maximum page size over again, so this wants
+// to be a good few times bigger than that.
+static const size_t ReadSize = 256 * 1024;
+
+static const int64_t TicksPerSecond = 10000000;
+
+OgvDemuxer::OgvDemuxer() :
+	m_length(0),
+	m_offset(0),
+	m_endOfStream(true),
+	m_readError(false),
+	m_trustChecksums(false),
+	m_verifyNext(true),
+	m_thinning(false),
+	m_awaitKeyframe(false),
+	m_skipping(false),
+	m_thinnedFrames(0),
+	m_skippedFrames(0),
+	m_bufferOffset(0)
+{
+}
+
+void OgvDemuxer::Open(const OgvReadFunc &read, uint64_t length, const std::vector<OgvIndexedStream> &streams, const OgvViewFunc &view)
+{
+	m_read = read;
+	m_view = view;
+	m_length = length;
+	m_streams.clear();
+	for (auto &stream : streams)
+	{
+		if (stream.type == OGV_STREAM_THEORA || stream.type == OGV_STREAM_VORBIS)
+		{
+			StreamState &state = m_streams[stream.serialno];
+			state.info = stream;
+			state.lastGranule = -1;
+			state.discontinuity = true;
+			state.enabled = true;
+		}
+	}
+	m_buffer.clear();
+	m_bufferOffset = 0;
+	Seek(0);
+}
+
+bool OgvDemuxer::ReadHeaders(uint64_t dataOffset)
+{
+	Seek(0);
+	while (m_offset < dataOffset)
+	{
+		OggPageHeader header;
+		const uint8_t *page = FetchPage(header);
+		if (page == nullptr)
+		{
+			return false;
+		}
+		m_offset += header.PageSize();
+
+		auto found = m_streams.find(header.serialno);
+		if (found == m_streams.end())
+		{
+			continue;
+		}
+		StreamState &state = found->second;
+		state.assembler.PushPage(page, header);
+
+		OggPacket packet;
+		while (state.assembler.PopPacket(packet))
+		{
+			const uint8_t *data = packet.data.data();
+			size_t size = packet.data.size();
+			bool isHeader = state.info.type == OGV_STREAM_THEORA ? OgvIsTheoraHeader(data, size) : OgvIsVorbisHeader(data, size);
+			if (isHeader)
+			{
+				state.headers.push_back(std::move(packet.data));
+			}
+		}
+	}
+	Seek(dataOffset);
+	return true;
+}
+
+const std::vector<std::vector<uint8_t>> &OgvDemuxer::GetHeaders(uint32_t serialno) const
+{
+	static const std::vector<std::vector<uint8_t>> none;
+	auto found = m_streams.find(serialno);
+	return found != m_streams.end() ? found->second.headers : none;
+}
+
+void OgvDemuxer::Seek(uint64_t offset)
+{
+	m_offset = offset;
+	m_endOfStream = offset >= m_length;
+	m_readError = false;
+	m_verifyNext = true;
+	m_awaitKeyframe = true;
+	m_skipping = false;
+	for (auto &entry : m_streams)
+	{
+		ResetStream(entry.second);
+	}
+}
+
+void OgvDemuxer::SkipToKeyframe()
+{
+	m_awaitKeyframe = true;
+	m_skipping = true;
+}
+
+void OgvDemuxer::SetStreamEnabled(uint32_t serialno, bool enabled)
+{
+	auto found = m_streams.find(serialno);
+	if (found == m_streams.end() || found->second.enabled == enabled)
+	{
+		return;
+	}
+	// Either way, whatever was part-assembled is no longer contiguous.
+	found->second.enabled = enabled;
+	ResetStream(found->second);
+	if (enabled && found->second.info.type == OGV_STREAM_THEORA)
+	{
+		// The frames inter frames refer to weren't demuxed.
+		m_awaitKeyframe = true;
+	}
+}
+
+void OgvDemuxer::SetThinning(bool thin)
+{
+	if (m_thinning && !thin)
+	{
+		m_awaitKeyframe = true;
+	}
+	m_thinning = thin;
+}
+
+bool OgvDemuxer::IsStreamEnabled(uint32_t serialno) const
+{
+	auto found = m_streams.find(serialno);
+	return found != m_streams.end() && found->second.enabled;
+}
+
+// True if every packet finished on a Theora page is an inter frame and no
+// packet carries on past it, so the whole page can go unassembled. The low
+// bits of a granulepos count frames since the last keyframe; if there are
+// at least as many as packets finish here, none of them is the keyframe.
+bool OgvDemuxer::CanThinPage(const StreamState &state, const OggPageHeader &header) const
+{
+	if (state.info.type != OGV_STREAM_THEORA || header.granulepos == -1 || header.segments == 0)
+	{
+		return false;
+	}
+	if (header.lacing[header.segments - 1] == 255)
+	{
+		return false;
+	}
+
+	int64_t finished = 0;
+	for (int i = 0; i < header.segments; i++)
+	{
+		if (header.lacing[i] < 255)
+		{
+			finished++;
+		}
+	}
+	int64_t mask = (static_cast<int64_t>(1) << state.info.theora.keyframeShift) - 1;
+	return (header.granulepos & mask) >= finished;
+}
+
+void OgvDemuxer::ResetStream(StreamState &state)
+{
+	state.assembler.Reset();
+	state.pending.clear();
+	state.lastGranule = -1;
+	state.discontinuity = true;
+}
+
+// Makes sure up to length bytes at offset are buffered, fewer at the end
+// of the file, and returns how many are.
+size_t OgvDemuxer::Buffer(uint64_t offset, size_t length, const uint8_t *&data)
+{
+	uint64_t remaining = offset < m_length ? m_length - offset : 0;
+	if (length > remaining)
+	{
+		length = static_cast<size_t>(remaining);
+	}
+
+	if (m_view)
+	{
+		return m_view(offset, length, data);
+	}
+
+	if (offset < m_bufferOffset || offset + length > m_bufferOffset + m_buffer.size())
+	{
+		// Pages are asked for a whole maximum page size ahead, so a window
+		// of just that would be refilled for every page.
+		size_t want = static_cast<size_t>(std::min<uint64_t>(length + ReadSize, remaining));
+		m_buffer.resize(want);
+		m_buffer.resize(m_read(offset, m_buffer.data(), want));
+		m_bufferOffset = offset;
+	}
+
+	data = m_buffer.data() + (offset - m_bufferOffset);
+	return static_cast<size_t>(m_bufferOffset + m_buffer.size() - offset);
+}
+
+// Returns the page at m_offset, skipping forward over garbage and damaged
+// pages if need be, or nullptr at the end of the file or if the source
+// couldn't supply the bytes. Only the former ends the stream; after a
+// failed read the same offset is tried again next time.
+const uint8_t *OgvDemuxer::FetchPage(OggPageHeader &header)
+{
+	bool resynced = false;
+	m_readError = false;
+	while (m_offset < m_length)
+	{
+		const uint8_t *data;
+		size_t available = Buffer(m_offset, OggPageMaxSize, data);
+		bool atEnd = m_offset + available >= m_length;
+		if (available == 0)
+		{
+			m_readError = true;
+			return nullptr;
+		}
+
+		OggParseResult result = OggParsePageHeader(data, available, header);
+		if (result == OGG_PAGE_OK && header.PageSize() <= available)
+		{
+			// Most capture patterns found by scanning are inside packet data;
+			// the cheap checks turn those away without a CRC pass.
+			bool plausible = !resynced || OggPagePlausible(data, available, header);
+			if (plausible && ((m_trustChecksums && !m_verifyNext) || OggVerifyPage(data, header)))
+			{
+				m_verifyNext = false;
+				return data;
+			}
+		}
+		else if (result != OGG_PAGE_INVALID && available < OggPageMaxSize)
+		{
+			if (!atEnd)
+			{
+				// The read came up short of the page.
+				m_readError = true;
+				return nullptr;
+			}
+			// Truncated page at the end of the file.
+			break;
+		}
+
+		// Lost sync; skip to the next capture pattern, keeping the last few
+		// bytes in case one straddles the end of the buffer.
+		size_t skip = 1 + OggFindCapture(data + 1, available - 1);
+		if (skip >= available && available > 3)
+		{
+			skip = available - 3;
+		}
+		m_offset += skip;
+		m_verifyNext = true;
+		resynced = true;
+		for (auto &entry : m_streams)
+		{
+			entry.second.discontinuity = true;
+		}
+	}
+
+	m_endOfStream = true;
+	return nullptr;
+}
+
+bool OgvDemuxer::ReadPage(const SampleFunc &onSample)
+{
+	if (m_endOfStream)
+	{
+		return false;
+	}
+
+	OggPageHeader header;
+	const uint8_t *page = FetchPage(header);
+	if (page == nullptr)
+	{
+		return false;
+	}
+	m_offset += header.PageSize();
+
+	auto found = m_streams.find(header.serialno);
+	if (found == m_streams.end() || !found->second.enabled)
+	{
+		return true;
+	}
+	StreamState &state = found->second;
+	if ((m_thinning || m_awaitKeyframe) && CanThinPage(state, header))
+	{
+		// Anything part-assembled finishes on this page, so goes with it.
+		state.assembler.Reset();
+		state.pending.clear();
+		for (int i = 0; i < header.segments; i++)
+		{
+			if (header.lacing[i] < 255)
+			{
+				m_thinnedFrames++;
+				m_skippedFrames += m_skipping ? 1 : 0;
+			}
+		}
+		return true;
+	}
+	state.assembler.PushPage(page, header);
+
+	int64_t granulepos = -1;
+	OggPacket packet;
+	while (state.assembler.PopPacket(packet))
+	{
+		const uint8_t *data = packet.data.data();
+		size_t size = packet.data.size();
+		bool isHeader = state.info.type == OGV_STREAM_THEORA ? OgvIsTheoraHeader(data, size) : OgvIsVorbisHeader(data, size);
+		if (isHeader)
+		{
+			continue;
+		}
+		if (packet.granulepos != -1)
+		{
+			granulepos = packet.granulepos;
+		}
+		state.pending.push_back(std::move(packet));
+	}
+
+	if (granulepos != -1 && !state.pending.empty())
+	{
+		if (state.info.type == OGV_STREAM_THEORA)
+		{
+			StampTheora(state, granulepos, onSample);
+		}
+		else
+		{
+			StampVorbis(state, granulepos, onSample);
+		}
+		state.lastGranule = granulepos;
+	}
+	return true;
+}
+
+void OgvDemuxer::StampTheora(StreamState &state, int64_t granulepos, const SampleFunc &onSample)
+{
+	const OgvTheoraInfo &theora = state.info.theora;
+	int64_t duration = TicksPerSecond * theora.fpsDenominator / theora.fpsNumerator;
+	int64_t lastFrame = OgvTheoraFrameIndex(theora, granulepos);
+	int64_t count = static_cast<int64_t>(state.pending.size());
+
+	for (int64_t i = 0; i < count; i++)
+	{
+		OggPacket &packet = state.pending[static_cast<size_t>(i)];
+		int64_t frame = lastFrame - (count - 1 - i);
+		if (packet.data.empty())
+		{
+			// A zero-length packet repeats the previous frame; nothing to decode.
+			continue;
+		}
+		int64_t time = frame * TicksPerSecond * theora.fpsDenominator / theora.fpsNumerator;
+		// Data packets start with a zero bit; the next bit is clear on intra frames.
+		bool keyframe = (packet.data[0] & 0x40) == 0;
+		if (keyframe)
+		{
+			m_awaitKeyframe = false;
+			m_skipping = false;
+		}
+		else if (m_thinning || m_awaitKeyframe)
+		{
+			m_thinnedFrames++;
+			m_skippedFrames += m_skipping ? 1 : 0;
+			continue;
+		}
+		Emit(state, packet, time, duration, keyframe, onSample);
+	}
+	state.pending.clear();
+}
+
+void OgvDemuxer::StampVorbis(StreamState &state, int64_t granulepos, const SampleFunc &onSample)
+{
+	const OgvVorbisInfo &vorbis = state.info.vorbis;
+	int64_t count = static_cast<int64_t>(state.pending.size());
+
+	// Without the previous page's granulepos, assume average-sized blocks.
+	int64_t span = state.lastGranule != -1 && granulepos > state.lastGranule ?
+		granulepos - state.lastGranule :
+		count * (vorbis.blocksizeShort + vorbis.blocksizeLong) / 4;
+	int64_t start = granulepos - span;
+
+	for (int64_t i = 0; i < count; i++)
+	{
+		int64_t first = start + span * i / count;
+		int64_t next = start + span * (i + 1) / count;
+		// The first page's estimate can start before zero; what falls there
+		// isn't played, so it doesn't count toward the duration either.
+		int64_t time = std::max<int64_t>(first * TicksPerSecond / vorbis.sampleRate, 0);
+		int64_t end = std::max<int64_t>(next * TicksPerSecond / vorbis.sampleRate, 0);
+		Emit(state, state.pending[static_cast<size_t>(i)], time, end - time, true, onSample);
+	}
+	state.pending.clear();
+}
+
+void OgvDemuxer::Emit(StreamState &state, OggPacket &packet, int64_t time, int64_t duration, bool keyframe, const SampleFunc &onSample)
+{
+	OgvSample sample;
+	sample.data = std::move(packet.data);
+	sample.time = time;
+	sample.duration = duration;
+	sample.keyframe = keyframe;
+	sample.discontinuity = state.discontinuity;
+	state.discontinuity = false;
+	onSample(state.info.serialno, sample);
+}
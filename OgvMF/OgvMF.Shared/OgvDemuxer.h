@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "OggPage.h"
+#include "OgvSeekIndex.h"
+#include "OgvSampleQueue.h"
+
+// Reads pages from an Ogg physical stream in file order and turns the data
+// packets of the Theora and Vorbis streams into timestamped samples.
+//
+// Granule positions only appear on the last packet finished on each page,
+// so packets are held until their page's granulepos arrives and then
+// stamped by counting back from it. Theora has one frame per packet, which
+// makes that exact; Vorbis packets vary in length with the block size, so
+// they share the page's span of samples evenly.
+class OgvDemuxer
+{
+public:
+	typedef std::function<void(uint32_t serialno, OgvSample &sample)> SampleFunc;
+
+	OgvDemuxer();
+
+	// With a view, pages are parsed in place and read is not used.
+	void Open(const OgvReadFunc &read, uint64_t length, const std::vector<OgvIndexedStream> &streams, const OgvViewFunc &view = OgvViewFunc());
+
+	// Collects the header packets of every known stream, reading from the
+	// start of the file up to dataOffset. Leaves the demuxer there.
+	bool ReadHeaders(uint64_t dataOffset);
+	const std::vector<std::vector<uint8_t>> &GetHeaders(uint32_t serialno) const;
+
+	// Resumes demuxing from a page boundary. The next sample of each stream
+	// is flagged as a discontinuity, and Theora inter frames are dropped up
+	// to the first keyframe, as their references are gone.
+	void Seek(uint64_t offset);
+
+	// Demuxes one page, calling onSample for each sample it completes.
+	// Returns false at the end of the file, or when the source fails to
+	// deliver a page before the end; HasReadError tells the two apart, and
+	// calling again retries the read.
+	bool ReadPage(const SampleFunc &onSample);
+
+	// Streams start enabled. Pages of a disabled stream are passed over
+	// without reassembling their packets, so nothing is copied for it and
+	// it produces no samples. Re-enabling one resumes at its next packet
+	// start, flagged as a discontinuity; for Theora, at its next keyframe.
+	void SetStreamEnabled(uint32_t serialno, bool enabled);
+	bool IsStreamEnabled(uint32_t serialno) const;
+
+	// In thinned mode only Theora keyframes come out. Pages whose finished
+	// packets are all inter frames, which the keyframe shift in their
+	// granulepos gives away, are passed over without reassembly. On leaving
+	// thinned mode, inter frames keep being dropped up to the next keyframe,
+	// since their references are gone.
+	void SetThinning(bool thin);
+	bool IsThinning() const { return m_thinning; }
+
+	// Inter frames dropped by thinning or while waiting for a keyframe after
+	// a seek, for measuring the decode work saved.
+	uint64_t GetThinnedFrames() const { return m_thinnedFrames; }
+
+	// Drops Theora inter frames up to the next keyframe, passing over pages
+	// of them without reassembly, to catch up when playback has fallen
+	// behind. Those still waiting on the current page go too. The frames
+	// dropped are counted in GetSkippedFrames as well as GetThinnedFrames.
+	void SkipToKeyframe();
+	bool IsSkippingToKeyframe() const { return m_skipping; }
+	uint64_t GetSkippedFrames() const { return m_skippedFrames; }
+
+	// Skips the CRC check on pages that follow on from a verified one, for
+	// sources trusted not to be corrupt. Pages found after a seek or by
+	// resynchronizing are still checked, as a stray capture pattern inside
+	// packet data would otherwise be taken for a page.
+	void SetTrustChecksums(bool trust) { m_trustChecksums = trust; }
+
+	bool IsEndOfStream() const { return m_endOfStream; }
+	bool HasReadError() const { return m_readError; }
+	uint64_t GetOffset() const { return m_offset; }
+
+private:
+	struct StreamState
+	{
+		OgvIndexedStream info;
+		OggPacketAssembler assembler;
+		std::vector<OggPacket> pending;
+		std::vector<std::vector<uint8_t>> headers;
+		int64_t lastGranule;		// -1 until the first granulepos after a seek
+		bool discontinuity;
+		bool enabled;
+	};
+
+	void ResetStream(StreamState &state);
+	bool CanThinPage(const StreamState &state, const OggPageHeader &header) const;
+
+	size_t Buffer(uint64_t offset, size_t length, const uint8_t *&data);
+	const uint8_t *FetchPage(OggPageHeader &header);
+	void StampTheora(StreamState &state, int64_t granulepos, const SampleFunc &onSample);
+	void StampVorbis(StreamState &state, int64_t granulepos, const SampleFunc &onSample);
+	void Emit(StreamState &state, OggPacket &packet, int64_t time, int64_t duration, bool keyframe, const SampleFunc &onSample);
+
+	OgvReadFunc m_read;
+	OgvViewFunc m_view;
+	uint64_t m_length;
+	uint64_t m_offset;
+	bool m_endOfStream;
+	bool m_readError;		// the last page fetch came up short of the end
+	bool m_trustChecksums;
+	bool m_verifyNext;		// next page isn't known to follow a good one
+	bool m_thinning;
+	bool m_awaitKeyframe;	// dropping inter frames until the next keyframe
+	bool m_skipping;		// ...because SkipToKeyframe asked to
+	uint64_t m_thinnedFrames;
+	uint64_t m_skippedFrames;
+
+	std::map<uint32_t, StreamState> m_streams;
+
+	std::vector<uint8_t> m_buffer;
+	uint64_t m_bufferOffset;
+};
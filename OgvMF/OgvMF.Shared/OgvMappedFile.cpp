@@ -0,0 +1,274 @@
+#include "pch.h"
+
+#include "OgvMappedFile.h"
+
+#include <algorithm>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Bytes mapped per view. Several pages' worth, so sequential demuxing
+// remaps rarely, while a multi-gigabyte file still only ever has this
+// much of it mapped per reader.
+static const size_t ViewWindowSize = 8 * 1024 * 1024;
+
+#ifdef _WIN32
+
+static void CloseMapping(void *handle)
+{
+	CloseHandle(handle);
+}
+
+// Turns a file: URL into a path. Escaped characters aren't decoded, so
+// URLs with any are left to the byte stream.
+static bool PathFromUrl(const std::wstring &url, std::wstring &path)
+{
+	static const wchar_t FileScheme[] = L"file:///";
+	static const size_t FileSchemeLength = sizeof(FileScheme) / sizeof(FileScheme[0]) - 1;
+
+	if (url.compare(0, FileSchemeLength, FileScheme) == 0)
+	{
+		path = url.substr(FileSchemeLength);
+		if (path.find(L'%') != std::wstring::npos)
+		{
+			return false;
+		}
+		std::replace(path.begin(), path.end(), L'/', L'\\');
+	}
+	else
+	{
+		path = url;
+	}
+
+	// Only absolute drive paths; anything else is a network or app URI.
+	return path.size() > 2 && path[1] == L':' && path[2] == L'\\';
+}
+
+static size_t MapGranularity()
+{
+	SYSTEM_INFO info;
+	GetNativeSystemInfo(&info);
+	return info.dwAllocationGranularity;
+}
+
+static void *MapWindow(void *mapping, uint64_t offset, size_t size)
+{
+	return MapViewOfFileFromApp(mapping, FILE_MAP_READ, offset, size);
+}
+
+static void UnmapWindow(void *view, size_t)
+{
+	UnmapViewOfFile(view);
+}
+
+#else
+
+// The mapping is the file itself; each window maps a range of it.
+struct OgvFileDescriptor
+{
+	int fd;
+
+	explicit OgvFileDescriptor(int handle) : fd(handle) {}
+	~OgvFileDescriptor() { close(fd); }
+};
+
+static size_t MapGranularity()
+{
+	return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+static void *MapWindow(void *mapping, uint64_t offset, size_t size)
+{
+	int fd = static_cast<OgvFileDescriptor *>(mapping)->fd;
+	void *view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+	if (view == MAP_FAILED)
+	{
+		return nullptr;
+	}
+	// Demuxing reads front to back; let the kernel read ahead for it.
+	madvise(view, size, MADV_SEQUENTIAL);
+	return view;
+}
+
+static void UnmapWindow(void *view, size_t size)
+{
+	munmap(view, size);
+}
+
+#endif
+
+// One reader's window onto a mapping.
+class OgvMappedWindow
+{
+public:
+	OgvMappedWindow(const std::shared_ptr<void> &mapping, uint64_t length) :
+		m_mapping(mapping),
+		m_length(length),
+		m_view(nullptr),
+		m_viewOffset(0),
+		m_viewSize(0),
+		m_granularity(MapGranularity())
+	{
+	}
+
+	~OgvMappedWindow()
+	{
+		Unmap();
+	}
+
+	size_t View(uint64_t offset, size_t length, const uint8_t *&data)
+	{
+		if (offset >= m_length)
+		{
+			return 0;
+		}
+		if (length > m_length - offset)
+		{
+			length = static_cast<size_t>(m_length - offset);
+		}
+
+		if (m_view == nullptr || offset < m_viewOffset || offset + length > m_viewOffset + m_viewSize)
+		{
+			// Views must start on the allocation granularity.
+			uint64_t start = offset - offset % m_granularity;
+			size_t size = std::max(ViewWindowSize, static_cast<size_t>(offset - start) + length);
+			if (size > m_length - start)
+			{
+				size = static_cast<size_t>(m_length - start);
+			}
+
+			// Dropping the old window first takes its pages out of our working set.
+			Unmap();
+			m_view = MapWindow(m_mapping.get(), start, size);
+			if (m_view == nullptr)
+			{
+				return 0;
+			}
+			m_viewOffset = start;
+			m_viewSize = size;
+		}
+
+		data = static_cast<const uint8_t *>(m_view) + (offset - m_viewOffset);
+		return static_cast<size_t>(m_viewOffset + m_viewSize - offset);
+	}
+
+private:
+	OgvMappedWindow(const OgvMappedWindow &);
+	OgvMappedWindow &operator=(const OgvMappedWindow &);
+
+	void Unmap()
+	{
+		if (m_view != nullptr)
+		{
+			UnmapWindow(m_view, m_viewSize);
+			m_view = nullptr;
+		}
+	}
+
+	std::shared_ptr<void> m_mapping;
+	uint64_t m_length;
+	void *m_view;
+	uint64_t m_viewOffset;
+	size_t m_viewSize;
+	size_t m_granularity;
+};
+
+OgvMappedFile::OgvMappedFile() :
+	m_length(0)
+{
+}
+
+OgvMappedFile::~OgvMappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool OgvMappedFile::Open(const std::wstring &url)
+{
+	Close();
+
+	std::wstring path;
+	if (!PathFromUrl(url, path))
+	{
+		return false;
+	}
+
+	// Demuxing reads front to back; let the cache manager read ahead for it.
+	CREATEFILE2_EXTENDED_PARAMETERS params = {};
+	params.dwSize = sizeof(params);
+	params.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+	params.dwFileFlags = FILE_FLAG_SEQUENTIAL_SCAN;
+
+	HANDLE file = CreateFile2(path.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, &params);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	FILE_STANDARD_INFO standard;
+	HANDLE mapping = nullptr;
+	if (GetFileInformationByHandleEx(file, FileStandardInfo, &standard, sizeof(standard)) && standard.EndOfFile.QuadPart > 0)
+	{
+		mapping = CreateFileMappingFromApp(file, nullptr, PAGE_READONLY, 0, nullptr);
+	}
+	// The mapping holds its own reference to the file.
+	CloseHandle(file);
+	if (mapping == nullptr)
+	{
+		return false;
+	}
+
+	m_mapping.reset(mapping, CloseMapping);
+	m_length = static_cast<uint64_t>(standard.EndOfFile.QuadPart);
+	return true;
+}
+
+#else
+
+bool OgvMappedFile::Open(const std::string &path)
+{
+	Close();
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+	std::shared_ptr<OgvFileDescriptor> descriptor = std::make_shared<OgvFileDescriptor>(fd);
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0)
+	{
+		return false;
+	}
+
+	m_mapping = descriptor;
+	m_length = static_cast<uint64_t>(info.st_size);
+	return true;
+}
+
+#endif
+
+void OgvMappedFile::Close()
+{
+	m_mapping.reset();
+	m_length = 0;
+}
+
+OgvViewFunc OgvMappedFile::CreateView() const
+{
+	if (m_mapping == nullptr)
+	{
+		return OgvViewFunc();
+	}
+	std::shared_ptr<OgvMappedWindow> window = std::make_shared<OgvMappedWindow>(m_mapping, m_length);
+	return [window](uint64_t offset, size_t length, const uint8_t *&data) {
+		return window->View(offset, length, data);
+	};
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "OgvSeekIndex.h"
+
+// A local file mapped read-only, for reading pages in place instead of
+// copying them out of a byte stream.
+//
+// Nothing maps the whole file: each view maps a window of it, sliding
+// forward as it is read, so address space and resident pages stay bounded
+// by the window size however big the file is. Views unmap their last
+// window when they are destroyed, and keep the mapping alive until then,
+// so closing the file doesn't pull pages out from under a reader.
+class OgvMappedFile
+{
+public:
+	OgvMappedFile();
+	~OgvMappedFile();
+
+#ifdef _WIN32
+	// Accepts a local path or a file: URL. Returns false if the file can't
+	// be opened or mapped here; callers fall back to reading a byte stream.
+	bool Open(const std::wstring &url);
+#else
+	bool Open(const std::string &path);
+#endif
+	void Close();
+
+	bool IsOpen() const { return m_mapping != nullptr; }
+	uint64_t GetLength() const { return m_length; }
+
+	// Creates an independent reader over the file. Pointers it hands out
+	// are good until its next call.
+	OgvViewFunc CreateView() const;
+
+private:
+	OgvMappedFile(const OgvMappedFile &);
+	OgvMappedFile &operator=(const OgvMappedFile &);
+
+	std::shared_ptr<void> m_mapping;
+	uint64_t m_length;
+};
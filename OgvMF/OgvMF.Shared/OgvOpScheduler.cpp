@@ -0,0 +1,173 @@
+#include "pch.h"
+
+#include "OgvOpScheduler.h"
+
+#include <cassert>
+#include <cstring>
+
+uint64_t OgvOpStats::Percentile(double fraction) const
+{
+	uint64_t total = 0;
+	for (int i = 0; i < OgvOpLatencyBuckets; i++)
+	{
+		total += latency[i];
+	}
+	if (total == 0)
+	{
+		return 0;
+	}
+
+	uint64_t wanted = static_cast<uint64_t>(fraction * total + 0.5);
+	uint64_t seen = 0;
+	for (int i = 0; i < OgvOpLatencyBuckets - 1; i++)
+	{
+		seen += latency[i];
+		if (seen >= wanted)
+		{
+			return static_cast<uint64_t>(2) << i;
+		}
+	}
+	return maxLatencyMicros;
+}
+
+OgvOpScheduler::OgvOpScheduler() :
+	m_shutdown(false)
+{
+	memset(m_stats, 0, sizeof(m_stats));
+	// Started last, once everything it touches is initialized.
+	m_thread = std::thread([this] { Run(); });
+}
+
+OgvOpScheduler::~OgvOpScheduler()
+{
+	Shutdown();
+}
+
+bool OgvOpScheduler::Post(int type, const OpFunc &op, bool coalesce)
+{
+	if (type < 0 || type >= MaxOpTypes)
+	{
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_shutdown)
+		{
+			return false;
+		}
+
+		m_stats[type].posted++;
+		if (coalesce && !m_ops.empty() && m_ops.back().type == type)
+		{
+			// Keep the original post time so the latency covers the whole wait.
+			m_ops.back().func = op;
+			m_stats[type].coalesced++;
+			return true;
+		}
+
+		Op entry;
+		entry.type = type;
+		entry.func = op;
+		entry.posted = Clock::now();
+		m_ops.push_back(std::move(entry));
+	}
+	m_wake.notify_one();
+	return true;
+}
+
+void OgvOpScheduler::Shutdown()
+{
+	std::deque<Op> cancelled;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_shutdown = true;
+		cancelled.swap(m_ops);
+		for (auto &op : cancelled)
+		{
+			m_stats[op.type].cancelled++;
+		}
+	}
+	m_wake.notify_one();
+
+	if (m_thread.joinable())
+	{
+		assert(m_thread.get_id() != std::this_thread::get_id());
+		m_thread.join();
+	}
+}
+
+bool OgvOpScheduler::IsShutdown() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_shutdown;
+}
+
+size_t OgvOpScheduler::GetPendingOps() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_ops.size();
+}
+
+OgvOpStats OgvOpScheduler::GetStats(int type) const
+{
+	OgvOpStats stats;
+	memset(&stats, 0, sizeof(stats));
+	if (type >= 0 && type < MaxOpTypes)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		stats = m_stats[type];
+	}
+	return stats;
+}
+
+void OgvOpScheduler::Run()
+{
+	for (;;)
+	{
+		Op op;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this] { return m_shutdown || !m_ops.empty(); });
+			if (m_shutdown)
+			{
+				return;
+			}
+			op = std::move(m_ops.front());
+			m_ops.pop_front();
+		}
+
+		bool failed = false;
+		try
+		{
+			op.func();
+		}
+		catch (...)
+		{
+			// Ops report their own errors; just keep the worker alive.
+			failed = true;
+		}
+		Record(op.type, op.posted, failed);
+	}
+}
+
+void OgvOpScheduler::Record(int type, Clock::time_point posted, bool failed)
+{
+	uint64_t micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - posted).count());
+
+	int bucket = 0;
+	while (bucket < OgvOpLatencyBuckets - 1 && (micros >> (bucket + 1)) != 0)
+	{
+		bucket++;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	OgvOpStats &stats = m_stats[type];
+	stats.completed++;
+	stats.failed += failed ? 1 : 0;
+	stats.latency[bucket]++;
+	if (micros > stats.maxLatencyMicros)
+	{
+		stats.maxLatencyMicros = micros;
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Latency buckets are powers of two in microseconds: bucket 0 is under
+// 2us, bucket i covers [2^i, 2^(i+1)) and the last one takes the rest.
+static const int OgvOpLatencyBuckets = 24;
+
+struct OgvOpStats
+{
+	uint64_t posted;
+	uint64_t completed;
+	uint64_t coalesced;		// replaced by a later op of the same type before running
+	uint64_t cancelled;		// still queued at shutdown
+	uint64_t failed;		// threw
+	uint64_t maxLatencyMicros;
+	uint64_t latency[OgvOpLatencyBuckets];	// post to completion
+
+	// Upper bound in microseconds of the bucket holding the given fraction
+	// of completed ops, e.g. 0.99 for the 99th percentile.
+	uint64_t Percentile(double fraction) const;
+};
+
+// Runs operations one at a time, in order, on a worker thread of its own.
+//
+// Each op has a small integer type. An op posted with coalescing replaces
+// the op at the back of the queue if that is of the same type and hasn't
+// started, so a burst of, say, sample requests runs only once. Ops whose
+// every call must be answered, such as rate changes, shouldn't coalesce.
+// Shutdown drops whatever is still queued, waits for the running op and
+// joins the thread; nothing runs after it returns.
+class OgvOpScheduler
+{
+public:
+	typedef std::function<void(void)> OpFunc;
+
+	static const int MaxOpTypes = 8;
+
+	OgvOpScheduler();
+	~OgvOpScheduler();
+
+	// Returns false once shut down.
+	bool Post(int type, const OpFunc &op, bool coalesce = false);
+
+	// Must not be called from an op.
+	void Shutdown();
+	bool IsShutdown() const;
+
+	size_t GetPendingOps() const;
+	OgvOpStats GetStats(int type) const;
+
+private:
+	OgvOpScheduler(const OgvOpScheduler &);
+	OgvOpScheduler &operator=(const OgvOpScheduler &);
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct Op
+	{
+		int type;
+		OpFunc func;
+		Clock::time_point posted;
+	};
+
+	void Run();
+	void Record(int type, Clock::time_point posted, bool failed);
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::deque<Op> m_ops;
+	bool m_shutdown;
+	OgvOpStats m_stats[MaxOpTypes];
+
+	std::thread m_thread;
+};
@@ -0,0 +1,148 @@
+#include "pch.h"
+
+#include "OgvProbe.h"
+#include "OgvSeekIndex.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+// Counts what the probe reads, to report its cost.
+class OgvCountingByteSource : public OgvByteSource
+{
+public:
+	explicit OgvCountingByteSource(const std::shared_ptr<OgvByteSource> &source) :
+		m_source(source),
+		m_reads(0),
+		m_bytesRead(0)
+	{
+	}
+
+	virtual uint64_t GetLength() const { return m_source->GetLength(); }
+
+	virtual size_t ReadAt(uint64_t offset, uint8_t *buffer, size_t length)
+	{
+		size_t count = m_source->ReadAt(offset, buffer, length);
+		m_reads++;
+		m_bytesRead += count;
+		return count;
+	}
+
+	uint64_t GetReads() const { return m_reads; }
+	uint64_t GetBytesRead() const { return m_bytesRead; }
+
+private:
+	std::shared_ptr<OgvByteSource> m_source;
+	uint64_t m_reads;
+	uint64_t m_bytesRead;
+};
+
+// The longest keyframe interval the video stream shows, in frames.
+static uint32_t KeyframeInterval(const OgvIndexedStream &video)
+{
+	const OgvTheoraInfo &theora = video.theora;
+	double fps = theora.fpsDenominator ? static_cast<double>(theora.fpsNumerator) / theora.fpsDenominator : 0.0;
+	int64_t longest = 0;
+
+	// A Skeleton index lists every keyframe.
+	for (size_t i = 1; i < video.keypoints.size(); i++)
+	{
+		double gap = (video.keypoints[i].time - video.keypoints[i - 1].time) * fps;
+		longest = std::max(longest, static_cast<int64_t>(floor(gap + 0.5)));
+	}
+
+	// Otherwise each page's granulepos says how far its last frame is past
+	// a keyframe, which is a lower bound.
+	for (auto &entry : video.pages)
+	{
+		int64_t granulepos = entry.second.granulepos;
+		int64_t sinceKeyframe = OgvTheoraFrameCount(theora, granulepos) - OgvTheoraKeyframeGranule(theora, granulepos);
+		longest = std::max(longest, sinceKeyframe + 1);
+	}
+	return static_cast<uint32_t>(longest);
+}
+
+bool OgvProbe(const std::shared_ptr<OgvByteSource> &source, OgvMediaInfo &info)
+{
+	memset(&info, 0, sizeof(info));
+
+	std::shared_ptr<OgvCountingByteSource> counted = std::make_shared<OgvCountingByteSource>(source);
+	OgvSeekIndex index;
+	bool opened = index.Open(OgvByteSource::MakeReadFunc(counted), counted->GetLength());
+	if (opened)
+	{
+		for (auto &stream : index.GetStreams())
+		{
+			if (stream.type == OGV_STREAM_THEORA && !info.hasVideo)
+			{
+				info.hasVideo = true;
+				info.width = stream.theora.pictureWidth;
+				info.height = stream.theora.pictureHeight;
+				info.frameRate = stream.theora.fpsDenominator ? static_cast<double>(stream.theora.fpsNumerator) / stream.theora.fpsDenominator : 0.0;
+				info.keyframeIntervalLimit = 1u << stream.theora.keyframeShift;
+			}
+			else if (stream.type == OGV_STREAM_VORBIS && !info.hasAudio)
+			{
+				info.hasAudio = true;
+				info.sampleRate = stream.vorbis.sampleRate;
+				info.channels = stream.vorbis.channels;
+			}
+		}
+		info.duration = index.GetDuration();
+		info.hasSkeletonIndex = index.HasSkeletonIndex();
+
+		// After GetDuration, so the pages it scanned at the end are known.
+		for (auto &stream : index.GetStreams())
+		{
+			if (stream.type == OGV_STREAM_THEORA)
+			{
+				info.keyframeInterval = KeyframeInterval(stream);
+				break;
+			}
+		}
+	}
+
+	info.reads = counted->GetReads();
+	info.bytesRead = counted->GetBytesRead();
+	return opened;
+}
+
+#ifdef _WIN32
+
+std::vector<OgvProbeResult> OgvProbeFiles(const std::vector<std::wstring> &paths, unsigned threads)
+{
+	std::vector<OgvProbeResult> results(paths.size());
+	std::atomic<size_t> next(0);
+
+	// Each worker takes the next unprobed file; the files are independent,
+	// and the time goes on waiting for the disk rather than computing.
+	auto worker = [&paths, &results, &next] {
+		for (size_t i = next++; i < paths.size(); i = next++)
+		{
+			OgvProbeResult &result = results[i];
+			result.path = paths[i];
+
+			std::shared_ptr<OgvFileByteSource> file = std::make_shared<OgvFileByteSource>();
+			result.ok = file->Open(paths[i]) && OgvProbe(file, result.info);
+			if (!result.ok)
+			{
+				memset(&result.info, 0, sizeof(result.info));
+			}
+		}
+	};
+
+	threads = std::max(1u, std::min(threads, static_cast<unsigned>(paths.size())));
+	std::vector<std::thread> pool;
+	for (unsigned t = 1; t < threads; t++)
+	{
+		pool.emplace_back(worker);
+	}
+	worker();
+	for (auto &thread : pool)
+	{
+		thread.join();
+	}
+	return results;
+}
+
+#endif
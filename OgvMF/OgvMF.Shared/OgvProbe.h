@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "OgvByteSource.h"
+
+// What a file holds, learned from its headers and its last pages without
+// decoding anything.
+struct OgvMediaInfo
+{
+	bool hasVideo;
+	uint32_t width;					// picture size, not the coded frame size
+	uint32_t height;
+	double frameRate;
+	// Longest run of frames from a keyframe to the next, as far as the probe
+	// saw: exact with a Skeleton index, otherwise only what the last pages
+	// show, which may fall short. 0 if unknown.
+	uint32_t keyframeInterval;
+	uint32_t keyframeIntervalLimit;	// the most the stream's granule shift allows
+
+	bool hasAudio;
+	uint32_t sampleRate;
+	uint32_t channels;
+
+	double duration;				// seconds
+	bool hasSkeletonIndex;
+
+	// Cost of the probe.
+	uint64_t reads;
+	uint64_t bytesRead;
+};
+
+// Reads the Theora and Vorbis headers from the start of the source and the
+// last granule positions from its end: a few small reads for a typical file,
+// whatever its length.
+bool OgvProbe(const std::shared_ptr<OgvByteSource> &source, OgvMediaInfo &info);
+
+#ifdef _WIN32
+
+struct OgvProbeResult
+{
+	std::wstring path;
+	bool ok;
+	OgvMediaInfo info;
+};
+
+// Probes many local files, threads at a time. Results are in the order of
+// paths. Store apps can't enumerate directories from here, so the caller
+// lists them, e.g. with a StorageFolder query.
+std::vector<OgvProbeResult> OgvProbeFiles(const std::vector<std::wstring> &paths, unsigned threads);
+
+#endif
@@ -0,0 +1,144 @@
+#include "pch.h"
+
+#include "OgvSampleQueue.h"
+
+OgvSampleQueue::OgvSampleQueue(size_t prerollDepth) :
+	m_prerollDepth(prerollDepth > 0 ? prerollDepth : 1),
+	m_endOfStream(false),
+	m_ended(false)
+{
+}
+
+void OgvSampleQueue::SetPrerollDepth(size_t prerollDepth)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_prerollDepth = prerollDepth > 0 ? prerollDepth : 1;
+}
+
+size_t OgvSampleQueue::GetPrerollDepth() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_prerollDepth;
+}
+
+bool OgvSampleQueue::Request(const OgvSampleToken &token)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_ended)
+	{
+		return false;
+	}
+	m_requests.push_back(token);
+	return true;
+}
+
+void OgvSampleQueue::Push(OgvSample &&sample)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_endOfStream)
+	{
+		m_samples.push_back(std::move(sample));
+	}
+}
+
+void OgvSampleQueue::EndOfStream()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_endOfStream = true;
+}
+
+void OgvSampleQueue::Flush()
+{
+	std::deque<OgvSample> samples;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		samples.swap(m_samples);
+		m_endOfStream = false;
+		m_ended = false;
+	}
+}
+
+void OgvSampleQueue::Clear()
+{
+	// Let the tokens go outside the lock; releasing them may call back in.
+	std::deque<OgvSampleToken> requests;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		requests.swap(m_requests);
+	}
+	Flush();
+}
+
+bool OgvSampleQueue::NeedsData() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return !m_endOfStream && m_samples.size() < m_requests.size() + m_prerollDepth;
+}
+
+bool OgvSampleQueue::IsPrerolled() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_endOfStream || m_samples.size() >= m_prerollDepth;
+}
+
+bool OgvSampleQueue::IsEnded() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_ended;
+}
+
+void OgvSampleQueue::Dispatch(const DeliverFunc &deliver, const EndFunc &end)
+{
+	std::lock_guard<std::mutex> dispatchLock(m_dispatchMutex);
+	for (;;)
+	{
+		OgvSample sample;
+		OgvSampleToken token;
+		bool signalEnd = false;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_requests.empty())
+			{
+				return;
+			}
+			if (m_samples.empty())
+			{
+				if (!m_endOfStream || m_ended)
+				{
+					return;
+				}
+				// The request that finds the stream dry gets the end of stream
+				// instead; any others behind it will never be answered.
+				m_ended = true;
+				m_requests.clear();
+				signalEnd = true;
+			}
+			else
+			{
+				sample = std::move(m_samples.front());
+				m_samples.pop_front();
+				token = std::move(m_requests.front());
+				m_requests.pop_front();
+			}
+		}
+
+		if (signalEnd)
+		{
+			end();
+			return;
+		}
+		deliver(sample, token);
+	}
+}
+
+size_t OgvSampleQueue::GetQueuedSamples() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_samples.size();
+}
+
+size_t OgvSampleQueue::GetPendingRequests() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_requests.size();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// One compressed packet ready to go out as a media sample.
+// Times are in 100ns units, as Media Foundation uses.
+struct OgvSample
+{
+	std::vector<uint8_t> data;
+	int64_t time;
+	int64_t duration;
+	bool keyframe;
+	bool discontinuity;		// first sample after a seek or a gap in the stream
+
+	OgvSample() : time(0), duration(0), keyframe(false), discontinuity(false) {}
+};
+
+// Opaque request token handed back with the sample that answers it.
+// The owner releases whatever it wraps when the last reference goes.
+typedef std::shared_ptr<void> OgvSampleToken;
+
+// Pairs sample requests with demuxed samples for one stream, in order.
+//
+// The demuxer keeps the queue topped up to the preroll depth ahead of the
+// outstanding requests, so a request can usually be answered as soon as it
+// arrives. Delivery only happens through Dispatch, which the owner calls
+// when the stream is running; while paused, requests just accumulate.
+class OgvSampleQueue
+{
+public:
+	typedef std::function<void(OgvSample &sample, const OgvSampleToken &token)> DeliverFunc;
+	typedef std::function<void()> EndFunc;
+
+	static const size_t DefaultPrerollDepth = 8;
+
+	explicit OgvSampleQueue(size_t prerollDepth = DefaultPrerollDepth);
+
+	void SetPrerollDepth(size_t prerollDepth);
+	size_t GetPrerollDepth() const;
+
+	// Returns false if the stream has already ended and every sample has gone out.
+	bool Request(const OgvSampleToken &token);
+
+	// Demuxer side.
+	void Push(OgvSample &&sample);
+	void EndOfStream();
+
+	// Drops queued samples and clears the end of stream, for a seek. Pending
+	// requests stay, to be answered from the new position.
+	void Flush();
+	// Drops pending requests as well, for a stop.
+	void Clear();
+
+	// True while fewer samples are queued than requested plus the preroll depth.
+	bool NeedsData() const;
+	// True once the preroll depth is queued, or the stream has ended.
+	bool IsPrerolled() const;
+	// True once the end of stream has been dispatched.
+	bool IsEnded() const;
+
+	// Hands out samples for as many pending requests as can be answered,
+	// then signals end of stream once, when the last sample has gone and
+	// a request is still waiting.
+	void Dispatch(const DeliverFunc &deliver, const EndFunc &end);
+
+	size_t GetQueuedSamples() const;
+	size_t GetPendingRequests() const;
+
+private:
+	OgvSampleQueue(const OgvSampleQueue &);
+	OgvSampleQueue &operator=(const OgvSampleQueue &);
+
+	mutable std::mutex m_mutex;
+	// Held across a whole Dispatch so concurrent callers can't reorder deliveries.
+	std::mutex m_dispatchMutex;
+
+	size_t m_prerollDepth;
+	std::deque<OgvSample> m_samples;
+	std::deque<OgvSampleToken> m_requests;
+	bool m_endOfStream;
+	bool m_ended;
+};
@@ -0,0 +1,755 @@
+#include "pch.h"
+
+#include "OgvSeekIndex.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Bytes fetched per read. Small enough to be cheap over a network, big
+// enough to hold a few pages so a bisection probe is usually one read.
+static const size_t ReadSize = 64 * 1024;
+
+// Once the bisection range is this small, scanning it is cheaper than probing.
+static const uint64_t BisectWindow = 64 * 1024;
+
+// First window scanned for the last pages of the streams. Usually all of
+// them end within it; if not, it doubles.
+static const uint64_t TailWindow = 64 * 1024;
+
+static const uint8_t SerializedMagic[8] = { 'O', 'G', 'V', 'I', 'D', 'X', '0', '2' };
+
+double OgvIndexedStream::GranuleTime(int64_t granulepos) const
+{
+	switch (type)
+	{
+	case OGV_STREAM_THEORA:
+		return OgvTheoraGranuleTime(theora, granulepos);
+	case OGV_STREAM_VORBIS:
+		return OgvVorbisGranuleTime(vorbis, granulepos);
+	default:
+		return 0.0;
+	}
+}
+
+OgvSeekIndex::OgvSeekIndex() :
+	m_length(0),
+	m_dataOffset(0),
+	m_open(false),
+	m_hasSkeletonIndex(false),
+	m_readCount(0),
+	m_duration(-1.0),
+	m_bufferOffset(0)
+{
+}
+
+OgvIndexedStream *OgvSeekIndex::FindStream(uint32_t serialno)
+{
+	for (auto &stream : m_streams)
+	{
+		if (stream.serialno == serialno)
+		{
+			return &stream;
+		}
+	}
+	return nullptr;
+}
+
+OgvIndexedStream *OgvSeekIndex::FindStream(OgvStreamType type)
+{
+	for (auto &stream : m_streams)
+	{
+		if (stream.type == type)
+		{
+			return &stream;
+		}
+	}
+	return nullptr;
+}
+
+bool OgvSeekIndex::Open(const OgvReadFunc &read, uint64_t length, const OgvViewFunc &view)
+{
+	m_read = read;
+	m_view = view;
+	m_length = length;
+	m_open = false;
+	m_duration = -1.0;
+	m_streams.clear();
+	m_keyframes.clear();
+	m_buffer.clear();
+
+	std::map<uint32_t, OggPacketAssembler> assemblers;
+	std::map<uint32_t, int> headersSeen;
+	std::map<uint32_t, bool> headersDone;
+
+	uint64_t offset = 0;
+	while (offset < m_length && offset < OgvMaxHeaderBytes)
+	{
+		OggPageHeader header;
+		const uint8_t *page;
+		if (!ReadPage(offset, header, page))
+		{
+			return false;
+		}
+
+		if (header.IsBOS())
+		{
+			OgvIndexedStream stream;
+			memset(&stream.theora, 0, sizeof(stream.theora));
+			memset(&stream.vorbis, 0, sizeof(stream.vorbis));
+			stream.serialno = header.serialno;
+			stream.type = OGV_STREAM_UNKNOWN;
+			m_streams.push_back(stream);
+			headersDone[header.serialno] = false;
+		}
+
+		OgvIndexedStream *stream = FindStream(header.serialno);
+		if (stream != nullptr && !headersDone[header.serialno])
+		{
+			auto &assembler = assemblers[header.serialno];
+			assembler.PushPage(page, header);
+
+			OggPacket packet;
+			while (assembler.PopPacket(packet))
+			{
+				const uint8_t *data = packet.data.data();
+				size_t size = packet.data.size();
+				int &seen = headersSeen[header.serialno];
+
+				if (seen == 0)
+				{
+					stream->type = OgvIdentifyStream(data, size);
+					if (stream->type == OGV_STREAM_THEORA && !OgvParseTheoraIdent(data, size, stream->theora))
+					{
+						stream->type = OGV_STREAM_UNKNOWN;
+					}
+					if (stream->type == OGV_STREAM_VORBIS && !OgvParseVorbisIdent(data, size, stream->vorbis))
+					{
+						stream->type = OGV_STREAM_UNKNOWN;
+					}
+				}
+				else if (stream->type == OGV_STREAM_SKELETON)
+				{
+					ParseSkeletonPacket(data, size);
+				}
+				seen++;
+
+				switch (stream->type)
+				{
+				case OGV_STREAM_THEORA:
+				case OGV_STREAM_VORBIS:
+					// Identification, comment and setup headers.
+					headersDone[header.serialno] = seen >= 3;
+					break;
+				case OGV_STREAM_SKELETON:
+					headersDone[header.serialno] = packet.eos;
+					break;
+				default:
+					// Nothing we can use; don't wait on it.
+					headersDone[header.serialno] = true;
+					break;
+				}
+			}
+		}
+
+		offset += header.PageSize();
+
+		bool allDone = !m_streams.empty();
+		for (auto &entry : headersDone)
+		{
+			allDone = allDone && entry.second;
+		}
+		if (allDone && !header.IsBOS())
+		{
+			break;
+		}
+	}
+
+	m_dataOffset = offset;
+	m_open = FindStream(OGV_STREAM_THEORA) != nullptr || FindStream(OGV_STREAM_VORBIS) != nullptr;
+	return m_open;
+}
+
+double OgvSeekIndex::GetDuration()
+{
+	if (!m_open)
+	{
+		return 0.0;
+	}
+	if (m_duration >= 0.0)
+	{
+		return m_duration;
+	}
+
+	size_t wanted = 0;
+	for (auto &stream : m_streams)
+	{
+		wanted += stream.type == OGV_STREAM_THEORA || stream.type == OGV_STREAM_VORBIS ? 1 : 0;
+	}
+
+	// Last granulepos of each stream, from the latest window it appears in.
+	std::map<uint32_t, int64_t> last;
+	uint64_t end = m_length;
+	uint64_t window = TailWindow;
+	while (end > m_dataOffset && last.size() < wanted)
+	{
+		uint64_t start = end - std::min(window, end - m_dataOffset);
+		std::map<uint32_t, int64_t> inWindow;
+
+		uint64_t pos = start;
+		while (pos < end)
+		{
+			const uint8_t *data;
+			size_t available = EnsureBuffered(pos, OggPageMinHeaderSize + 255, data);
+			if (available < 4)
+			{
+				break;
+			}
+			size_t skip = OggFindCapture(data, available);
+			if (skip == available)
+			{
+				pos += available - 3;
+				continue;
+			}
+			pos += skip;
+			if (pos >= end)
+			{
+				break;
+			}
+
+			OggPageHeader header;
+			const uint8_t *page;
+			if (!ReadPage(pos, header, page, true))
+			{
+				pos++;
+				continue;
+			}
+			RecordPage(pos, header);
+			OgvIndexedStream *stream = FindStream(header.serialno);
+			if (stream != nullptr && header.granulepos != -1 &&
+				(stream->type == OGV_STREAM_THEORA || stream->type == OGV_STREAM_VORBIS))
+			{
+				inWindow[header.serialno] = header.granulepos;
+			}
+			pos += header.PageSize();
+		}
+
+		// Later windows already hold the true ends of the streams they found.
+		for (auto &entry : inWindow)
+		{
+			last.insert(entry);
+		}
+		end = start;
+		window *= 2;
+	}
+
+	m_duration = 0.0;
+	for (auto &entry : last)
+	{
+		const OgvIndexedStream &stream = *FindStream(entry.first);
+		double streamEnd;
+		if (stream.type == OGV_STREAM_THEORA)
+		{
+			// Granule times are frame start times; the last frame lasts one more.
+			double frame = stream.theora.fpsNumerator ? static_cast<double>(stream.theora.fpsDenominator) / stream.theora.fpsNumerator : 0.0;
+			streamEnd = stream.GranuleTime(entry.second) + frame;
+		}
+		else
+		{
+			streamEnd = stream.GranuleTime(entry.second);
+		}
+		m_duration = std::max(m_duration, streamEnd);
+	}
+	return m_duration;
+}
+
+// Skeleton 4.0 index packets list keypoints for one stream as pairs of
+// variable-length deltas: byte offset, then time numerator.
+void OgvSeekIndex::ParseSkeletonPacket(const uint8_t *packet, size_t length)
+{
+	static const size_t IndexHeaderSize = 42;
+	if (length < IndexHeaderSize || memcmp(packet, "index\0", 6) != 0)
+	{
+		return;
+	}
+
+	OgvIndexedStream *stream = FindStream(OggReadLE32(packet + 6));
+	uint64_t count = OggReadLE64(packet + 10);
+	int64_t denominator = static_cast<int64_t>(OggReadLE64(packet + 18));
+	if (stream == nullptr || denominator <= 0)
+	{
+		return;
+	}
+
+	const uint8_t *p = packet + IndexHeaderSize;
+	const uint8_t *end = packet + length;
+	uint64_t offset = 0;
+	int64_t numerator = 0;
+
+	auto readVarint = [&p, end](uint64_t &value) -> bool {
+		value = 0;
+		for (int shift = 0; p < end && shift < 64; shift += 7)
+		{
+			uint8_t byte = *p++;
+			value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			if (byte & 0x80)
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+
+	stream->keypoints.clear();
+	for (uint64_t i = 0; i < count; i++)
+	{
+		uint64_t offsetDelta, timeDelta;
+		if (!readVarint(offsetDelta) || !readVarint(timeDelta))
+		{
+			break;
+		}
+		offset += offsetDelta;
+		numerator += static_cast<int64_t>(timeDelta);
+
+		OgvKeypoint keypoint;
+		keypoint.offset = offset;
+		keypoint.time = static_cast<double>(numerator) / denominator;
+		stream->keypoints.push_back(keypoint);
+	}
+	m_hasSkeletonIndex = m_hasSkeletonIndex || !stream->keypoints.empty();
+}
+
+size_t OgvSeekIndex::EnsureBuffered(uint64_t offset, size_t length, const uint8_t *&data)
+{
+	if (offset >= m_length)
+	{
+		return 0;
+	}
+	if (offset + length > m_length)
+	{
+		length = static_cast<size_t>(m_length - offset);
+	}
+
+	if (m_view)
+	{
+		return m_view(offset, length, data);
+	}
+
+	// Hand back whatever is already buffered past offset, as long as it
+	// covers the minimum asked for.
+	bool hit = offset >= m_bufferOffset && offset + length <= m_bufferOffset + m_buffer.size();
+	if (!hit)
+	{
+		size_t want = std::max(length, ReadSize);
+		if (offset + want > m_length)
+		{
+			want = static_cast<size_t>(m_length - offset);
+		}
+		m_buffer.resize(want);
+		size_t got = m_read(offset, m_buffer.data(), want);
+		m_buffer.resize(got);
+		m_bufferOffset = offset;
+		m_readCount++;
+	}
+
+	data = m_buffer.data() + (offset - m_bufferOffset);
+	return static_cast<size_t>(m_bufferOffset + m_buffer.size() - offset);
+}
+
+bool OgvSeekIndex::ReadPage(uint64_t offset, OggPageHeader &header, const uint8_t *&page, bool scanned)
+{
+	size_t available = EnsureBuffered(offset, OggPageMinHeaderSize + 255, page);
+	if (OggParsePageHeader(page, available, header) != OGG_PAGE_OK)
+	{
+		return false;
+	}
+	// A little extra, to see whether another page follows.
+	available = EnsureBuffered(offset, header.PageSize() + 4, page);
+	if (available < header.PageSize())
+	{
+		return false;
+	}
+	// Refilling the buffer moved the page; re-point the lacing table.
+	header.lacing = page + OggPageMinHeaderSize;
+	if (scanned && !OggPagePlausible(page, available, header))
+	{
+		return false;
+	}
+	return OggVerifyPage(page, header);
+}
+
+void OgvSeekIndex::RecordPage(uint64_t offset, const OggPageHeader &header)
+{
+	if (header.granulepos == -1)
+	{
+		return;
+	}
+	OgvIndexedStream *stream = FindStream(header.serialno);
+	if (stream == nullptr)
+	{
+		return;
+	}
+	OgvPageInfo info;
+	info.offset = offset;
+	info.size = static_cast<uint32_t>(header.PageSize());
+	info.granulepos = header.granulepos;
+	stream->pages[offset] = info;
+}
+
+// Finds the first valid page of the given stream with a granulepos that
+// starts in [from, limit), resynchronizing on capture patterns as needed.
+bool OgvSeekIndex::FindPageForward(uint64_t from, uint64_t limit, uint32_t serialno, OgvPageInfo &found)
+{
+	uint64_t pos = from;
+	while (pos < limit)
+	{
+		const uint8_t *data;
+		size_t available = EnsureBuffered(pos, OggPageMinHeaderSize + 255, data);
+		if (available < 4)
+		{
+			return false;
+		}
+
+		size_t skip = OggFindCapture(data, available);
+		if (skip == available)
+		{
+			// Keep the last bytes in case the pattern straddles the boundary.
+			pos += available - 3;
+			continue;
+		}
+		pos += skip;
+		if (pos >= limit)
+		{
+			return false;
+		}
+
+		OggPageHeader header;
+		const uint8_t *page;
+		if (!ReadPage(pos, header, page, true))
+		{
+			// False capture inside packet data, or a damaged page.
+			pos++;
+			continue;
+		}
+
+		RecordPage(pos, header);
+		if (header.serialno == serialno && header.granulepos != -1)
+		{
+			found.offset = pos;
+			found.size = static_cast<uint32_t>(header.PageSize());
+			found.granulepos = header.granulepos;
+			return true;
+		}
+		pos += header.PageSize();
+	}
+	return false;
+}
+
+// Finds the last page of the stream whose granulepos satisfies before(),
+// assuming granule positions only increase through the file.
+bool OgvSeekIndex::FindLastPage(const OgvIndexedStream &stream, const GranulePredicate &before, OgvPageInfo &found)
+{
+	uint64_t lo = m_dataOffset;
+	uint64_t hi = m_length;
+	bool haveFound = false;
+
+	// Narrow the range with what earlier seeks already learned.
+	for (auto &entry : stream.pages)
+	{
+		const OgvPageInfo &page = entry.second;
+		if (before(page.granulepos))
+		{
+			if (page.offset >= lo)
+			{
+				found = page;
+				haveFound = true;
+				lo = page.offset + page.size;
+			}
+		}
+		else if (page.offset < hi)
+		{
+			hi = page.offset;
+			break;
+		}
+	}
+
+	while (hi > lo && hi - lo > BisectWindow)
+	{
+		uint64_t mid = lo + (hi - lo) / 2;
+		OgvPageInfo page;
+		if (!FindPageForward(mid, hi, stream.serialno, page))
+		{
+			hi = mid;
+		}
+		else if (before(page.granulepos))
+		{
+			found = page;
+			haveFound = true;
+			lo = page.offset + page.size;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	OgvPageInfo page;
+	while (lo < hi && FindPageForward(lo, hi, stream.serialno, page) && before(page.granulepos))
+	{
+		found = page;
+		haveFound = true;
+		lo = page.offset + page.size;
+	}
+	return haveFound;
+}
+
+bool OgvSeekIndex::SeekWithKeypoints(double time, OgvSeekTarget &target) const
+{
+	bool haveTarget = false;
+	target.offset = m_length;
+	target.keyframeTime = 0.0;
+	target.keyframeGranule = -1;
+
+	// Every indexed stream must be able to start at or before the target.
+	for (auto &stream : m_streams)
+	{
+		if (stream.keypoints.empty())
+		{
+			continue;
+		}
+		const OgvKeypoint *best = nullptr;
+		for (auto &keypoint : stream.keypoints)
+		{
+			if (keypoint.time > time)
+			{
+				break;
+			}
+			best = &keypoint;
+		}
+		if (best == nullptr)
+		{
+			target.offset = m_dataOffset;
+			return true;
+		}
+		if (best->offset < target.offset)
+		{
+			target.offset = best->offset;
+		}
+		if (stream.type == OGV_STREAM_THEORA)
+		{
+			target.keyframeTime = best->time;
+		}
+		haveTarget = true;
+	}
+	return haveTarget;
+}
+
+bool OgvSeekIndex::Seek(double time, OgvSeekTarget &target)
+{
+	if (!m_open)
+	{
+		return false;
+	}
+
+	target.offset = m_dataOffset;
+	target.keyframeTime = 0.0;
+	target.keyframeGranule = -1;
+
+	if (time <= 0.0)
+	{
+		return true;
+	}
+	if (m_hasSkeletonIndex && SeekWithKeypoints(time, target))
+	{
+		return true;
+	}
+
+	OgvIndexedStream *video = FindStream(OGV_STREAM_THEORA);
+	OgvIndexedStream *audio = FindStream(OGV_STREAM_VORBIS);
+	double audioTime = time;
+	uint64_t offset = m_length;
+
+	if (video != nullptr)
+	{
+		// The last page at or before the target tells us which keyframe
+		// decoding has to restart from.
+		OgvPageInfo page;
+		int64_t keyframe = 0;
+		if (FindLastPage(*video, [video, time](int64_t granulepos) {
+			return video->GranuleTime(granulepos) <= time;
+		}, page))
+		{
+			keyframe = OgvTheoraKeyframeGranule(video->theora, page.granulepos);
+		}
+
+		uint64_t videoOffset = m_dataOffset;
+		auto cached = m_keyframes.find(keyframe);
+		if (cached != m_keyframes.end())
+		{
+			videoOffset = cached->second;
+		}
+		else if (keyframe > 0)
+		{
+			// The keyframe begins after the last page holding only earlier
+			// frames, unless that page ends partway through a packet: then
+			// the packet it starts may be the keyframe itself.
+			OgvPageInfo before;
+			if (FindLastPage(*video, [video, keyframe](int64_t granulepos) {
+				return OgvTheoraFrameCount(video->theora, granulepos) < keyframe;
+			}, before))
+			{
+				OggPageHeader header;
+				const uint8_t *page;
+				bool endsWithPacket = ReadPage(before.offset, header, page) &&
+					header.segments > 0 && header.lacing[header.segments - 1] < 255;
+				videoOffset = endsWithPacket ? before.offset + before.size : before.offset;
+			}
+			m_keyframes[keyframe] = videoOffset;
+		}
+
+		int64_t keyframeGranule = keyframe << video->theora.keyframeShift;
+		target.keyframeGranule = keyframeGranule;
+		target.keyframeTime = keyframe > 0 ? video->GranuleTime(keyframeGranule) : 0.0;
+		audioTime = std::min(time, target.keyframeTime);
+		offset = videoOffset;
+	}
+
+	if (audio != nullptr)
+	{
+		// Start on the page ending just before the audio we need, so the
+		// decoder has the previous packet to overlap with.
+		uint64_t audioOffset = m_dataOffset;
+		OgvPageInfo page;
+		if (FindLastPage(*audio, [audio, audioTime](int64_t granulepos) {
+			return audio->GranuleTime(granulepos) < audioTime;
+		}, page))
+		{
+			audioOffset = page.offset;
+		}
+		offset = std::min(offset, audioOffset);
+	}
+
+	target.offset = std::min(offset, m_length);
+	return true;
+}
+
+static void WriteLE32(std::vector<uint8_t> &out, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+	}
+}
+
+static void WriteLE64(std::vector<uint8_t> &out, uint64_t value)
+{
+	WriteLE32(out, static_cast<uint32_t>(value));
+	WriteLE32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void OgvSeekIndex::Serialize(std::vector<uint8_t> &out) const
+{
+	out.assign(SerializedMagic, SerializedMagic + sizeof(SerializedMagic));
+	WriteLE64(out, m_length);
+	WriteLE64(out, m_dataOffset);
+
+	WriteLE32(out, static_cast<uint32_t>(m_streams.size()));
+	for (auto &stream : m_streams)
+	{
+		WriteLE32(out, stream.serialno);
+		WriteLE32(out, static_cast<uint32_t>(stream.pages.size()));
+		for (auto &entry : stream.pages)
+		{
+			WriteLE64(out, entry.second.offset);
+			WriteLE32(out, entry.second.size);
+			WriteLE64(out, static_cast<uint64_t>(entry.second.granulepos));
+		}
+	}
+
+	WriteLE32(out, static_cast<uint32_t>(m_keyframes.size()));
+	for (auto &entry : m_keyframes)
+	{
+		WriteLE64(out, static_cast<uint64_t>(entry.first));
+		WriteLE64(out, entry.second);
+	}
+
+	// In 100ns units, or -1 if the tail hasn't been scanned.
+	int64_t duration = m_duration >= 0.0 ? static_cast<int64_t>(m_duration * 10000000.0 + 0.5) : -1;
+	WriteLE64(out, static_cast<uint64_t>(duration));
+}
+
+bool OgvSeekIndex::Deserialize(const uint8_t *data, size_t length)
+{
+	const uint8_t *p = data;
+	const uint8_t *end = data + length;
+	auto have = [&p, end](size_t n) { return static_cast<size_t>(end - p) >= n; };
+
+	if (!m_open || !have(sizeof(SerializedMagic) + 20) || memcmp(p, SerializedMagic, sizeof(SerializedMagic)) != 0)
+	{
+		return false;
+	}
+	p += sizeof(SerializedMagic);
+
+	// Refuse state from a different or modified file.
+	if (OggReadLE64(p) != m_length || OggReadLE64(p + 8) != m_dataOffset)
+	{
+		return false;
+	}
+	p += 16;
+
+	std::map<uint32_t, std::map<uint64_t, OgvPageInfo>> pages;
+	std::map<int64_t, uint64_t> keyframes;
+
+	uint32_t streamCount = OggReadLE32(p);
+	p += 4;
+	for (uint32_t i = 0; i < streamCount; i++)
+	{
+		if (!have(8))
+		{
+			return false;
+		}
+		uint32_t serialno = OggReadLE32(p);
+		uint32_t pageCount = OggReadLE32(p + 4);
+		p += 8;
+		if (FindStream(serialno) == nullptr || !have(static_cast<size_t>(pageCount) * 20))
+		{
+			return false;
+		}
+		auto &streamPages = pages[serialno];
+		for (uint32_t j = 0; j < pageCount; j++, p += 20)
+		{
+			OgvPageInfo info;
+			info.offset = OggReadLE64(p);
+			info.size = OggReadLE32(p + 8);
+			info.granulepos = static_cast<int64_t>(OggReadLE64(p + 12));
+			streamPages[info.offset] = info;
+		}
+	}
+
+	if (!have(4))
+	{
+		return false;
+	}
+	uint32_t keyframeCount = OggReadLE32(p);
+	p += 4;
+	if (!have(static_cast<size_t>(keyframeCount) * 16 + 8))
+	{
+		return false;
+	}
+	for (uint32_t i = 0; i < keyframeCount; i++, p += 16)
+	{
+		keyframes[static_cast<int64_t>(OggReadLE64(p))] = OggReadLE64(p + 8);
+	}
+	int64_t duration = static_cast<int64_t>(OggReadLE64(p));
+
+	// Only commit once the whole blob has checked out.
+	for (auto &entry : pages)
+	{
+		FindStream(entry.first)->pages.insert(entry.second.begin(), entry.second.end());
+	}
+	m_keyframes.insert(keyframes.begin(), keyframes.end());
+	if (duration >= 0 && m_duration < 0.0)
+	{
+		m_duration = duration / 10000000.0;
+	}
+	return true;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "OggPage.h"
+#include "OggCodecHeaders.h"
+
+// Reads up to length bytes at offset into buffer, returning the count read.
+// Returns 0 at end of stream or on error.
+typedef std::function<size_t(uint64_t offset, uint8_t *buffer, size_t length)> OgvReadFunc;
+
+// Open gives up looking for the end of the headers after this much data,
+// so it is also the most that has to be read to know whether a file will open.
+static const uint64_t OgvMaxHeaderBytes = 16 * 1024 * 1024;
+
+// Points data at the bytes at offset in place, without copying, and returns
+// how many contiguous bytes are there: at least length unless the stream
+// ends first, 0 on error. data stays valid until the next call.
+typedef std::function<size_t(uint64_t offset, size_t length, const uint8_t *&data)> OgvViewFunc;
+
+struct OgvPageInfo
+{
+	uint64_t offset;
+	uint32_t size;
+	int64_t granulepos;
+};
+
+// A place playback can start from, as listed in a Skeleton index.
+struct OgvKeypoint
+{
+	uint64_t offset;
+	double time;
+};
+
+struct OgvIndexedStream
+{
+	uint32_t serialno;
+	OgvStreamType type;
+	OgvTheoraInfo theora;
+	OgvVorbisInfo vorbis;
+
+	// Pages seen so far, keyed by byte offset. Only pages with a granulepos
+	// are recorded, as the others say nothing about position.
+	std::map<uint64_t, OgvPageInfo> pages;
+
+	// From the Skeleton index, if the file has one.
+	std::vector<OgvKeypoint> keypoints;
+
+	double GranuleTime(int64_t granulepos) const;
+};
+
+struct OgvSeekTarget
+{
+	uint64_t offset;			// page boundary to resume demuxing from
+	double keyframeTime;		// time of the video keyframe decoding restarts at
+	int64_t keyframeGranule;	// -1 if there is no video
+};
+
+// Maps times to byte offsets over an Ogg physical stream so seeking costs a
+// handful of reads instead of a linear scan.
+//
+// Open parses the stream headers, including a Skeleton index if present.
+// Without one, Seek bisects the file on page granule positions; every page
+// it touches is remembered, so later seeks start from a narrower range, and
+// resolved Theora keyframes are cached outright. The learned state can be
+// serialized and handed back on the next open of the same file.
+class OgvSeekIndex
+{
+public:
+	OgvSeekIndex();
+
+	// With a view, pages are parsed in place and read is not used.
+	bool Open(const OgvReadFunc &read, uint64_t length, const OgvViewFunc &view = OgvViewFunc());
+	bool IsOpen() const { return m_open; }
+
+	uint64_t GetLength() const { return m_length; }
+	uint64_t GetDataOffset() const { return m_dataOffset; }
+	const std::vector<OgvIndexedStream> &GetStreams() const { return m_streams; }
+	bool HasSkeletonIndex() const { return m_hasSkeletonIndex; }
+
+	bool Seek(double time, OgvSeekTarget &target);
+
+	// Seconds to the end of the longest stream, from the last granulepos of
+	// each. Found by scanning back from the end of the file, a growing
+	// window at a time, on first call. 0 if no stream's end turns up.
+	double GetDuration();
+
+	// Reads issued against the byte source so far.
+	uint64_t GetReadCount() const { return m_readCount; }
+
+	void Serialize(std::vector<uint8_t> &out) const;
+	// Merges previously serialized state. Must follow a successful Open of the same file.
+	bool Deserialize(const uint8_t *data, size_t length);
+
+private:
+	typedef std::function<bool(int64_t granulepos)> GranulePredicate;
+
+	// Makes at least length bytes at offset available (fewer at end of file),
+	// returning how many contiguous bytes data points to.
+	size_t EnsureBuffered(uint64_t offset, size_t length, const uint8_t *&data);
+	// Pages found by scanning for a capture pattern get extra checks.
+	bool ReadPage(uint64_t offset, OggPageHeader &header, const uint8_t *&page, bool scanned = false);
+	bool FindPageForward(uint64_t from, uint64_t limit, uint32_t serialno, OgvPageInfo &found);
+	bool FindLastPage(const OgvIndexedStream &stream, const GranulePredicate &before, OgvPageInfo &found);
+	bool SeekWithKeypoints(double time, OgvSeekTarget &target) const;
+	void RecordPage(uint64_t offset, const OggPageHeader &header);
+	void ParseSkeletonPacket(const uint8_t *packet, size_t length);
+
+	OgvIndexedStream *FindStream(uint32_t serialno);
+	OgvIndexedStream *FindStream(OgvStreamType type);
+
+	OgvReadFunc m_read;
+	OgvViewFunc m_view;
+	uint64_t m_length;
+	uint64_t m_dataOffset;
+	bool m_open;
+	bool m_hasSkeletonIndex;
+	uint64_t m_readCount;
+	double m_duration;		// negative until worked out
+
+	std::vector<OgvIndexedStream> m_streams;
+
+	// Theora keyframe granule -> offset to start demuxing at for it.
+	std::map<int64_t, uint64_t> m_keyframes;
+
+	std::vector<uint8_t> m_buffer;
+	uint64_t m_bufferOffset;
+};
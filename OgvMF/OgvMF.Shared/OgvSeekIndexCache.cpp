@@ -0,0 +1,121 @@
+#include "pch.h"
+
+#include "OgvSeekIndexCache.h"
+
+#include <cstring>
+
+// A serialized index runs to a few kilobytes per file, so this holds hundreds.
+static const size_t SharedCacheBytes = 2 * 1024 * 1024;
+
+// Created on first use and never destroyed. Not a function-local static
+// because those aren't initialized thread-safely by every compiler we build with.
+static std::once_flag s_sharedOnce;
+static OgvSeekIndexCache *s_shared = nullptr;
+
+static const uint64_t FnvOffset = 14695981039346656037ULL;
+static const uint64_t FnvPrime = 1099511628211ULL;
+
+static uint64_t HashBytes(uint64_t hash, const uint8_t *data, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		hash = (hash ^ data[i]) * FnvPrime;
+	}
+	return hash;
+}
+
+static uint64_t HashValue(uint64_t hash, uint64_t value)
+{
+	uint8_t bytes[8];
+	for (int i = 0; i < 8; i++)
+	{
+		bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+	}
+	return HashBytes(hash, bytes, sizeof(bytes));
+}
+
+OgvSeekIndexCache::OgvSeekIndexCache(size_t maxBytes) :
+	m_maxBytes(maxBytes)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+OgvSeekIndexCache &OgvSeekIndexCache::Shared()
+{
+	std::call_once(s_sharedOnce, [] {
+		s_shared = new OgvSeekIndexCache(SharedCacheBytes);
+	});
+	return *s_shared;
+}
+
+OgvSeekIndexCache::Key OgvSeekIndexCache::MakeKey(uint64_t length, const std::vector<const std::vector<std::vector<uint8_t>> *> &headers)
+{
+	// FNV-1a. A collision only costs a rejected Deserialize, which checks
+	// the length and header size itself.
+	uint64_t hash = HashValue(FnvOffset, length);
+	for (auto stream : headers)
+	{
+		hash = HashValue(hash, stream->size());
+		for (auto &packet : *stream)
+		{
+			hash = HashValue(hash, packet.size());
+			hash = HashBytes(hash, packet.data(), packet.size());
+		}
+	}
+	return hash;
+}
+
+bool OgvSeekIndexCache::Lookup(Key key, std::vector<uint8_t> &serialized)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto found = m_index.find(key);
+	if (found == m_index.end())
+	{
+		m_stats.misses++;
+		return false;
+	}
+	m_stats.hits++;
+	m_entries.splice(m_entries.begin(), m_entries, found->second);
+	serialized = found->second->second;
+	return true;
+}
+
+void OgvSeekIndexCache::Store(Key key, const std::vector<uint8_t> &serialized)
+{
+	if (serialized.size() > m_maxBytes)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto found = m_index.find(key);
+	if (found != m_index.end())
+	{
+		Remove(found->second);
+	}
+
+	m_entries.push_front(std::make_pair(key, serialized));
+	m_index[key] = m_entries.begin();
+	m_stats.bytes += serialized.size();
+	m_stats.entries++;
+
+	while (m_stats.bytes > m_maxBytes)
+	{
+		Remove(std::prev(m_entries.end()));
+		m_stats.evictions++;
+	}
+}
+
+OgvSeekIndexCacheStats OgvSeekIndexCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void OgvSeekIndexCache::Remove(EntryList::iterator entry)
+{
+	m_stats.bytes -= entry->second.size();
+	m_stats.entries--;
+	m_index.erase(entry->first);
+	m_entries.erase(entry);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct OgvSeekIndexCacheStats
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	size_t entries;
+	size_t bytes;
+};
+
+// Remembers the seek indexes of files opened earlier in the process, as
+// serialized by OgvSeekIndex, so opening one again skips the work: its
+// duration, found by scanning the tail, and the pages and keyframes its
+// seeks located. Decoder setup isn't cached; the codec headers are parsed
+// again on every open.
+//
+// Entries are keyed by a hash of the file's length and header packets,
+// which are read on every open anyway, so the file doesn't need a name.
+// The least recently used are dropped once the total size passes a bound.
+class OgvSeekIndexCache
+{
+public:
+	typedef uint64_t Key;
+
+	explicit OgvSeekIndexCache(size_t maxBytes);
+
+	// Process-wide cache, created on first use.
+	static OgvSeekIndexCache &Shared();
+
+	// Header packets of each stream, in stream order.
+	static Key MakeKey(uint64_t length, const std::vector<const std::vector<std::vector<uint8_t>> *> &headers);
+
+	bool Lookup(Key key, std::vector<uint8_t> &serialized);
+	void Store(Key key, const std::vector<uint8_t> &serialized);
+
+	OgvSeekIndexCacheStats GetStats() const;
+
+private:
+	OgvSeekIndexCache(const OgvSeekIndexCache &);
+	OgvSeekIndexCache &operator=(const OgvSeekIndexCache &);
+
+	typedef std::list<std::pair<Key, std::vector<uint8_t>>> EntryList;
+
+	void Remove(EntryList::iterator entry);
+
+	size_t m_maxBytes;
+	mutable std::mutex m_mutex;
+	EntryList m_entries;		// most recently used first
+	std::map<Key, EntryList::iterator> m_index;
+	OgvSeekIndexCacheStats m_stats;
+};
@@ -3,6 +3,20 @@
 #include "OgvSource.h"
 #include "OgvStream.h"
 
+// Compressed subtypes for the two codecs, built from FourCCs the usual way.
+// Playback needs Theora and Vorbis decoders registered for these.
+static const GUID MFVideoFormat_Theora = { FCC('theo'), 0x0000, 0x0010, { 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71 } };
+static const GUID MFAudioFormat_Vorbis = { FCC('vorb'), 0x0000, 0x0010, { 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71 } };
+
+// Block cache in front of the byte stream: room for a couple of megabytes,
+// fetching half a megabyte ahead of the demuxer.
+static const size_t ByteCacheBlocks = 32;
+static const size_t ByteCacheReadAheadBlocks = 8;
+
+// Samples kept demuxed ahead of the requests, per stream.
+static const size_t VideoPrerollDepth = 4;
+static const size_t AudioPrerollDepth = 16;
+
 ComPtr<OgvSource> OgvSource::CreateInstance()
 {
 	ComPtr<OgvSource> spSource = Make<OgvSource>();
@@ -12,7 +26,7 @@ ComPtr<OgvSource> OgvSource::CreateInstance()
 	return spSource;
 }
 
-concurrency::task<void> OgvSource::OpenAsync(IMFByteStream *pStream)
+concurrency::task<void> OgvSource::OpenAsync(IMFByteStream *pStream, LPCWSTR pwszURL)
 {
 	if (pStream == nullptr)
 	{
@@ -41,14 +55,315 @@ concurrency::task<void> OgvSource::OpenAsync(IMFByteStream *pStream)
 		ThrowException(MF_E_UNSUPPORTED_BYTESTREAM_TYPE);
 	}
 
+	std::wstring url(pwszURL != nullptr ? pwszURL : L"");
+
+	QWORD length = 0;
+	ThrowIfError(pStream->GetLength(&length));
+	if ((length == 0 || length == static_cast<QWORD>(-1)) && !OgvHttpByteSource::IsHttpUrl(url))
+	{
+		// Seeking needs to know where the file ends.
+		ThrowException(MF_E_UNSUPPORTED_BYTESTREAM_TYPE);
+	}
+
 	m_state = STATE_OPENING;
 
+	// Reading the headers blocks on the byte stream, so keep it off the caller's thread.
+	ComPtr<OgvSource> spThis(this);
+	concurrency::create_task([spThis, url] {
+		AutoLock lock(spThis->m_mutex);
+		if (spThis->m_state != STATE_OPENING)
+		{
+			return;
+		}
+
+		try
+		{
+			if (!spThis->OpenByteSource(url))
+			{
+				ThrowException(MF_E_UNSUPPORTED_BYTESTREAM_TYPE);
+			}
+			uint64_t length = spThis->m_byteSource->GetLength();
+			OgvReadFunc read = OgvByteSource::MakeReadFunc(spThis->m_byteSource);
+
+			// The URL is only a hint as to where the byte stream came from; if the
+			// file there isn't the same length, don't trust it to be the same file.
+			OgvMappedFile &mapped = spThis->m_mappedFile;
+			if (!url.empty() && mapped.Open(url) && mapped.GetLength() != length)
+			{
+				mapped.Close();
+			}
+
+			if (!spThis->m_seekIndex.Open(read, length, mapped.CreateView()))
+			{
+				ThrowException(MF_E_INVALID_FILE_FORMAT);
+			}
+
+			spThis->m_demuxer.Open(read, length, spThis->m_seekIndex.GetStreams(), mapped.CreateView());
+			// Local files don't get damaged in transit.
+			spThis->m_demuxer.SetTrustChecksums(mapped.IsOpen());
+			if (!spThis->m_demuxer.ReadHeaders(spThis->m_seekIndex.GetDataOffset()))
+			{
+				ThrowException(MF_E_INVALID_FILE_FORMAT);
+			}
+
+			spThis->LoadSeekIndex();
+			spThis->InitPresentationDescriptor();
+			spThis->SaveSeekIndex();
+
+			spThis->m_state = STATE_STOPPED;
+			spThis->_openedEvent.set();
+		}
+		catch (Exception ^ex)
+		{
+			spThis->_openedEvent.set_exception(ex);
+		}
+	});
+
 	return concurrency::create_task(_openedEvent);
 }
 
+// Picks where the file's bytes come from: the byte stream we were opened
+// with if it knows its length, otherwise range requests to the URL.
+bool OgvSource::OpenByteSource(const std::wstring &url)
+{
+	std::shared_ptr<OgvByteSource> source;
+
+	auto stream = std::make_shared<OgvMFByteSource>();
+	if (stream->Open(m_spByteStream.Get()))
+	{
+		source = stream;
+	}
+	else if (OgvHttpByteSource::IsHttpUrl(url))
+	{
+		auto http = std::make_shared<OgvHttpByteSource>();
+		if (!http->Open(ref new Windows::Foundation::Uri(ref new Platform::String(url.c_str()))))
+		{
+			return false;
+		}
+		source = http;
+	}
+	else
+	{
+		return false;
+	}
+
+	m_byteSource = std::make_shared<OgvCachedByteSource>(source, ByteCacheBlocks, ByteCacheReadAheadBlocks);
+	return true;
+}
+
+// A file opened before starts out with its duration and seek points, and
+// doesn't have to scan its tail again.
+void OgvSource::LoadSeekIndex()
+{
+	std::vector<const std::vector<std::vector<uint8_t>> *> headers;
+	for (auto &stream : m_seekIndex.GetStreams())
+	{
+		headers.push_back(&m_demuxer.GetHeaders(stream.serialno));
+	}
+	m_seekIndexKey = OgvSeekIndexCache::MakeKey(m_seekIndex.GetLength(), headers);
+
+	std::vector<uint8_t> serialized;
+	if (OgvSeekIndexCache::Shared().Lookup(m_seekIndexKey, serialized))
+	{
+		(void)m_seekIndex.Deserialize(serialized.data(), serialized.size());
+	}
+}
+
+void OgvSource::SaveSeekIndex()
+{
+	if (m_seekIndex.IsOpen())
+	{
+		std::vector<uint8_t> serialized;
+		m_seekIndex.Serialize(serialized);
+		OgvSeekIndexCache::Shared().Store(m_seekIndexKey, serialized);
+	}
+}
+
+// Codec headers go in MF_MT_USER_DATA as a sequence of packets, each
+// preceded by its length as a 16-bit big-endian number.
+static void SetCodecHeaders(IMFMediaType *pType, const std::vector<std::vector<uint8_t>> &headers)
+{
+	std::vector<uint8_t> blob;
+	for (auto &header : headers)
+	{
+		if (header.size() > 0xffff)
+		{
+			ThrowException(MF_E_INVALID_FILE_FORMAT);
+		}
+		blob.push_back(static_cast<uint8_t>(header.size() >> 8));
+		blob.push_back(static_cast<uint8_t>(header.size()));
+		blob.insert(blob.end(), header.begin(), header.end());
+	}
+	ThrowIfError(pType->SetBlob(MF_MT_USER_DATA, blob.data(), static_cast<UINT32>(blob.size())));
+}
+
+void OgvSource::InitPresentationDescriptor()
+{
+	std::vector<ComPtr<IMFStreamDescriptor>> descriptors;
+
+	for (auto &info : m_seekIndex.GetStreams())
+	{
+		ComPtr<IMFMediaType> spType;
+		ThrowIfError(MFCreateMediaType(&spType));
+
+		if (info.type == OGV_STREAM_THEORA)
+		{
+			ThrowIfError(spType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video));
+			ThrowIfError(spType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_Theora));
+			ThrowIfError(MFSetAttributeSize(spType.Get(), MF_MT_FRAME_SIZE, info.theora.pictureWidth, info.theora.pictureHeight));
+			ThrowIfError(MFSetAttributeRatio(spType.Get(), MF_MT_FRAME_RATE, info.theora.fpsNumerator, info.theora.fpsDenominator));
+			ThrowIfError(MFSetAttributeRatio(spType.Get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1));
+			ThrowIfError(spType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive));
+		}
+		else if (info.type == OGV_STREAM_VORBIS)
+		{
+			ThrowIfError(spType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Audio));
+			ThrowIfError(spType->SetGUID(MF_MT_SUBTYPE, MFAudioFormat_Vorbis));
+			ThrowIfError(spType->SetUINT32(MF_MT_AUDIO_NUM_CHANNELS, info.vorbis.channels));
+			ThrowIfError(spType->SetUINT32(MF_MT_AUDIO_SAMPLES_PER_SECOND, info.vorbis.sampleRate));
+			ThrowIfError(spType->SetUINT32(MF_MT_AUDIO_AVG_BYTES_PER_SECOND, info.vorbis.bitrateNominal / 8));
+		}
+		else
+		{
+			continue;
+		}
+		SetCodecHeaders(spType.Get(), m_demuxer.GetHeaders(info.serialno));
+
+		// Stream identifiers are the Ogg serial numbers, which are unique per file.
+		ComPtr<IMFStreamDescriptor> spSD;
+		ThrowIfError(MFCreateStreamDescriptor(info.serialno, 1, spType.GetAddressOf(), &spSD));
+
+		ComPtr<IMFMediaTypeHandler> spHandler;
+		ThrowIfError(spSD->GetMediaTypeHandler(&spHandler));
+		ThrowIfError(spHandler->SetCurrentMediaType(spType.Get()));
+
+		ComPtr<OgvStream> spStream;
+		spStream.Attach(new (std::nothrow) OgvStream(this, spSD.Get(), info.type, info.serialno));
+		if (spStream == nullptr)
+		{
+			throw ref new OutOfMemoryException();
+		}
+		spStream->SetPrerollDepth(info.type == OGV_STREAM_THEORA ? VideoPrerollDepth : AudioPrerollDepth);
+
+		m_streams.push_back(spStream);
+		descriptors.push_back(spSD);
+	}
+
+	if (descriptors.empty())
+	{
+		ThrowException(MF_E_INVALID_FILE_FORMAT);
+	}
+
+	std::vector<IMFStreamDescriptor *> rawDescriptors;
+	for (auto &spSD : descriptors)
+	{
+		rawDescriptors.push_back(spSD.Get());
+	}
+	ThrowIfError(MFCreatePresentationDescriptor(static_cast<DWORD>(rawDescriptors.size()), rawDescriptors.data(), &m_spPresentationDescriptor));
+
+	double duration = m_seekIndex.GetDuration();
+	if (duration > 0.0)
+	{
+		ThrowIfError(m_spPresentationDescriptor->SetUINT64(MF_PD_DURATION, static_cast<UINT64>(duration * 10000000.0 + 0.5)));
+	}
+
+	for (DWORD i = 0; i < rawDescriptors.size(); i++)
+	{
+		ThrowIfError(m_spPresentationDescriptor->SelectStream(i));
+	}
+}
+
+void OgvSource::RequestSamples()
+{
+	// No lock: the scheduler is thread-safe, and a fill in progress holds
+	// the lock across reads. Requests that pile up meanwhile collapse into one.
+	(void)QueueAsyncOp(OP_REQUEST_SAMPLES, [this] {
+		FillStreams();
+	}, true);
+}
+
+// Demuxes until every active stream has its requests and preroll covered.
+// Pages come out interleaved, so a stream that is already full can still
+// be handed a few more samples on the way.
+void OgvSource::FillStreams()
+{
+	AutoLock lock(m_mutex);
+
+	if (m_state != STATE_STARTED && m_state != STATE_PAUSED)
+	{
+		return;
+	}
+
+	auto needsData = [this] {
+		for (auto &spStream : m_streams)
+		{
+			if (spStream->NeedsData())
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+
+	auto onSample = [this](uint32_t serialno, OgvSample &sample) {
+		for (auto &spStream : m_streams)
+		{
+			if (spStream->GetSerialNumber() == serialno && spStream->IsActive())
+			{
+				if (spStream->GetStreamType() == OGV_STREAM_THEORA && !m_deadlinePolicy.FrameDemuxed(m_hnsSampleLag, sample.keyframe))
+				{
+					// The lag was measured before the skip; wait for a fresh report.
+					m_hnsSampleLag = 0;
+					break;
+				}
+				spStream->EnqueueSample(std::move(sample));
+				break;
+			}
+		}
+	};
+
+	while (needsData() && m_demuxer.ReadPage(onSample))
+	{
+	}
+
+	if (m_demuxer.HasReadError())
+	{
+		// The byte source has already retried what it can; the file can't
+		// be played past this point. Every later request ends up here too,
+		// so only report it once.
+		if (m_fReadErrorRaised)
+		{
+			return;
+		}
+		m_fReadErrorRaised = true;
+		(void)m_spEventQueue->QueueEventParamVar(MEError, GUID_NULL, HRESULT_FROM_WIN32(ERROR_READ_FAULT), nullptr);
+	}
+	else if (m_demuxer.IsEndOfStream())
+	{
+		bool allEnded = true;
+		ForEachStream([&allEnded](ComPtr<OgvStream> spStream) {
+			spStream->EndOfStream();
+			allEnded = allEnded && spStream->IsEnded();
+		});
+
+		if (allEnded && !m_fEndOfPresentation)
+		{
+			m_fEndOfPresentation = true;
+			(void)m_spEventQueue->QueueEventParamVar(MEEndOfPresentation, GUID_NULL, S_OK, nullptr);
+		}
+	}
+}
+
 OgvSource::OgvSource() :
 	m_state(STATE_INVALID),
-	m_flRate(1.0f)
+	m_flRate(1.0f),
+	m_fThin(false),
+	m_seekIndexKey(0),
+	m_fEndOfPresentation(false),
+	m_fReadErrorRaised(false),
+	m_deadlinePolicy(m_demuxer),
+	m_hnsSampleLag(0),
+	m_dropMode(MF_DROP_MODE_NONE)
 {
 	auto module = ::Microsoft::WRL::GetModuleBase();
 	if (module != nullptr)
@@ -194,7 +509,21 @@ HRESULT OgvSource::CreatePresentationDescriptor(IMFPresentationDescriptor **ppPr
 
 HRESULT OgvSource::GetCharacteristics(DWORD *pdwCharacteristics)
 {
-	return E_NOTIMPL;
+	if (pdwCharacteristics == nullptr)
+	{
+		return E_POINTER;
+	}
+
+	AutoLock lock(m_mutex);
+
+	HRESULT hr = CheckShutdown();
+
+	if (SUCCEEDED(hr))
+	{
+		*pdwCharacteristics = MFMEDIASOURCE_CAN_PAUSE | MFMEDIASOURCE_CAN_SEEK;
+	}
+
+	return hr;
 }
 
 HRESULT OgvSource::Pause()
@@ -208,7 +537,12 @@ HRESULT OgvSource::Pause()
 
 	if (SUCCEEDED(hr))
 	{
-		hr = QueueAsyncOp([this] {
+		hr = QueueAsyncOp(OP_PAUSE, [this] {
+			AutoLock lock(m_mutex);
+			if (m_state == STATE_SHUTDOWN)
+			{
+				return;
+			}
 			try {
 				if (m_state != STATE_STARTED) {
 					ThrowException(MF_E_INVALID_STATE_TRANSITION);
@@ -217,7 +551,10 @@ HRESULT OgvSource::Pause()
 				{
 					m_state = STATE_PAUSED;
 					ForEachStream([](ComPtr<OgvStream> stream) {
-						stream->Pause();
+						if (stream->IsActive())
+						{
+							stream->Pause();
+						}
 					});
 				}
 				m_spEventQueue->QueueEventParamVar(MESourcePaused, GUID_NULL, S_OK, nullptr);
@@ -233,33 +570,48 @@ HRESULT OgvSource::Pause()
 
 HRESULT OgvSource::Shutdown()
 {
-
-	AutoLock lock(m_mutex);
-
 	HRESULT hr = S_OK;
 
-	// Fail if the source is shut down.
-	hr = CheckShutdown();
-
-	if (SUCCEEDED(hr))
 	{
-		ForEachStream([](ComPtr<OgvStream> stream) {
-			stream->Shutdown();
-		});
+		AutoLock lock(m_mutex);
 
-		m_state = STATE_SHUTDOWN;
+		// Fail if the source is shut down.
+		hr = CheckShutdown();
 
-		if (m_spEventQueue)
+		if (SUCCEEDED(hr))
 		{
-			(void)m_spEventQueue->Shutdown();
-		}
+			// Keep the seek points found while playing for the next open.
+			if (m_spPresentationDescriptor != nullptr)
+			{
+				SaveSeekIndex();
+			}
+
+			ForEachStream([](ComPtr<OgvStream> stream) {
+				stream->Shutdown();
+			});
+
+			m_state = STATE_SHUTDOWN;
 
-		m_streams.empty();
-		m_asyncOpQueue.empty();
+			if (m_spEventQueue)
+			{
+				(void)m_spEventQueue->Shutdown();
+			}
+
+			m_streams.clear();
 
-		m_spEventQueue.Reset();
-		m_spPresentationDescriptor.Reset();
-		m_spByteStream.Reset();
+			m_spEventQueue.Reset();
+			m_spPresentationDescriptor.Reset();
+			m_spByteStream.Reset();
+			m_mappedFile.Close();
+			m_byteSource.reset();
+		}
+	}
+
+	// Drop queued ops and wait out the running one. Not under the lock,
+	// as that op may be waiting for it; it sees the shutdown state and returns.
+	if (SUCCEEDED(hr))
+	{
+		m_asyncOps.Shutdown();
 	}
 
 	return hr;
@@ -271,7 +623,141 @@ HRESULT OgvSource::Start(
 	const PROPVARIANT *pvarStartPosition
 	)
 {
-	return E_NOTIMPL;
+	if (pPresentationDescriptor == nullptr || pvarStartPosition == nullptr)
+	{
+		return E_INVALIDARG;
+	}
+	if (pguidTimeFormat != nullptr && *pguidTimeFormat != GUID_NULL)
+	{
+		return MF_E_UNSUPPORTED_TIME_FORMAT;
+	}
+	if (pvarStartPosition->vt != VT_EMPTY && pvarStartPosition->vt != VT_I8)
+	{
+		return MF_E_UNSUPPORTED_TIME_FORMAT;
+	}
+
+	AutoLock lock(m_mutex);
+
+	HRESULT hr = S_OK;
+
+	// Fail if the source is shut down.
+	hr = CheckShutdown();
+
+	if (SUCCEEDED(hr))
+	{
+		hr = IsInitialized();
+	}
+
+	if (SUCCEEDED(hr))
+	{
+		ComPtr<IMFPresentationDescriptor> spPD = pPresentationDescriptor;
+		bool fHasPosition = pvarStartPosition->vt == VT_I8;
+		LONGLONG hnsPosition = fHasPosition ? pvarStartPosition->hVal.QuadPart : 0;
+
+		hr = QueueAsyncOp(OP_START, [this, spPD, fHasPosition, hnsPosition] {
+			DoStart(spPD.Get(), fHasPosition, hnsPosition);
+		});
+	}
+
+	return hr;
+}
+
+void OgvSource::DoStart(IMFPresentationDescriptor *pPD, bool fHasPosition, LONGLONG hnsPosition)
+{
+	AutoLock lock(m_mutex);
+	if (m_state == STATE_SHUTDOWN)
+	{
+		return;
+	}
+
+	try
+	{
+		bool fWasStarted = (m_state == STATE_STARTED);
+		// Resuming from pause keeps the position; starting from stopped begins at zero.
+		bool fRestart = fHasPosition || m_state == STATE_STOPPED;
+		bool fSeek = fWasStarted && fHasPosition;
+
+		PROPVARIANT varStart;
+		PropVariantInit(&varStart);
+		if (fRestart)
+		{
+			varStart.vt = VT_I8;
+			varStart.hVal.QuadPart = hnsPosition;
+
+			OgvSeekTarget target;
+			if (!m_seekIndex.Seek(static_cast<double>(hnsPosition) / 10000000.0, target))
+			{
+				ThrowException(MF_E_INVALIDREQUEST);
+			}
+			m_demuxer.Seek(target.offset);
+			m_hnsSampleLag = 0;
+			if (!m_mappedFile.IsOpen())
+			{
+				// Start filling the cache from the new position while the streams flush.
+				m_byteSource->Prefetch(target.offset, ByteCacheReadAheadBlocks * OgvCachedByteSource::BlockSize);
+			}
+			m_fEndOfPresentation = false;
+			m_fReadErrorRaised = false;
+			ForEachStream([](ComPtr<OgvStream> stream) {
+				stream->Flush();
+			});
+		}
+
+		// Select streams as asked, announcing each one that is selected.
+		DWORD cStreams = 0;
+		ThrowIfError(pPD->GetStreamDescriptorCount(&cStreams));
+		for (DWORD i = 0; i < cStreams; i++)
+		{
+			BOOL fSelected = FALSE;
+			ComPtr<IMFStreamDescriptor> spSD;
+			ThrowIfError(pPD->GetStreamDescriptorByIndex(i, &fSelected, &spSD));
+
+			DWORD dwStreamId = 0;
+			ThrowIfError(spSD->GetStreamIdentifier(&dwStreamId));
+
+			ComPtr<OgvStream> spStream;
+			for (auto &stream : m_streams)
+			{
+				if (stream->GetSerialNumber() == dwStreamId)
+				{
+					spStream = stream;
+				}
+			}
+			if (spStream == nullptr)
+			{
+				ThrowException(MF_E_INVALIDREQUEST);
+			}
+
+			bool fWasActive = spStream->IsActive() != FALSE;
+			spStream->Activate(fSelected != FALSE);
+			// Pages of deselected streams are checked and skipped, not reassembled.
+			m_demuxer.SetStreamEnabled(dwStreamId, fSelected != FALSE);
+			if (fSelected)
+			{
+				ThrowIfError(m_spEventQueue->QueueEventParamUnk(fWasActive ? MEUpdatedStream : MENewStream,
+					GUID_NULL, S_OK, static_cast<IMFMediaStream *>(spStream.Get())));
+			}
+		}
+
+		m_state = STATE_STARTED;
+		ThrowIfError(m_spEventQueue->QueueEventParamVar(fSeek ? MESourceSeeked : MESourceStarted, GUID_NULL, S_OK, &varStart));
+
+		ForEachStream([&varStart, fSeek](ComPtr<OgvStream> stream) {
+			if (stream->IsActive())
+			{
+				stream->Start(&varStart, fSeek);
+			}
+		});
+	}
+	catch (Exception ^ex)
+	{
+		m_spEventQueue->QueueEventParamVar(MESourceStarted, GUID_NULL, ex->HResult, nullptr);
+		return;
+	}
+
+	// Preroll straight away rather than waiting for the first requests.
+	lock.unlock();
+	FillStreams();
 }
 
 HRESULT OgvSource::Stop()
@@ -285,16 +771,24 @@ HRESULT OgvSource::Stop()
 
 	if (SUCCEEDED(hr))
 	{
-		hr = QueueAsyncOp([this] {
+		hr = QueueAsyncOp(OP_STOP, [this] {
+			AutoLock lock(m_mutex);
+			if (m_state == STATE_SHUTDOWN)
+			{
+				return;
+			}
 			try {
-				if (m_state != STATE_STARTED) {
+				if (m_state != STATE_STARTED && m_state != STATE_PAUSED) {
 					ThrowException(MF_E_INVALID_STATE_TRANSITION);
 				}
 				else
 				{
 					m_state = STATE_STOPPED;
 					ForEachStream([](ComPtr<OgvStream> stream) {
-						stream->Stop();
+						if (stream->IsActive())
+						{
+							stream->Stop();
+						}
 					});
 				}
 				m_spEventQueue->QueueEventParamVar(MESourceStopped, GUID_NULL, S_OK, nullptr);
@@ -311,16 +805,23 @@ HRESULT OgvSource::Stop()
 // IMFGetService
 HRESULT OgvSource::GetService(_In_ REFGUID guidService, _In_ REFIID riid, _Out_opt_ LPVOID *ppvObject)
 {
-	return E_NOTIMPL;
+	if (ppvObject == nullptr)
+	{
+		return E_POINTER;
+	}
+	*ppvObject = nullptr;
+
+	// The quality manager finds IMFQualityAdvise here.
+	if (guidService == MF_QUALITY_SERVICES)
+	{
+		return QueryInterface(riid, ppvObject);
+	}
+	return MF_E_UNSUPPORTED_SERVICE;
 }
 
 // IMFRateControl
 HRESULT OgvSource::SetRate(BOOL fThin, float flRate)
 {
-	if (fThin)
-	{
-		return MF_E_THINNING_UNSUPPORTED;
-	}
 	if (flRate < 0.0f)
 	{
 		return MF_E_UNSUPPORTED_RATE;
@@ -335,26 +836,30 @@ HRESULT OgvSource::SetRate(BOOL fThin, float flRate)
 
 	if (SUCCEEDED(hr))
 	{
-		if (flRate != m_flRate) {
-			hr = QueueAsyncOp([this, flRate] {
-				try {
-					if (m_state != STATE_STARTED) {
-						ThrowException(MF_E_INVALID_STATE_TRANSITION);
-					}
-					else
-					{
-						m_state = STATE_PAUSED;
-						ForEachStream([flRate](ComPtr<OgvStream> stream) {
-							stream->SetRate(flRate);
-						});
-					}
-					m_spEventQueue->QueueEventParamVar(MESourceRateChanged, GUID_NULL, S_OK, nullptr);
-				}
-				catch (Exception ^ex) {
-					m_spEventQueue->QueueEventParamVar(MESourceRateChanged, GUID_NULL, ex->HResult, nullptr);
-				}
+		// Not coalesced: every successful SetRate owes the pipeline its own
+		// MESourceRateChanged.
+		bool thin = fThin != FALSE;
+		hr = QueueAsyncOp(OP_SETRATE, [this, flRate, thin] {
+			AutoLock lock(m_mutex);
+			if (m_state == STATE_SHUTDOWN)
+			{
+				return;
+			}
+			m_flRate = flRate;
+			// Thinning skips inter frames in the demuxer, so they are never
+			// copied, queued or decoded.
+			m_fThin = thin;
+			m_demuxer.SetThinning(thin);
+			ForEachStream([flRate](ComPtr<OgvStream> stream) {
+				stream->SetRate(flRate);
 			});
-		}
+
+			PROPVARIANT varRate;
+			PropVariantInit(&varRate);
+			varRate.vt = VT_R4;
+			varRate.fltVal = flRate;
+			m_spEventQueue->QueueEventParamVar(MESourceRateChanged, GUID_NULL, S_OK, &varRate);
+		});
 	}
 
 	return hr;
@@ -368,8 +873,94 @@ HRESULT OgvSource::GetRate(_Inout_opt_ BOOL *pfThin, _Inout_opt_ float *pflRate)
 	}
 
 	AutoLock lock(m_mutex);
-	*pfThin = FALSE;
+	*pfThin = m_fThin ? TRUE : FALSE;
 	*pflRate = m_flRate;
 
 	return S_OK;
 }
+
+// IMFQualityAdvise
+HRESULT OgvSource::SetDropMode(_In_ MF_QUALITY_DROP_MODE eDropMode)
+{
+	// Drop mode 1 skips to the next keyframe as soon as video is late at
+	// all; there is nothing coarser to offer beyond that.
+	if (eDropMode > MF_DROP_MODE_1)
+	{
+		return MF_E_NO_MORE_DROP_MODES;
+	}
+
+	AutoLock lock(m_mutex);
+	HRESULT hr = CheckShutdown();
+	if (SUCCEEDED(hr))
+	{
+		m_dropMode = eDropMode;
+		m_deadlinePolicy.SetSkipThreshold(eDropMode == MF_DROP_MODE_NONE ? OgvDeadlinePolicy::DefaultSkipThreshold : 0);
+	}
+	return hr;
+}
+
+HRESULT OgvSource::SetQualityLevel(_In_ MF_QUALITY_LEVEL eQualityLevel)
+{
+	// Decoding happens downstream; we have no cheaper output to give.
+	return eQualityLevel == MF_QUALITY_NORMAL ? S_OK : MF_E_NO_MORE_QUALITY_LEVELS;
+}
+
+HRESULT OgvSource::GetDropMode(_Out_ MF_QUALITY_DROP_MODE *peDropMode)
+{
+	if (peDropMode == nullptr)
+	{
+		return E_POINTER;
+	}
+
+	AutoLock lock(m_mutex);
+	*peDropMode = m_dropMode;
+	return S_OK;
+}
+
+HRESULT OgvSource::GetQualityLevel(_Out_ MF_QUALITY_LEVEL *peQualityLevel)
+{
+	if (peQualityLevel == nullptr)
+	{
+		return E_POINTER;
+	}
+	*peQualityLevel = MF_QUALITY_NORMAL;
+	return S_OK;
+}
+
+HRESULT OgvSource::DropTime(_In_ LONGLONG hnsAmountToDrop)
+{
+	// Skips only ever land on keyframes, so a set amount can't be dropped.
+	return MF_E_DROPTIME_NOT_SUPPORTED;
+}
+
+// IMFQualityAdvise2
+HRESULT OgvSource::NotifyQualityEvent(_In_opt_ IMFMediaEvent *pEvent, _Out_ DWORD *pdwFlags)
+{
+	if (pdwFlags == nullptr)
+	{
+		return E_POINTER;
+	}
+	*pdwFlags = 0;
+	if (pEvent == nullptr)
+	{
+		return E_POINTER;
+	}
+
+	MediaEventType met = MEUnknown;
+	GUID guidExtendedType = GUID_NULL;
+	if (FAILED(pEvent->GetType(&met)) || met != MEQualityNotify ||
+		FAILED(pEvent->GetExtendedType(&guidExtendedType)) || guidExtendedType != MF_QUALITY_NOTIFY_SAMPLE_LAG)
+	{
+		return S_OK;
+	}
+
+	// How far behind the presentation clock the renderer's latest sample was.
+	PROPVARIANT var;
+	PropVariantInit(&var);
+	if (SUCCEEDED(pEvent->GetValue(&var)) && var.vt == VT_I8)
+	{
+		m_hnsSampleLag = var.hVal.QuadPart;
+	}
+	PropVariantClear(&var);
+	return S_OK;
+}
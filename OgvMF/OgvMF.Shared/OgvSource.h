@@ -1,5 +1,15 @@
 #pragma once
 
+#include <atomic>
+
+#include "OgvSeekIndex.h"
+#include "OgvDemuxer.h"
+#include "OgvDeadlinePolicy.h"
+#include "OgvOpScheduler.h"
+#include "OgvMappedFile.h"
+#include "OgvByteCache.h"
+#include "OgvSeekIndexCache.h"
+
 class OgvStream;
 
 enum SourceState
@@ -19,7 +29,8 @@ class OgvSource WrlSealed :
 		RuntimeClassFlags<ClassicCom>,
 		IMFMediaSource,
 		IMFGetService,
-		IMFRateControl
+		IMFRateControl,
+		ChainInterfaces<IMFQualityAdvise2, IMFQualityAdvise>
 	>
 {
 public:
@@ -48,9 +59,22 @@ public:
 	IFACEMETHOD(SetRate) (BOOL fThin, float flRate);
 	IFACEMETHOD(GetRate) (_Inout_opt_ BOOL *pfThin, _Inout_opt_ float *pflRate);
 
+	// IMFQualityAdvise
+	IFACEMETHOD(SetDropMode) (_In_ MF_QUALITY_DROP_MODE eDropMode);
+	IFACEMETHOD(SetQualityLevel) (_In_ MF_QUALITY_LEVEL eQualityLevel);
+	IFACEMETHOD(GetDropMode) (_Out_ MF_QUALITY_DROP_MODE *peDropMode);
+	IFACEMETHOD(GetQualityLevel) (_Out_ MF_QUALITY_LEVEL *peQualityLevel);
+	IFACEMETHOD(DropTime) (_In_ LONGLONG hnsAmountToDrop);
+
+	// IMFQualityAdvise2
+	IFACEMETHOD(NotifyQualityEvent) (_In_opt_ IMFMediaEvent *pEvent, _Out_ DWORD *pdwFlags);
+
 	// Helpers for the byte stream
 	static ComPtr<OgvSource> CreateInstance();
-	concurrency::task<void> OpenAsync(IMFByteStream *pStream);
+	concurrency::task<void> OpenAsync(IMFByteStream *pStream, LPCWSTR pwszURL);
+
+	// For the streams: called when a stream's sample queue may have run low.
+	void RequestSamples();
 
 	OgvSource();
 	~OgvSource();
@@ -65,13 +89,20 @@ protected:
 	typedef std::unique_lock<std::mutex> AutoLock;
 
 	// Async operation queue
-	typedef std::function<void(void)> OpFunc;
-	std::queue<OpFunc> m_asyncOpQueue;
-	std::thread m_asyncThread;
-
-	HRESULT QueueAsyncOp(OpFunc op) {
-		m_asyncOpQueue.push(op);
-		return S_OK;
+	enum SourceOp
+	{
+		OP_START,
+		OP_PAUSE,
+		OP_STOP,
+		OP_SETRATE,
+		OP_REQUEST_SAMPLES
+	};
+
+	typedef OgvOpScheduler::OpFunc OpFunc;
+	OgvOpScheduler m_asyncOps;
+
+	HRESULT QueueAsyncOp(SourceOp type, OpFunc op, bool coalesce = false) {
+		return m_asyncOps.Post(type, op, coalesce) ? S_OK : MF_E_SHUTDOWN;
 	}
 
 	// Streams
@@ -102,6 +133,40 @@ protected:
 
 	// Rate!
 	float                       m_flRate;
+	bool                        m_fThin;        // Only video keyframes are delivered.
+
+	// Byte offsets for seeking; built in OpenAsync.
+	OgvSeekIndex                m_seekIndex;
+
+	// Local files are mapped and parsed in place rather than read through
+	// m_spByteStream, when the URL lets us find them.
+	OgvMappedFile               m_mappedFile;
+
+	// Otherwise reads go through a block cache in front of the byte stream,
+	// or straight to the server if the byte stream doesn't know its length.
+	std::shared_ptr<OgvCachedByteSource> m_byteSource;
+	bool OpenByteSource(const std::wstring &url);
+
+	// The seek index, shared with later opens of the same file.
+	OgvSeekIndexCache::Key      m_seekIndexKey;
+	void LoadSeekIndex();
+	void SaveSeekIndex();
+
+	// Turns pages into samples for the streams.
+	OgvDemuxer                  m_demuxer;
+	bool                        m_fEndOfPresentation;
+	bool                        m_fReadErrorRaised;
+
+	// Video that falls too far behind skips to its next keyframe. The
+	// renderer reports how late its samples are through the quality
+	// manager, which may also raise the drop mode to skip sooner.
+	OgvDeadlinePolicy           m_deadlinePolicy;
+	std::atomic<int64_t>        m_hnsSampleLag;
+	MF_QUALITY_DROP_MODE        m_dropMode;
+
+	void InitPresentationDescriptor();
+	void FillStreams();
+	void DoStart(IMFPresentationDescriptor *pPD, bool fHasPosition, LONGLONG hnsPosition);
 
 	concurrency::task_completion_event<void> _openedEvent;  // Event used to signalize end of open operation.
 };
@@ -3,25 +3,31 @@
 #include "OgvSource.h"
 #include "OgvStream.h"
 
-OgvStream::OgvStream(OgvSource *pSource, IMFStreamDescriptor *pSD, OgvStreamType streamType) :
+OgvStream::OgvStream(OgvSource *pSource, IMFStreamDescriptor *pSD, OgvStreamType streamType, uint32_t serialno) :
 	m_cRef(1),
 	m_spSource(pSource),
 	m_spStreamDescriptor(pSD),
-	m_cStreamType(streamType)
+	m_cStreamType(streamType),
+	m_serialno(serialno),
+	m_state(STREAM_STOPPED),
+	m_fActive(false),
+	m_flRate(1.0f)
 {
+	assert(pSource != nullptr);
+	assert(pSD != nullptr);
+
+	ThrowIfError(MFCreateEventQueue(m_spEventQueue.ReleaseAndGetAddressOf()));
+
 	auto module = ::Microsoft::WRL::GetModuleBase();
 	if (module != nullptr)
 	{
 		module->IncrementObjectCount();
 	}
-
-	assert(pSource != nullptr);
-	assert(pSD != nullptr);
 }
 
 OgvStream::~OgvStream()
 {
-	//assert(m_state == STATE_SHUTDOWN);
+	assert(m_state == STREAM_SHUTDOWN);
 
 	auto module = ::Microsoft::WRL::GetModuleBase();
 	if (module != nullptr)
@@ -69,70 +75,368 @@ ULONG OgvStream::Release()
 // IMFMediaEventGenerator
 HRESULT OgvStream::BeginGetEvent(IMFAsyncCallback *pCallback, IUnknown *punkState)
 {
-	return E_NOTIMPL;
+	HRESULT hr = S_OK;
+
+	AutoLock lock(m_mutex);
+
+	hr = CheckShutdown();
+
+	if (SUCCEEDED(hr))
+	{
+		hr = m_spEventQueue->BeginGetEvent(pCallback, punkState);
+	}
+
+	return hr;
 }
 
 HRESULT OgvStream::EndGetEvent(IMFAsyncResult *pResult, IMFMediaEvent **ppEvent)
 {
-	return E_NOTIMPL;
+	HRESULT hr = S_OK;
+
+	AutoLock lock(m_mutex);
+
+	hr = CheckShutdown();
+
+	if (SUCCEEDED(hr))
+	{
+		hr = m_spEventQueue->EndGetEvent(pResult, ppEvent);
+	}
+
+	return hr;
 }
 
-HRESULT OgvStream::GetEvent(DWORD dwFlags, IMFMediaEvent **ppEvent){
-	return E_NOTIMPL;
+HRESULT OgvStream::GetEvent(DWORD dwFlags, IMFMediaEvent **ppEvent)
+{
+	// GetEvent can block indefinitely, so we don't hold the lock.
+
+	HRESULT hr = S_OK;
+
+	ComPtr<IMFMediaEventQueue> spQueue;
+
+	{
+		AutoLock lock(m_mutex);
+
+		hr = CheckShutdown();
+
+		if (SUCCEEDED(hr))
+		{
+			spQueue = m_spEventQueue;
+		}
+	}
+
+	if (SUCCEEDED(hr))
+	{
+		hr = spQueue->GetEvent(dwFlags, ppEvent);
+	}
+
+	return hr;
 }
 
 HRESULT OgvStream::QueueEvent(MediaEventType met, REFGUID guidExtendedType, HRESULT hrStatus, const PROPVARIANT *pvValue)
 {
-	return E_NOTIMPL;
+	HRESULT hr = S_OK;
+
+	AutoLock lock(m_mutex);
+
+	hr = CheckShutdown();
+
+	if (SUCCEEDED(hr))
+	{
+		hr = m_spEventQueue->QueueEventParamVar(met, guidExtendedType, hrStatus, pvValue);
+	}
+
+	return hr;
 }
 
 
 // IMFMediaStream
 HRESULT OgvStream::GetMediaSource(IMFMediaSource **ppMediaSource)
 {
-	return E_NOTIMPL;
+	if (ppMediaSource == nullptr)
+	{
+		return E_POINTER;
+	}
+
+	AutoLock lock(m_mutex);
+
+	HRESULT hr = CheckShutdown();
+
+	if (SUCCEEDED(hr))
+	{
+		hr = m_spSource.CopyTo(ppMediaSource);
+	}
+
+	return hr;
 }
 
 HRESULT OgvStream::GetStreamDescriptor(IMFStreamDescriptor **ppStreamDescriptor)
 {
-	return E_NOTIMPL;
+	if (ppStreamDescriptor == nullptr)
+	{
+		return E_POINTER;
+	}
+
+	AutoLock lock(m_mutex);
+
+	HRESULT hr = CheckShutdown();
+
+	if (SUCCEEDED(hr))
+	{
+		hr = m_spStreamDescriptor.CopyTo(ppStreamDescriptor);
+	}
+
+	return hr;
 }
 
 HRESULT OgvStream::RequestSample(IUnknown *pToken)
 {
-	return E_NOTIMPL;
+	HRESULT hr = S_OK;
+	ComPtr<OgvSource> spSource;
+
+	{
+		AutoLock lock(m_mutex);
+
+		hr = CheckShutdown();
+
+		if (SUCCEEDED(hr) && m_state == STREAM_STOPPED)
+		{
+			hr = MF_E_MEDIA_SOURCE_WRONGSTATE;
+		}
+
+		if (SUCCEEDED(hr) && !m_fActive)
+		{
+			hr = MF_E_INVALIDREQUEST;
+		}
+
+		if (SUCCEEDED(hr))
+		{
+			// The token has to be attached to the sample that answers this request.
+			OgvSampleToken token;
+			if (pToken != nullptr)
+			{
+				pToken->AddRef();
+				token = OgvSampleToken(pToken, [](void *p) {
+					static_cast<IUnknown *>(p)->Release();
+				});
+			}
+
+			if (!m_samples.Request(token))
+			{
+				hr = MF_E_END_OF_STREAM;
+			}
+			spSource = m_spSource;
+		}
+	}
+
+	// Call out to the source without our lock; it calls back in to enqueue.
+	if (SUCCEEDED(hr))
+	{
+		DispatchSamples();
+		spSource->RequestSamples();
+	}
+
+	return hr;
 }
 
 
 // For the source
 
-HRESULT OgvStream::Start()
+HRESULT OgvStream::Start(const PROPVARIANT *pvarStartPosition, bool fSeek)
 {
-	return E_NOTIMPL;
+	HRESULT hr = S_OK;
+
+	{
+		AutoLock lock(m_mutex);
+
+		hr = CheckShutdown();
+
+		if (SUCCEEDED(hr))
+		{
+			m_state = STREAM_STARTED;
+			hr = m_spEventQueue->QueueEventParamVar(fSeek ? MEStreamSeeked : MEStreamStarted, GUID_NULL, S_OK, pvarStartPosition);
+		}
+	}
+
+	// Answer anything requested while paused.
+	if (SUCCEEDED(hr))
+	{
+		DispatchSamples();
+	}
+
+	return hr;
 }
 
 HRESULT OgvStream::Pause()
 {
-	return E_NOTIMPL;
+	AutoLock lock(m_mutex);
+
+	HRESULT hr = CheckShutdown();
+
+	if (SUCCEEDED(hr))
+	{
+		m_state = STREAM_PAUSED;
+		hr = m_spEventQueue->QueueEventParamVar(MEStreamPaused, GUID_NULL, S_OK, nullptr);
+	}
+
+	return hr;
 }
 
 HRESULT OgvStream::Stop()
 {
-	return E_NOTIMPL;
+	AutoLock lock(m_mutex);
+
+	HRESULT hr = CheckShutdown();
+
+	if (SUCCEEDED(hr))
+	{
+		m_state = STREAM_STOPPED;
+		m_samples.Clear();
+		hr = m_spEventQueue->QueueEventParamVar(MEStreamStopped, GUID_NULL, S_OK, nullptr);
+	}
+
+	return hr;
 }
 
 HRESULT OgvStream::Shutdown()
 {
-	return E_NOTIMPL;
+	AutoLock lock(m_mutex);
+
+	HRESULT hr = CheckShutdown();
+
+	if (SUCCEEDED(hr))
+	{
+		m_state = STREAM_SHUTDOWN;
+		m_samples.Clear();
+
+		// Calls into a shut-down queue fail harmlessly, so it is kept until
+		// destruction rather than raced against deliveries in flight.
+		(void)m_spEventQueue->Shutdown();
+		m_spStreamDescriptor.Reset();
+		// The source holds us too; let go so neither keeps the other alive.
+		m_spSource.Reset();
+	}
+
+	return hr;
 }
 
 BOOL OgvStream::IsActive()
 {
-	return true; // ???
+	AutoLock lock(m_mutex);
+	return m_fActive;
+}
+
+void OgvStream::Activate(bool active)
+{
+	AutoLock lock(m_mutex);
+	m_fActive = active;
+	if (!active)
+	{
+		m_samples.Clear();
+	}
 }
 
 HRESULT OgvStream::SetRate(float rate)
 {
+	AutoLock lock(m_mutex);
 	m_flRate = rate;
 	return S_OK;
 }
+
+void OgvStream::EnqueueSample(OgvSample &&sample)
+{
+	m_samples.Push(std::move(sample));
+	DispatchSamples();
+}
+
+void OgvStream::EndOfStream()
+{
+	m_samples.EndOfStream();
+	DispatchSamples();
+}
+
+void OgvStream::Flush()
+{
+	m_samples.Flush();
+}
+
+bool OgvStream::NeedsData() const
+{
+	AutoLock lock(m_mutex);
+	return m_fActive && m_state != STREAM_SHUTDOWN && m_samples.NeedsData();
+}
+
+bool OgvStream::IsPrerolled() const
+{
+	AutoLock lock(m_mutex);
+	return !m_fActive || m_samples.IsPrerolled();
+}
+
+bool OgvStream::IsEnded() const
+{
+	AutoLock lock(m_mutex);
+	return !m_fActive || m_samples.IsEnded();
+}
+
+void OgvStream::SetPrerollDepth(size_t depth)
+{
+	m_samples.SetPrerollDepth(depth);
+}
+
+// Pairs pending requests with queued samples. Samples only go out while
+// started; requests made while paused wait for the next Start.
+void OgvStream::DispatchSamples()
+{
+	{
+		AutoLock lock(m_mutex);
+		if (m_state != STREAM_STARTED)
+		{
+			return;
+		}
+	}
+
+	m_samples.Dispatch([this](OgvSample &sample, const OgvSampleToken &token) {
+		DeliverSample(sample, token);
+	}, [this] {
+		(void)m_spEventQueue->QueueEventParamVar(MEEndOfStream, GUID_NULL, S_OK, nullptr);
+	});
+}
+
+void OgvStream::DeliverSample(OgvSample &sample, const OgvSampleToken &token)
+{
+	try
+	{
+		ComPtr<IMFMediaBuffer> spBuffer;
+		ThrowIfError(MFCreateMemoryBuffer(static_cast<DWORD>(sample.data.size()), &spBuffer));
+
+		BYTE *pData = nullptr;
+		ThrowIfError(spBuffer->Lock(&pData, nullptr, nullptr));
+		memcpy(pData, sample.data.data(), sample.data.size());
+		ThrowIfError(spBuffer->Unlock());
+		ThrowIfError(spBuffer->SetCurrentLength(static_cast<DWORD>(sample.data.size())));
+
+		ComPtr<IMFSample> spSample;
+		ThrowIfError(MFCreateSample(&spSample));
+		ThrowIfError(spSample->AddBuffer(spBuffer.Get()));
+		ThrowIfError(spSample->SetSampleTime(sample.time));
+		ThrowIfError(spSample->SetSampleDuration(sample.duration));
+
+		if (sample.keyframe)
+		{
+			ThrowIfError(spSample->SetUINT32(MFSampleExtension_CleanPoint, TRUE));
+		}
+		if (sample.discontinuity)
+		{
+			ThrowIfError(spSample->SetUINT32(MFSampleExtension_Discontinuity, TRUE));
+		}
+		if (token != nullptr)
+		{
+			ThrowIfError(spSample->SetUnknown(MFSampleExtension_Token, static_cast<IUnknown *>(token.get())));
+		}
+
+		ThrowIfError(m_spEventQueue->QueueEventParamUnk(MEMediaSample, GUID_NULL, S_OK, spSample.Get()));
+	}
+	catch (Exception ^ex)
+	{
+		(void)m_spEventQueue->QueueEventParamVar(MEError, GUID_NULL, ex->HResult, nullptr);
+	}
+}
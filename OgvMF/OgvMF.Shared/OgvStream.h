@@ -4,16 +4,13 @@
 class OgvSource;
 //#include "OgvSource.h"
 
-enum OgvStreamType {
-	OGV_STREAM_UNKNOWN,
-	OGV_STREAM_VORBIS,
-	OGV_STREAM_THEORA
-};
+#include "OggCodecHeaders.h"
+#include "OgvSampleQueue.h"
 
 class OgvStream WrlSealed : public IMFMediaStream {
 
 public:
-	OgvStream(OgvSource *pSource, IMFStreamDescriptor *pSD, OgvStreamType pStreamType);
+	OgvStream(OgvSource *pSource, IMFStreamDescriptor *pSD, OgvStreamType pStreamType, uint32_t serialno);
 	~OgvStream();
 
 	// IUnknown
@@ -33,20 +30,59 @@ public:
 	STDMETHODIMP RequestSample(IUnknown *pToken);
 
 	// For the source to call
-	STDMETHODIMP Start();
+	STDMETHODIMP Start(const PROPVARIANT *pvarStartPosition, bool fSeek);
 	STDMETHODIMP Pause();
 	STDMETHODIMP Stop();
 	STDMETHODIMP Shutdown();
 	STDMETHODIMP_(BOOL) IsActive();
 	STDMETHODIMP SetRate(float rate);
+	void Activate(bool active);
+
+	// Demuxed samples come in here; the source keeps each active stream
+	// topped up while NeedsData is true.
+	void EnqueueSample(OgvSample &&sample);
+	void EndOfStream();
+	void Flush();
+	bool NeedsData() const;
+	bool IsPrerolled() const;
+	bool IsEnded() const;
+	void SetPrerollDepth(size_t depth);
+
+	OgvStreamType GetStreamType() const { return m_cStreamType; }
+	uint32_t GetSerialNumber() const { return m_serialno; }
 
 private:
+	enum StreamState
+	{
+		STREAM_STOPPED,
+		STREAM_PAUSED,
+		STREAM_STARTED,
+		STREAM_SHUTDOWN
+	};
+
+	HRESULT CheckShutdown() const
+	{
+		return (m_state == STREAM_SHUTDOWN ? MF_E_SHUTDOWN : S_OK);
+	}
+
+	void DispatchSamples();
+	void DeliverSample(OgvSample &sample, const OgvSampleToken &token);
+
 	long m_cRef;
 	ComPtr<OgvSource> m_spSource;
 	ComPtr<IMFStreamDescriptor> m_spStreamDescriptor;
 	ComPtr<IMFMediaEventQueue> m_spEventQueue;
 
 	OgvStreamType m_cStreamType;
+	uint32_t m_serialno;
+
+	// Thread safety
+	mutable std::mutex m_mutex;
+	typedef std::unique_lock<std::mutex> AutoLock;
+
+	StreamState m_state;
+	bool m_fActive;
+	OgvSampleQueue m_samples;
 
 	float m_flRate;
 };
@@ -1,3 +0,0 @@
-class OgvVorbisStream WrlSealed : public IMFMediaStream {
-
-};
@@ -6,6 +6,10 @@
 #include <thread>
 #include <mutex>
 
+// Everything below is Windows-only; the portable parsing code also builds
+// on its own for the tests under Tests/.
+#ifdef _WIN32
+
 /*
 #include <collection.h>
 #include <ppltasks.h>
@@ -41,3 +45,5 @@
 using namespace Platform;
 using namespace Microsoft::WRL;
 using namespace Microsoft::WRL::Wrappers;
+
+#endif
@@ -70,38 +70,55 @@ void Sample3DSceneRenderer::CreateWindowSizeDependentResources()
 	//CreateTexture(640, 480, m_textureCr, m_textureViewCr);
 }
 
-void Sample3DSceneRenderer::UpdateTextures(OGVCore::FrameBuffer &frame) {
-	int lumaWidth = frame.Y.stride,
-		chromaWidth = frame.Cb.stride,
-		lumaHeight = frame.Y.height,
-		chromaHeight = frame.Cb.height;
-	
+void Sample3DSceneRenderer::UpdateTextures(const VideoFrame &frame) {
+	// Textures cover only the visible picture, not the decoder's padded planes.
+	PlaneRect lumaRect = frame.picture,
+		chromaRect = frame.ChromaPicture();
+
+	if (lumaRect.width != m_lumaRect.width || lumaRect.height != m_lumaRect.height ||
+		chromaRect.width != m_chromaRect.width || chromaRect.height != m_chromaRect.height) {
+		m_textureY.Reset();
+		m_textureCb.Reset();
+		m_textureCr.Reset();
+		m_textureViewY.Reset();
+		m_textureViewCb.Reset();
+		m_textureViewCr.Reset();
+		m_samplerY.Reset();
+		m_samplerCb.Reset();
+		m_samplerCr.Reset();
+		m_lumaRect = lumaRect;
+		m_chromaRect = chromaRect;
+	}
+
 	if (!m_textureY) {
-		CreateTexture(lumaWidth, lumaHeight, m_textureY, m_textureViewY, m_samplerY);
+		CreateTexture(lumaRect.width, lumaRect.height, m_textureY, m_textureViewY, m_samplerY);
 	}
-	UpdateTexture(m_textureY, frame.Y.bytes, lumaWidth * lumaHeight);
+	UpdateTexture(m_textureY, frame.Y, lumaRect);
 
 	if (!m_textureCb) {
-		CreateTexture(chromaWidth, chromaHeight, m_textureCb, m_textureViewCb, m_samplerCb);
+		CreateTexture(chromaRect.width, chromaRect.height, m_textureCb, m_textureViewCb, m_samplerCb);
 	}
-	UpdateTexture(m_textureCb, frame.Cb.bytes, chromaWidth * chromaHeight);
+	UpdateTexture(m_textureCb, frame.Cb, chromaRect);
 
 	if (!m_textureCr) {
-		CreateTexture(chromaWidth, chromaHeight, m_textureCr, m_textureViewCr, m_samplerCr);
+		CreateTexture(chromaRect.width, chromaRect.height, m_textureCr, m_textureViewCr, m_samplerCr);
 	}
-	UpdateTexture(m_textureCr, frame.Cr.bytes, chromaWidth * chromaHeight);
+	UpdateTexture(m_textureCr, frame.Cr, chromaRect);
 }
 
-void Sample3DSceneRenderer::UpdateTexture(ComPtr<ID3D11Texture2D> &tex, const byte *bytes, int nbytes) {
+void Sample3DSceneRenderer::UpdateTexture(ComPtr<ID3D11Texture2D> &tex, const VideoPlane &plane, const PlaneRect &crop) {
 	auto context = m_deviceResources->GetD3DDeviceContext();
 
 	ComPtr<ID3D11Resource> res;
 	tex.As(&res);
 
 	D3D11_MAPPED_SUBRESOURCE map;
-	context->Map(res.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
+	DX::ThrowIfFailed(
+		context->Map(res.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &map)
+		);
 
-	memcpy(map.pData, bytes, nbytes);
+	// The driver picks the row pitch, which needn't match the plane stride.
+	UploadPlane(plane.bytes, plane.stride, crop, static_cast<uint8_t *>(map.pData), map.RowPitch);
 
 	context->Unmap(res.Get(), 0);
 }
@@ -3,8 +3,7 @@
 #include "..\Common\DeviceResources.h"
 #include "ShaderStructures.h"
 #include "..\Common\StepTimer.h"
-
-#include <OGVCore.h>
+#include "..\Media\VideoFrame.h"
 
 namespace OgvRT
 {
@@ -17,7 +16,7 @@ namespace OgvRT
 		void CreateWindowSizeDependentResources();
 		void ReleaseDeviceDependentResources();
 		void Update(DX::StepTimer const& timer);
-		void UpdateTextures(OGVCore::FrameBuffer &frame);
+		void UpdateTextures(const VideoFrame &frame);
 		void Render();
 		void StartTracking();
 		void TrackingUpdate(float positionX);
@@ -28,7 +27,7 @@ namespace OgvRT
 	private:
 		void Rotate(float radians);
 		void CreateTexture(int width, int height, Microsoft::WRL::ComPtr<ID3D11Texture2D> &tex, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> &view, Microsoft::WRL::ComPtr<ID3D11SamplerState> &sampler);
-		void UpdateTexture(Microsoft::WRL::ComPtr<ID3D11Texture2D> &tex, const byte *bytes, int nbytes);
+		void UpdateTexture(Microsoft::WRL::ComPtr<ID3D11Texture2D> &tex, const VideoPlane &plane, const PlaneRect &crop);
 
 	private:
 		// Cached pointer to device resources.
@@ -50,6 +49,8 @@ namespace OgvRT
 		Microsoft::WRL::ComPtr<ID3D11SamplerState> m_samplerY;
 		Microsoft::WRL::ComPtr<ID3D11SamplerState> m_samplerCb;
 		Microsoft::WRL::ComPtr<ID3D11SamplerState> m_samplerCr;
+		PlaneRect m_lumaRect;
+		PlaneRect m_chromaRect;
 
 		// System resources for cube geometry.
 		ModelViewProjectionConstantBuffer	m_constantBufferData;
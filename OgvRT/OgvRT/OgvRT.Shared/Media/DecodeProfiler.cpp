@@ -0,0 +1,128 @@
+﻿#include "pch.h"
+#include "DecodeProfiler.h"
+
+#include <cstring>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+
+#ifndef _WIN32
+#include <chrono>
+#endif
+
+using namespace OgvRT;
+
+#ifdef _WIN32
+// steady_clock only ticks at the system timer rate on some of our
+// compilers, which is too coarse for per-frame phases.
+static int64_t QueryFrequency()
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return frequency.QuadPart;
+}
+
+static const int64_t s_qpcFrequency = QueryFrequency();
+#endif
+
+int64_t DecodeProfiler::Now()
+{
+#ifdef _WIN32
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	// Split to keep the multiply from overflowing on long uptimes.
+	int64_t seconds = counter.QuadPart / s_qpcFrequency;
+	int64_t remainder = counter.QuadPart % s_qpcFrequency;
+	return seconds * 1000000000 + remainder * 1000000000 / s_qpcFrequency;
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+DecodeProfiler::Scope::Scope(DecodeProfiler &profiler, DecodePhase phase) :
+	m_profiler(profiler),
+	m_outer(profiler.m_active)
+{
+	// Pause whichever phase we are nested in.
+	int64_t now = DecodeProfiler::Now();
+	if (m_outer != DecodePhaseCount)
+	{
+		m_profiler.Charge(m_outer, now);
+	}
+	m_profiler.m_active = phase;
+	m_profiler.m_activeStart = now;
+}
+
+DecodeProfiler::Scope::~Scope()
+{
+	int64_t now = DecodeProfiler::Now();
+	m_profiler.Charge(m_profiler.m_active, now);
+	m_profiler.m_active = m_outer;
+	m_profiler.m_activeStart = now;
+}
+
+void DecodeProfiler::Charge(DecodePhase phase, int64_t now)
+{
+	m_profile.nanoseconds[phase] += static_cast<uint64_t>(now - m_activeStart);
+}
+
+DecodeProfiler::DecodeProfiler()
+{
+	Reset();
+}
+
+DecodeProfile DecodeProfiler::GetProfile() const
+{
+	DecodeProfile profile = m_profile;
+	profile.wallSeconds = (Now() - m_start) / 1e9;
+	return profile;
+}
+
+void DecodeProfiler::Reset()
+{
+	memset(&m_profile, 0, sizeof(m_profile));
+	m_start = Now();
+	m_active = DecodePhaseCount;
+	m_activeStart = m_start;
+}
+
+const char *DecodeProfiler::GetPhaseName(DecodePhase phase)
+{
+	switch (phase)
+	{
+	case DecodePhaseInput:		return "input";
+	case DecodePhaseDemux:		return "demux";
+	case DecodePhaseAudio:		return "audio";
+	case DecodePhaseVideo:		return "video";
+	case DecodePhaseHandOff:	return "handoff";
+	default:					return "unknown";
+	}
+}
+
+std::string DecodeProfiler::ToJson(const DecodeProfile &profile, const FramePoolStats &pool)
+{
+	// No snprintf in every runtime we build against, so stream it.
+	std::ostringstream json;
+	json.imbue(std::locale::classic());
+	json << std::fixed << std::setprecision(2);
+
+	json << "{\"frames\":" << profile.frames
+		<< ",\"seconds\":" << profile.wallSeconds
+		<< ",\"fps\":" << profile.FramesPerSecond()
+		<< ",\"inputBytes\":" << profile.inputBytes;
+
+	json << ",\"nsPerFrame\":{" << std::setprecision(0);
+	for (int phase = 0; phase < DecodePhaseCount; phase++)
+	{
+		DecodePhase p = static_cast<DecodePhase>(phase);
+		json << (phase ? "," : "") << "\"" << GetPhaseName(p) << "\":" << profile.NanosecondsPerFrame(p);
+	}
+	json << "}";
+
+	json << ",\"framePool\":{\"acquisitions\":" << pool.acquisitions
+		<< ",\"allocations\":" << pool.allocations
+		<< ",\"highWaterMark\":" << pool.highWaterMark << "}";
+
+	json << "}";
+	return json.str();
+}
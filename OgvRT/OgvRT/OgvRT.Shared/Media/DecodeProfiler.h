@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "FramePool.h"
+
+namespace OgvRT
+{
+	enum DecodePhase
+	{
+		DecodePhaseInput,		// Handing buffered input to the decoder.
+		DecodePhaseDemux,		// Decoder::process(): page sync and demux.
+		DecodePhaseAudio,		// Decoding Vorbis packets.
+		DecodePhaseVideo,		// Decoder::decodeFrame(), less the hand-off.
+		DecodePhaseHandOff,		// Copying the picture out into pooled storage.
+		DecodePhaseCount
+	};
+
+	struct DecodeProfile
+	{
+		uint64_t frames;
+		uint64_t inputBytes;
+		double wallSeconds;
+		uint64_t nanoseconds[DecodePhaseCount];
+
+		double FramesPerSecond() const { return wallSeconds > 0.0 ? frames / wallSeconds : 0.0; }
+		double NanosecondsPerFrame(DecodePhase phase) const { return frames ? static_cast<double>(nanoseconds[phase]) / frames : 0.0; }
+	};
+
+	// Accumulates where decode time goes, per frame, so regressions show up
+	// as numbers rather than as a feeling that playback got choppier.
+	// Not thread safe; it belongs to the thread doing the decoding.
+	class DecodeProfiler
+	{
+	public:
+		DecodeProfiler();
+
+		// Charges the lifetime of the scope to a phase. Scopes nest, and time
+		// spent in an inner scope isn't charged to the outer one as well.
+		class Scope
+		{
+		public:
+			Scope(DecodeProfiler &profiler, DecodePhase phase);
+			~Scope();
+
+		private:
+			Scope(const Scope &);
+			Scope &operator=(const Scope &);
+
+			DecodeProfiler &m_profiler;
+			DecodePhase m_outer;
+		};
+
+		void AddInputBytes(size_t bytes) { m_profile.inputBytes += bytes; }
+		void FrameDone() { m_profile.frames++; }
+
+		DecodeProfile GetProfile() const;
+		void Reset();
+
+		static const char *GetPhaseName(DecodePhase phase);
+
+		// One-line JSON object, for logging and comparing between builds.
+		static std::string ToJson(const DecodeProfile &profile, const FramePoolStats &pool);
+
+	private:
+		static int64_t Now();
+		void Charge(DecodePhase phase, int64_t now);
+
+		DecodeProfile m_profile;
+		int64_t m_start;
+
+		// Phase being timed, or DecodePhaseCount for none.
+		DecodePhase m_active;
+		int64_t m_activeStart;
+	};
+}
@@ -0,0 +1,133 @@
+﻿#include "pch.h"
+#include "DecodeWorker.h"
+
+#include <chrono>
+
+using namespace OgvRT;
+
+// How long the worker sleeps when there is nothing to decode or nowhere to put it.
+// Consumers wake it early when they free a slot.
+static const int IdleWaitMilliseconds = 2;
+static const int StallWaitMilliseconds = 5;
+
+DecodeWorker::DecodeWorker(const FrameProducer &producer, size_t queueDepth, BackpressurePolicy policy) :
+	m_producer(producer),
+	m_queue(queueDepth > 0 ? queueDepth : 1),
+	m_policy(policy),
+	m_running(false),
+	m_framesDecoded(0),
+	m_framesDropped(0),
+	m_framesSkipped(0),
+	m_producerStalls(0)
+{
+}
+
+DecodeWorker::~DecodeWorker()
+{
+	Stop();
+}
+
+void DecodeWorker::Start()
+{
+	if (m_running)
+	{
+		return;
+	}
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+	m_running = true;
+	m_thread = std::thread([this] { Run(); });
+}
+
+void DecodeWorker::Stop()
+{
+	m_running = false;
+	m_wake.notify_all();
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+const VideoFrame *DecodeWorker::PeekNext()
+{
+	return m_queue.Front();
+}
+
+bool DecodeWorker::DequeueDue(double presentationTime, VideoFrame &frame)
+{
+	bool found = false;
+	for (VideoFrame *next = m_queue.Front(); next != nullptr && next->timestamp <= presentationTime; next = m_queue.Front())
+	{
+		if (found)
+		{
+			m_framesSkipped++;
+		}
+		frame = std::move(*next);
+		m_queue.Pop();
+		found = true;
+	}
+	if (found)
+	{
+		m_wake.notify_one();
+	}
+	return found;
+}
+
+DecodeWorkerStats DecodeWorker::GetStats() const
+{
+	DecodeWorkerStats stats;
+	stats.framesDecoded = m_framesDecoded;
+	stats.framesDropped = m_framesDropped;
+	stats.framesSkipped = m_framesSkipped;
+	stats.producerStalls = m_producerStalls;
+	return stats;
+}
+
+void DecodeWorker::Run()
+{
+	VideoFrame pending;
+	bool havePending = false;
+
+	while (m_running)
+	{
+		if (!havePending)
+		{
+			havePending = m_producer(pending);
+			if (!havePending)
+			{
+				WaitForWork(IdleWaitMilliseconds);
+				continue;
+			}
+			m_framesDecoded++;
+		}
+
+		// TryPush leaves pending untouched when the queue is full.
+		if (m_queue.TryPush(std::move(pending)))
+		{
+			havePending = false;
+		}
+		else if (m_policy == DropWhenFull)
+		{
+			m_framesDropped++;
+			pending = VideoFrame();
+			havePending = false;
+		}
+		else
+		{
+			m_producerStalls++;
+			WaitForWork(StallWaitMilliseconds);
+		}
+	}
+}
+
+void DecodeWorker::WaitForWork(int milliseconds)
+{
+	std::unique_lock<std::mutex> lock(m_wakeMutex);
+	if (m_running)
+	{
+		m_wake.wait_for(lock, std::chrono::milliseconds(milliseconds));
+	}
+}
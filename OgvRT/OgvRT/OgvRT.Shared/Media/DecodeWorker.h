@@ -0,0 +1,82 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "SpscQueue.h"
+#include "VideoFrame.h"
+
+namespace OgvRT
+{
+	struct DecodeWorkerStats
+	{
+		uint64_t framesDecoded;		// Frames produced by the decoder.
+		uint64_t framesDropped;		// Decoded but discarded because the queue was full.
+		uint64_t framesSkipped;		// Dequeued too late and replaced by a newer frame.
+		uint64_t producerStalls;	// Times the worker waited for the queue to drain.
+	};
+
+	// Runs the decoder on a dedicated thread and hands finished frames to the
+	// render thread through a bounded single-producer/single-consumer queue,
+	// so a slow keyframe never holds up Present or input handling.
+	class DecodeWorker
+	{
+	public:
+		enum BackpressurePolicy
+		{
+			BlockWhenFull,	// Stop decoding until the renderer catches up.
+			DropWhenFull	// Keep decoding and discard frames that don't fit.
+		};
+
+		// Decodes the next frame into the argument. Returns false if no frame
+		// could be produced yet (e.g. still waiting for input). Only ever
+		// invoked on the worker thread.
+		typedef std::function<bool(VideoFrame &frame)> FrameProducer;
+
+		DecodeWorker(const FrameProducer &producer, size_t queueDepth = DefaultQueueDepth, BackpressurePolicy policy = BlockWhenFull);
+		~DecodeWorker();
+
+		static const size_t DefaultQueueDepth = 4;
+
+		void Start();
+		void Stop();
+		bool IsRunning() const { return m_running; }
+
+		// Render thread side. Returns the next queued frame without removing it, or nullptr.
+		const VideoFrame *PeekNext();
+
+		// Render thread side. Moves the newest frame due at presentationTime into
+		// frame, discarding any older ones it supersedes. Returns false if no
+		// frame is due yet.
+		bool DequeueDue(double presentationTime, VideoFrame &frame);
+
+		size_t GetQueueDepth() const { return m_queue.Capacity(); }
+		size_t GetQueuedFrames() const { return m_queue.Size(); }
+		DecodeWorkerStats GetStats() const;
+
+	private:
+		void Run();
+		void WaitForWork(int milliseconds);
+
+		DecodeWorker(const DecodeWorker &);
+		DecodeWorker &operator=(const DecodeWorker &);
+
+		FrameProducer m_producer;
+		SpscQueue<VideoFrame> m_queue;
+		BackpressurePolicy m_policy;
+
+		std::thread m_thread;
+		std::atomic<bool> m_running;
+		std::mutex m_wakeMutex;
+		std::condition_variable m_wake;
+
+		std::atomic<uint64_t> m_framesDecoded;
+		std::atomic<uint64_t> m_framesDropped;
+		std::atomic<uint64_t> m_framesSkipped;
+		std::atomic<uint64_t> m_producerStalls;
+	};
+}
@@ -0,0 +1,116 @@
+﻿#include "pch.h"
+#include "FramePool.h"
+
+#include <mutex>
+#include <vector>
+
+using namespace OgvRT;
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+FrameStorage::FrameStorage(const FrameGeometry &geometry) :
+	m_geometry(geometry)
+{
+	size_t lumaSize = AlignUp(static_cast<size_t>(geometry.lumaStride) * geometry.lumaHeight, PlaneAlignment);
+	size_t chromaSize = AlignUp(static_cast<size_t>(geometry.chromaStride) * geometry.chromaHeight, PlaneAlignment);
+	m_size = lumaSize + 2 * chromaSize;
+
+	// Over-allocate so the first plane can be aligned by hand.
+	m_block.reset(new uint8_t[m_size + PlaneAlignment]);
+	uint8_t *base = reinterpret_cast<uint8_t *>(AlignUp(reinterpret_cast<uintptr_t>(m_block.get()), PlaneAlignment));
+
+	m_planes[PlaneY] = base;
+	m_planes[PlaneCb] = base + lumaSize;
+	m_planes[PlaneCr] = base + lumaSize + chromaSize;
+}
+
+struct FramePool::State
+{
+	std::mutex mutex;
+	std::vector<std::unique_ptr<FrameStorage>> freeFrames;
+	size_t maxRetained;
+	FramePoolStats stats;
+
+	void Release(FrameStorage *storage)
+	{
+		std::unique_ptr<FrameStorage> owned(storage);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.outstanding--;
+
+		// A frame still out when the picture size changed comes back with the
+		// old geometry; keeping it would have the next Acquire miss and flush
+		// the good frames along with it. Anything that doesn't fit is freed.
+		bool stale = !freeFrames.empty() && freeFrames.back()->GetGeometry() != owned->GetGeometry();
+		if (!stale && freeFrames.size() < maxRetained)
+		{
+			freeFrames.push_back(std::move(owned));
+		}
+		stats.retained = freeFrames.size();
+	}
+};
+
+FramePool::FramePool(size_t maxRetained) :
+	m_state(std::make_shared<State>())
+{
+	m_state->maxRetained = maxRetained;
+	m_state->stats = FramePoolStats();
+}
+
+FrameHandle FramePool::Acquire(const FrameGeometry &geometry)
+{
+	std::unique_ptr<FrameStorage> storage;
+	{
+		std::lock_guard<std::mutex> lock(m_state->mutex);
+		auto &freeFrames = m_state->freeFrames;
+		auto &stats = m_state->stats;
+
+		stats.acquisitions++;
+		if (!freeFrames.empty() && freeFrames.back()->GetGeometry() == geometry)
+		{
+			storage = std::move(freeFrames.back());
+			freeFrames.pop_back();
+			stats.hits++;
+		}
+		else
+		{
+			// Either empty or the picture size changed; old frames won't be reused.
+			freeFrames.clear();
+			stats.allocations++;
+		}
+
+		stats.outstanding++;
+		if (stats.outstanding > stats.highWaterMark)
+		{
+			stats.highWaterMark = stats.outstanding;
+		}
+		stats.retained = freeFrames.size();
+	}
+
+	if (!storage)
+	{
+		storage.reset(new FrameStorage(geometry));
+	}
+
+	// The deleter keeps the pool state alive until every lent frame has come back.
+	auto state = m_state;
+	return FrameHandle(storage.release(), [state](FrameStorage *released) {
+		state->Release(released);
+	});
+}
+
+void FramePool::Trim()
+{
+	std::lock_guard<std::mutex> lock(m_state->mutex);
+	m_state->freeFrames.clear();
+	m_state->stats.retained = 0;
+}
+
+FramePoolStats FramePool::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_state->mutex);
+	return m_state->stats;
+}
@@ -0,0 +1,95 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <memory>
+
+namespace OgvRT
+{
+	// Plane layout of a YCbCr picture. Chroma subsampling is implied by the
+	// chroma dimensions relative to the luma ones.
+	struct FrameGeometry
+	{
+		int lumaStride;
+		int lumaHeight;
+		int chromaStride;
+		int chromaHeight;
+
+		FrameGeometry() : lumaStride(0), lumaHeight(0), chromaStride(0), chromaHeight(0) {}
+		FrameGeometry(int lumaStride, int lumaHeight, int chromaStride, int chromaHeight) :
+			lumaStride(lumaStride), lumaHeight(lumaHeight), chromaStride(chromaStride), chromaHeight(chromaHeight) {}
+
+		bool operator==(const FrameGeometry &other) const
+		{
+			return lumaStride == other.lumaStride && lumaHeight == other.lumaHeight &&
+				chromaStride == other.chromaStride && chromaHeight == other.chromaHeight;
+		}
+		bool operator!=(const FrameGeometry &other) const { return !(*this == other); }
+	};
+
+	// Storage for the three planes of one picture, carved out of a single
+	// allocation with each plane starting on a cache line boundary.
+	class FrameStorage
+	{
+	public:
+		enum Plane { PlaneY = 0, PlaneCb = 1, PlaneCr = 2 };
+
+		static const size_t PlaneAlignment = 64;
+
+		explicit FrameStorage(const FrameGeometry &geometry);
+
+		const FrameGeometry &GetGeometry() const { return m_geometry; }
+		uint8_t *GetPlane(Plane plane) const { return m_planes[plane]; }
+		size_t GetSize() const { return m_size; }
+
+	private:
+		FrameStorage(const FrameStorage &);
+		FrameStorage &operator=(const FrameStorage &);
+
+		FrameGeometry m_geometry;
+		std::unique_ptr<uint8_t[]> m_block;
+		uint8_t *m_planes[3];
+		size_t m_size;
+	};
+
+	// Ref-counted handle to pooled storage. When the last copy goes away the
+	// storage goes back to the pool it came from.
+	typedef std::shared_ptr<FrameStorage> FrameHandle;
+
+	struct FramePoolStats
+	{
+		uint64_t acquisitions;		// Total calls to Acquire.
+		uint64_t hits;				// Acquisitions satisfied from the free list.
+		uint64_t allocations;		// Acquisitions that had to allocate.
+		size_t outstanding;			// Frames currently lent out.
+		size_t highWaterMark;		// Most frames ever lent out at once.
+		size_t retained;			// Frames sitting in the free list.
+
+		double HitRate() const { return acquisitions ? static_cast<double>(hits) / acquisitions : 0.0; }
+	};
+
+	// Recycles frame storage so steady-state playback doesn't hit the allocator.
+	// Free frames are keyed by geometry; a geometry change flushes the old ones.
+	// Thread safe; frames may be released on any thread, even after the pool
+	// itself is gone.
+	class FramePool
+	{
+	public:
+		explicit FramePool(size_t maxRetained = DefaultMaxRetained);
+
+		static const size_t DefaultMaxRetained = 8;
+
+		FrameHandle Acquire(const FrameGeometry &geometry);
+
+		// Releases all free frames back to the system.
+		void Trim();
+
+		FramePoolStats GetStats() const;
+
+	private:
+		struct State;
+		std::shared_ptr<State> m_state;
+
+		FramePool(const FramePool &);
+		FramePool &operator=(const FramePool &);
+	};
+}
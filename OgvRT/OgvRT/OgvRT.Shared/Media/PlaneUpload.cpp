@@ -0,0 +1,127 @@
+﻿#include "pch.h"
+#include "PlaneUpload.h"
+
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define OGVRT_PLANE_UPLOAD_SSE2 1
+#elif defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define OGVRT_PLANE_UPLOAD_NEON 1
+#endif
+
+using namespace OgvRT;
+
+#ifdef OGVRT_PLANE_UPLOAD_SSE2
+// Copies a row with non-temporal 16-byte stores. The stores need an aligned
+// destination, so the unaligned head and the tail go through memcpy.
+static void StreamRow(uint8_t *dest, const uint8_t *src, size_t nbytes)
+{
+	size_t head = (16 - (reinterpret_cast<uintptr_t>(dest) & 15)) & 15;
+	if (head > nbytes)
+	{
+		head = nbytes;
+	}
+	memcpy(dest, src, head);
+	dest += head;
+	src += head;
+	nbytes -= head;
+
+	while (nbytes >= 64)
+	{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+		__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 32));
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 48));
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dest), a);
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dest + 16), b);
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dest + 32), c);
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dest + 48), d);
+		dest += 64;
+		src += 64;
+		nbytes -= 64;
+	}
+	while (nbytes >= 16)
+	{
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dest), _mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+		dest += 16;
+		src += 16;
+		nbytes -= 16;
+	}
+	memcpy(dest, src, nbytes);
+}
+#elif defined(OGVRT_PLANE_UPLOAD_NEON)
+// NEON has no non-temporal store we can reach from intrinsics, so this
+// settles for 64-byte register copies that don't care about alignment.
+static void StreamRow(uint8_t *dest, const uint8_t *src, size_t nbytes)
+{
+	while (nbytes >= 64)
+	{
+		uint8x16_t a = vld1q_u8(src);
+		uint8x16_t b = vld1q_u8(src + 16);
+		uint8x16_t c = vld1q_u8(src + 32);
+		uint8x16_t d = vld1q_u8(src + 48);
+		vst1q_u8(dest, a);
+		vst1q_u8(dest + 16, b);
+		vst1q_u8(dest + 32, c);
+		vst1q_u8(dest + 48, d);
+		dest += 64;
+		src += 64;
+		nbytes -= 64;
+	}
+	while (nbytes >= 16)
+	{
+		vst1q_u8(dest, vld1q_u8(src));
+		dest += 16;
+		src += 16;
+		nbytes -= 16;
+	}
+	memcpy(dest, src, nbytes);
+}
+#endif
+
+void OgvRT::UploadPlane(const uint8_t *src, size_t srcStride, const PlaneRect &crop, uint8_t *dest, size_t destPitch)
+{
+	if (crop.width <= 0 || crop.height <= 0)
+	{
+		return;
+	}
+
+	const uint8_t *srcRow = src + crop.y * srcStride + crop.x;
+	size_t rowBytes = static_cast<size_t>(crop.width);
+	size_t rows = static_cast<size_t>(crop.height);
+
+#ifdef OGVRT_PLANE_UPLOAD_SSE2
+	if (rowBytes * rows >= PlaneUploadStreamingThreshold)
+	{
+		for (size_t row = 0; row < rows; row++)
+		{
+			StreamRow(dest + row * destPitch, srcRow + row * srcStride, rowBytes);
+		}
+		// Make the streamed data visible before the caller unmaps.
+		_mm_sfence();
+		return;
+	}
+#elif defined(OGVRT_PLANE_UPLOAD_NEON)
+	if (rowBytes * rows >= PlaneUploadStreamingThreshold)
+	{
+		for (size_t row = 0; row < rows; row++)
+		{
+			StreamRow(dest + row * destPitch, srcRow + row * srcStride, rowBytes);
+		}
+		return;
+	}
+#endif
+
+	if (srcStride == rowBytes && destPitch == rowBytes)
+	{
+		memcpy(dest, srcRow, rowBytes * rows);
+		return;
+	}
+
+	for (size_t row = 0; row < rows; row++)
+	{
+		memcpy(dest + row * destPitch, srcRow + row * srcStride, rowBytes);
+	}
+}
@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace OgvRT
+{
+	// Visible region of a plane, in that plane's own pixels.
+	struct PlaneRect
+	{
+		int x;
+		int y;
+		int width;
+		int height;
+
+		PlaneRect() : x(0), y(0), width(0), height(0) {}
+		PlaneRect(int x, int y, int width, int height) : x(x), y(y), width(width), height(height) {}
+	};
+
+	// Planes at least this big are written with non-temporal stores, since they
+	// would only evict useful data from the cache on their way to the GPU.
+	static const size_t PlaneUploadStreamingThreshold = 256 * 1024;
+
+	// Copies the crop rectangle of an 8-bit plane row by row into a destination
+	// with its own pitch, such as a mapped texture or plain system memory.
+	// Padding on either side is never read or written.
+	void UploadPlane(const uint8_t *src, size_t srcStride, const PlaneRect &crop, uint8_t *dest, size_t destPitch);
+}
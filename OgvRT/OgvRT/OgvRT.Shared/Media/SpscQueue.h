@@ -0,0 +1,93 @@
+﻿#pragma once
+
+#include <atomic>
+#include <vector>
+
+namespace OgvRT
+{
+	// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+	// The producer only writes m_tail and the consumer only writes m_head, so no
+	// locks are needed; acquire/release ordering publishes the slot contents.
+	template<typename T>
+	class SpscQueue
+	{
+	public:
+		explicit SpscQueue(size_t capacity) :
+			m_slots(capacity + 1),
+			m_head(0),
+			m_tail(0)
+		{
+		}
+
+		size_t Capacity() const { return m_slots.size() - 1; }
+
+		size_t Size() const
+		{
+			size_t head = m_head.load(std::memory_order_acquire);
+			size_t tail = m_tail.load(std::memory_order_acquire);
+			return tail >= head ? tail - head : tail + m_slots.size() - head;
+		}
+
+		bool IsEmpty() const	{ return Size() == 0; }
+		bool IsFull() const		{ return Size() == Capacity(); }
+
+		// Producer side.
+		bool TryPush(T &&item)
+		{
+			size_t tail = m_tail.load(std::memory_order_relaxed);
+			size_t next = Next(tail);
+			if (next == m_head.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+			m_slots[tail] = std::move(item);
+			m_tail.store(next, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer side. Front returns nullptr when the queue is empty; the
+		// pointer stays valid until the next Pop.
+		T *Front()
+		{
+			size_t head = m_head.load(std::memory_order_relaxed);
+			if (head == m_tail.load(std::memory_order_acquire))
+			{
+				return nullptr;
+			}
+			return &m_slots[head];
+		}
+
+		bool TryPop(T &item)
+		{
+			T *front = Front();
+			if (front == nullptr)
+			{
+				return false;
+			}
+			item = std::move(*front);
+			Pop();
+			return true;
+		}
+
+		void Pop()
+		{
+			size_t head = m_head.load(std::memory_order_relaxed);
+			// Release whatever the slot held now rather than when it is next overwritten.
+			m_slots[head] = T();
+			m_head.store(Next(head), std::memory_order_release);
+		}
+
+	private:
+		size_t Next(size_t index) const { return index + 1 == m_slots.size() ? 0 : index + 1; }
+
+		SpscQueue(const SpscQueue &);
+		SpscQueue &operator=(const SpscQueue &);
+
+		std::vector<T> m_slots;
+
+		// Keep the two indices on separate cache lines so the threads don't false-share.
+		std::atomic<size_t> m_head;
+		char m_padding[64 - sizeof(std::atomic<size_t>)];
+		std::atomic<size_t> m_tail;
+	};
+}
@@ -0,0 +1,105 @@
+﻿#include "pch.h"
+#include "StreamingInput.h"
+
+using namespace OgvRT;
+
+StreamingInput::StreamingInput(size_t chunkSize, size_t readAheadBytes) :
+	m_chunkSize(chunkSize > 0 ? chunkSize : DefaultChunkSize),
+	m_readAheadBytes(readAheadBytes > m_chunkSize ? readAheadBytes : m_chunkSize),
+	m_bufferedBytes(0),
+	m_totalBytesReceived(0),
+	m_endOfStream(false),
+	m_cancelled(false)
+{
+}
+
+bool StreamingInput::Write(const uint8_t *data, size_t nbytes)
+{
+	while (nbytes > 0)
+	{
+		size_t len = nbytes < m_chunkSize ? nbytes : m_chunkSize;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_spaceAvailable.wait(lock, [this, len] {
+			return m_cancelled || m_bufferedBytes + len <= m_readAheadBytes;
+		});
+		if (m_cancelled)
+		{
+			return false;
+		}
+
+		m_chunks.emplace_back(data, data + len);
+		m_bufferedBytes += len;
+		m_totalBytesReceived += len;
+
+		data += len;
+		nbytes -= len;
+	}
+	return true;
+}
+
+void StreamingInput::EndOfStream()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_endOfStream = true;
+}
+
+void StreamingInput::Cancel()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_cancelled = true;
+		m_endOfStream = true;
+		m_chunks.clear();
+		m_bufferedBytes = 0;
+	}
+	m_spaceAvailable.notify_all();
+}
+
+size_t StreamingInput::Drain(size_t maxBytes, const ChunkHandler &handler)
+{
+	size_t delivered = 0;
+	while (delivered < maxBytes)
+	{
+		std::vector<uint8_t> chunk;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_chunks.empty())
+			{
+				break;
+			}
+			chunk.swap(m_chunks.front());
+			m_chunks.pop_front();
+			m_bufferedBytes -= chunk.size();
+		}
+		m_spaceAvailable.notify_one();
+
+		delivered += chunk.size();
+		handler(chunk);
+	}
+	return delivered;
+}
+
+bool StreamingInput::IsComplete() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_endOfStream && m_chunks.empty();
+}
+
+bool StreamingInput::IsCancelled() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_cancelled;
+}
+
+size_t StreamingInput::GetBufferedBytes() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_bufferedBytes;
+}
+
+uint64_t StreamingInput::GetTotalBytesReceived() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_totalBytesReceived;
+}
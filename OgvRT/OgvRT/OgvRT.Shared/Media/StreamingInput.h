@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace OgvRT
+{
+	// Bounded hand-off buffer between a network or file reader and the decoder.
+	// The reader blocks once the read-ahead window is full, so memory use stays
+	// bounded by the window rather than by the size of the input.
+	class StreamingInput
+	{
+	public:
+		typedef std::function<void(std::vector<uint8_t> &chunk)> ChunkHandler;
+
+		StreamingInput(size_t chunkSize = DefaultChunkSize, size_t readAheadBytes = DefaultReadAheadBytes);
+
+		static const size_t DefaultChunkSize = 64 * 1024;
+		static const size_t DefaultReadAheadBytes = 1024 * 1024;
+
+		size_t GetChunkSize() const			{ return m_chunkSize; }
+		size_t GetReadAheadBytes() const	{ return m_readAheadBytes; }
+
+		// Producer side; called from the reader thread.
+		// Write blocks while the window is full and returns false once cancelled.
+		bool Write(const uint8_t *data, size_t nbytes);
+		void EndOfStream();
+		void Cancel();
+
+		// Consumer side; never blocks. Hands queued chunks to the handler in
+		// arrival order until at least maxBytes have been delivered or the
+		// queue runs dry. Returns the number of bytes delivered.
+		size_t Drain(size_t maxBytes, const ChunkHandler &handler);
+
+		// True once the reader has finished and every byte has been drained.
+		bool IsComplete() const;
+		bool IsCancelled() const;
+		size_t GetBufferedBytes() const;
+		uint64_t GetTotalBytesReceived() const;
+
+	private:
+		const size_t m_chunkSize;
+		const size_t m_readAheadBytes;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_spaceAvailable;
+		std::deque<std::vector<uint8_t>> m_chunks;
+		size_t m_bufferedBytes;
+		uint64_t m_totalBytesReceived;
+		bool m_endOfStream;
+		bool m_cancelled;
+	};
+}
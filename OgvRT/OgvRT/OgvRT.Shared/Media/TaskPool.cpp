@@ -0,0 +1,242 @@
+﻿#include "pch.h"
+#include "TaskPool.h"
+
+using namespace OgvRT;
+
+// Upper bound on how long a waiting thread sleeps before looking for work
+// again; completions normally wake it sooner.
+static const int WaitPollMicroseconds = 500;
+
+// Created on first use and never destroyed, so tasks still running at exit
+// don't find it torn down. Not a function-local static because those
+// aren't initialized thread-safely by every compiler we build with.
+static std::once_flag s_sharedOnce;
+static TaskPool *s_shared = nullptr;
+
+static int64_t NowNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TaskPool::TaskPool(unsigned workerCount) :
+	m_nextQueue(0),
+	m_pending(0),
+	m_stopping(false),
+	m_tasksRun(0),
+	m_tasksStolen(0),
+	m_busyNanoseconds(0),
+	m_statsStart(NowNanoseconds())
+{
+	if (workerCount == 0)
+	{
+		unsigned cores = std::thread::hardware_concurrency();
+		workerCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	for (unsigned i = 0; i < workerCount; i++)
+	{
+		m_workers.emplace_back(new Worker());
+	}
+	// Start the threads only once every queue exists; they steal from each other.
+	for (unsigned i = 0; i < workerCount; i++)
+	{
+		m_threads.emplace_back([this, i] { WorkerLoop(static_cast<int>(i)); });
+	}
+}
+
+TaskPool::~TaskPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for (auto &thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+TaskPool &TaskPool::Shared()
+{
+	std::call_once(s_sharedOnce, [] {
+		s_shared = new TaskPool();
+	});
+	return *s_shared;
+}
+
+void TaskPool::Submit(TaskGroup &group, const Task &task)
+{
+	group.m_outstanding++;
+
+	// Tasks spawned by a worker go on its own queue, where it will find them
+	// first; others are dealt round the workers.
+	int self = FindSelf();
+	unsigned queue = self >= 0 ? static_cast<unsigned>(self) : m_nextQueue++ % m_workers.size();
+
+	Entry entry;
+	entry.task = task;
+	entry.group = &group;
+	m_pending++;
+	{
+		std::lock_guard<std::mutex> lock(m_workers[queue]->mutex);
+		m_workers[queue]->tasks.push_back(std::move(entry));
+	}
+
+	// Taking the lock orders this against a worker checking m_pending before it sleeps.
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+	}
+	m_wake.notify_one();
+}
+
+void TaskPool::Wait(TaskGroup &group)
+{
+	int self = FindSelf();
+	while (group.m_outstanding.load() > 0)
+	{
+		if (TryRunOne(self))
+		{
+			continue;
+		}
+		// Everything left is running elsewhere.
+		std::unique_lock<std::mutex> lock(group.m_mutex);
+		group.m_done.wait_for(lock, std::chrono::microseconds(WaitPollMicroseconds), [&group] {
+			return group.m_outstanding.load() == 0;
+		});
+	}
+
+	// The last task signals under the group's lock; don't let the group go
+	// out of scope while it still holds it.
+	std::lock_guard<std::mutex> lock(group.m_mutex);
+}
+
+void TaskPool::ParallelFor(int count, const std::function<void(int)> &body)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	TaskGroup group;
+	for (int i = 1; i < count; i++)
+	{
+		Submit(group, [&body, i] { body(i); });
+	}
+	body(0);
+	Wait(group);
+}
+
+TaskPoolStats TaskPool::GetStats() const
+{
+	TaskPoolStats stats;
+	stats.workers = GetWorkerCount();
+	stats.tasksRun = m_tasksRun.load();
+	stats.tasksStolen = m_tasksStolen.load();
+	stats.wallSeconds = (NowNanoseconds() - m_statsStart.load()) / 1e9;
+	stats.busySeconds = m_busyNanoseconds.load() / 1e9;
+	return stats;
+}
+
+void TaskPool::ResetStats()
+{
+	m_tasksRun = 0;
+	m_tasksStolen = 0;
+	m_busyNanoseconds = 0;
+	m_statsStart = NowNanoseconds();
+}
+
+int TaskPool::FindSelf() const
+{
+	std::thread::id id = std::this_thread::get_id();
+	for (size_t i = 0; i < m_threads.size(); i++)
+	{
+		if (m_threads[i].get_id() == id)
+		{
+			return static_cast<int>(i);
+		}
+	}
+	return -1;
+}
+
+// Runs the newest task on our own queue, or else the oldest on anyone
+// else's. Threads outside the pool only steal.
+bool TaskPool::TryRunOne(int self)
+{
+	Entry entry;
+	bool found = false;
+
+	if (self >= 0)
+	{
+		Worker &worker = *m_workers[self];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (!worker.tasks.empty())
+		{
+			entry = std::move(worker.tasks.back());
+			worker.tasks.pop_back();
+			found = true;
+		}
+	}
+
+	size_t count = m_workers.size();
+	size_t start = self >= 0 ? static_cast<size_t>(self) + 1 : m_nextQueue.load();
+	for (size_t i = 0; i < count && !found; i++)
+	{
+		size_t victim = (start + i) % count;
+		if (static_cast<int>(victim) == self)
+		{
+			continue;
+		}
+		Worker &worker = *m_workers[victim];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (!worker.tasks.empty())
+		{
+			entry = std::move(worker.tasks.front());
+			worker.tasks.pop_front();
+			found = true;
+			m_tasksStolen++;
+		}
+	}
+
+	if (!found)
+	{
+		return false;
+	}
+	m_pending--;
+	RunEntry(entry);
+	return true;
+}
+
+void TaskPool::RunEntry(Entry &entry)
+{
+	entry.task();
+	m_tasksRun++;
+
+	TaskGroup &group = *entry.group;
+	std::lock_guard<std::mutex> lock(group.m_mutex);
+	if (--group.m_outstanding == 0)
+	{
+		group.m_done.notify_all();
+	}
+}
+
+void TaskPool::WorkerLoop(int index)
+{
+	for (;;)
+	{
+		// Timed here rather than per task so nested tasks aren't counted twice.
+		int64_t start = NowNanoseconds();
+		if (TryRunOne(index))
+		{
+			m_busyNanoseconds += static_cast<uint64_t>(NowNanoseconds() - start);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wake.wait(lock, [this] { return m_stopping || m_pending.load() > 0; });
+		if (m_stopping && m_pending.load() == 0)
+		{
+			return;
+		}
+	}
+}
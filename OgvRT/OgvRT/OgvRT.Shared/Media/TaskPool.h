@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+namespace OgvRT
+{
+	struct TaskPoolStats
+	{
+		unsigned workers;
+		uint64_t tasksRun;			// Including tasks run by threads waiting on a group.
+		uint64_t tasksStolen;		// Taken from another worker's queue.
+		double wallSeconds;			// Since construction or the last ResetStats.
+		double busySeconds;			// Summed over the workers; callers helping in Wait aren't counted.
+
+		// Fraction of the workers' time spent running tasks.
+		double Utilization() const
+		{
+			return wallSeconds > 0.0 && workers > 0 ? busySeconds / (wallSeconds * workers) : 0.0;
+		}
+	};
+
+	// Tracks a batch of tasks so the submitter can wait for all of them.
+	class TaskGroup
+	{
+	public:
+		TaskGroup() : m_outstanding(0) {}
+
+	private:
+		friend class TaskPool;
+
+		TaskGroup(const TaskGroup &);
+		TaskGroup &operator=(const TaskGroup &);
+
+		std::atomic<int> m_outstanding;
+		std::mutex m_mutex;
+		std::condition_variable m_done;
+	};
+
+	// Fixed set of worker threads, each with its own task queue. Workers run
+	// their own newest tasks first and, when idle, steal the oldest from the
+	// others, so uneven batches still spread across every core. A thread
+	// waiting on a group runs queued tasks meanwhile, which keeps nested
+	// waits from deadlocking and puts the caller's core to work too.
+	class TaskPool
+	{
+	public:
+		typedef std::function<void(void)> Task;
+
+		// A worker count of 0 uses one per hardware core, less one for the
+		// thread that submits and waits.
+		explicit TaskPool(unsigned workerCount = 0);
+		~TaskPool();
+
+		// Process-wide pool, created on first use.
+		static TaskPool &Shared();
+
+		unsigned GetWorkerCount() const { return static_cast<unsigned>(m_workers.size()); }
+
+		void Submit(TaskGroup &group, const Task &task);
+		void Wait(TaskGroup &group);
+
+		// Runs body(0) .. body(count - 1) across the pool and the calling thread.
+		void ParallelFor(int count, const std::function<void(int)> &body);
+
+		TaskPoolStats GetStats() const;
+		void ResetStats();
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		struct Entry
+		{
+			Task task;
+			TaskGroup *group;
+		};
+
+		struct Worker
+		{
+			std::mutex mutex;
+			std::deque<Entry> tasks;
+		};
+
+		TaskPool(const TaskPool &);
+		TaskPool &operator=(const TaskPool &);
+
+		int FindSelf() const;
+		bool TryRunOne(int self);
+		void RunEntry(Entry &entry);
+		void WorkerLoop(int index);
+
+		std::vector<std::unique_ptr<Worker>> m_workers;
+		std::vector<std::thread> m_threads;
+
+		std::atomic<unsigned> m_nextQueue;
+		std::atomic<size_t> m_pending;
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wake;
+		bool m_stopping;
+
+		std::atomic<uint64_t> m_tasksRun;
+		std::atomic<uint64_t> m_tasksStolen;
+		std::atomic<uint64_t> m_busyNanoseconds;
+		std::atomic<int64_t> m_statsStart;
+	};
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include <cstdint>
+
+#include "FramePool.h"
+#include "PlaneUpload.h"
+
+namespace OgvRT
+{
+	// One plane of a decoded picture.
+	struct VideoPlane
+	{
+		uint8_t *bytes;
+		int stride;
+		int height;
+
+		VideoPlane() : bytes(nullptr), stride(0), height(0) {}
+	};
+
+	// A decoded YCbCr picture that can outlive the decoder callback which
+	// produced it. The planes point into pooled storage, which stays alive
+	// for as long as any copy of the frame does.
+	struct VideoFrame
+	{
+		double timestamp;
+		VideoPlane Y, Cb, Cr;
+		FrameHandle storage;
+
+		// Visible area within the luma plane; the planes may be padded beyond it.
+		PlaneRect picture;
+
+		// Chroma subsampling as log2 shifts: 4:2:0 is (1, 1), 4:4:4 is (0, 0).
+		int hdec;
+		int vdec;
+
+		VideoFrame() : timestamp(0.0), hdec(1), vdec(1) {}
+
+		// Visible area within the chroma planes, rounded out to whole chroma samples.
+		PlaneRect ChromaPicture() const
+		{
+			int x = picture.x >> hdec;
+			int y = picture.y >> vdec;
+			int right = (picture.x + picture.width + (1 << hdec) - 1) >> hdec;
+			int bottom = (picture.y + picture.height + (1 << vdec) - 1) >> vdec;
+			return PlaneRect(x, y, right - x, bottom - y);
+		}
+	};
+}
@@ -0,0 +1,435 @@
+﻿#include "pch.h"
+#include "YCbCrConverter.h"
+
+#include <vector>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define OGVRT_YCBCR_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(_M_ARM) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OGVRT_YCBCR_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC and clang only emit AVX2 code in functions that ask for it.
+#if defined(__GNUC__)
+#define OGVRT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define OGVRT_TARGET_AVX2
+#endif
+
+using namespace OgvRT;
+
+// SamplePixelShader.hlsl coefficients scaled by 4096. The shader works on
+// normalized values, so its offsets are scaled by 255 as well; the rounding
+// term for the final shift is folded into the biases.
+static const int ScaleBits = 12;
+static const int CoefY = 4769;		// 1.1643828125
+static const int CoefRCr = 6537;	// 1.59602734375
+static const int CoefGCb = -1605;	// -0.39176171875
+static const int CoefGCr = -3330;	// -0.81296875
+static const int CoefBCb = 8263;	// 2.017234375
+static const int BiasR = -909518 + (1 << (ScaleBits - 1));	// -0.87078515625
+static const int BiasG = 553150 + (1 << (ScaleBits - 1));	// 0.52959375
+static const int BiasB = -1129491 + (1 << (ScaleBits - 1));	// -1.081390625
+
+static inline uint8_t Clamp8(int value)
+{
+	return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// Reference kernel. phase is 1 when the first pixel is the second of a
+// horizontally subsampled chroma pair.
+static void ConvertRowScalar(const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint8_t *bgra, int width, int hdec, int phase)
+{
+	for (int x = 0; x < width; x++)
+	{
+		int c = (x + phase) >> hdec;
+		int luma = CoefY * y[x];
+		int blue = cb[c];
+		int red = cr[c];
+		bgra[4 * x + 0] = Clamp8((luma + CoefBCb * blue + BiasB) >> ScaleBits);
+		bgra[4 * x + 1] = Clamp8((luma + CoefGCb * blue + CoefGCr * red + BiasG) >> ScaleBits);
+		bgra[4 * x + 2] = Clamp8((luma + CoefRCr * red + BiasR) >> ScaleBits);
+		bgra[4 * x + 3] = 255;
+	}
+}
+
+#ifdef OGVRT_YCBCR_X86
+// Each SIMD kernel converts as many whole blocks as fit and returns the pixel
+// count it handled; the scalar kernel finishes the row.
+
+// Packs a pair of 16-bit coefficients for pmaddwd against (Y, chroma) pairs.
+static inline int CoefPair(int lumaCoef, int chromaCoef)
+{
+	return static_cast<int>((static_cast<uint32_t>(static_cast<uint16_t>(chromaCoef)) << 16) | static_cast<uint16_t>(lumaCoef));
+}
+
+static inline void StoreBGRA(uint8_t *bgra, __m128i b, __m128i g, __m128i r)
+{
+	const __m128i a = _mm_set1_epi8(-1);
+	__m128i bgLo = _mm_unpacklo_epi8(b, g);
+	__m128i bgHi = _mm_unpackhi_epi8(b, g);
+	__m128i raLo = _mm_unpacklo_epi8(r, a);
+	__m128i raHi = _mm_unpackhi_epi8(r, a);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(bgra), _mm_unpacklo_epi16(bgLo, raLo));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(bgra + 16), _mm_unpackhi_epi16(bgLo, raLo));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(bgra + 32), _mm_unpacklo_epi16(bgHi, raHi));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(bgra + 48), _mm_unpackhi_epi16(bgHi, raHi));
+}
+
+// Loads 16 pixels' worth of chroma, replicating samples when subsampled.
+static inline __m128i LoadChroma16(const uint8_t *c, int hdec)
+{
+	if (hdec)
+	{
+		__m128i half = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(c));
+		return _mm_unpacklo_epi8(half, half);
+	}
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(c));
+}
+
+// Evaluates one output channel for 8 pixels of interleaved 16-bit pairs.
+static inline __m128i Channel8(__m128i pairsLo, __m128i pairsHi, __m128i coef, __m128i bias)
+{
+	__m128i lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(pairsLo, coef), bias), ScaleBits);
+	__m128i hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(pairsHi, coef), bias), ScaleBits);
+	return _mm_packs_epi32(lo, hi);
+}
+
+static int ConvertRowSSE2(const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint8_t *bgra, int width, int hdec)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i coefR = _mm_set1_epi32(CoefPair(CoefY, CoefRCr));
+	const __m128i coefGCb = _mm_set1_epi32(CoefPair(CoefY, CoefGCb));
+	const __m128i coefGCr = _mm_set1_epi32(CoefPair(0, CoefGCr));
+	const __m128i coefB = _mm_set1_epi32(CoefPair(CoefY, CoefBCb));
+	const __m128i biasR = _mm_set1_epi32(BiasR);
+	const __m128i biasG = _mm_set1_epi32(BiasG);
+	const __m128i biasB = _mm_set1_epi32(BiasB);
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+		__m128i cb8 = LoadChroma16(cb + (x >> hdec), hdec);
+		__m128i cr8 = LoadChroma16(cr + (x >> hdec), hdec);
+
+		__m128i out[3][2];
+		for (int half = 0; half < 2; half++)
+		{
+			__m128i y16 = half ? _mm_unpackhi_epi8(y8, zero) : _mm_unpacklo_epi8(y8, zero);
+			__m128i cb16 = half ? _mm_unpackhi_epi8(cb8, zero) : _mm_unpacklo_epi8(cb8, zero);
+			__m128i cr16 = half ? _mm_unpackhi_epi8(cr8, zero) : _mm_unpacklo_epi8(cr8, zero);
+
+			__m128i yCbLo = _mm_unpacklo_epi16(y16, cb16), yCbHi = _mm_unpackhi_epi16(y16, cb16);
+			__m128i yCrLo = _mm_unpacklo_epi16(y16, cr16), yCrHi = _mm_unpackhi_epi16(y16, cr16);
+
+			out[0][half] = Channel8(yCbLo, yCbHi, coefB, biasB);
+			out[2][half] = Channel8(yCrLo, yCrHi, coefR, biasR);
+
+			// Green needs all three inputs, so sum both pair products before shifting.
+			__m128i gLo = _mm_add_epi32(_mm_madd_epi16(yCbLo, coefGCb), _mm_madd_epi16(yCrLo, coefGCr));
+			__m128i gHi = _mm_add_epi32(_mm_madd_epi16(yCbHi, coefGCb), _mm_madd_epi16(yCrHi, coefGCr));
+			gLo = _mm_srai_epi32(_mm_add_epi32(gLo, biasG), ScaleBits);
+			gHi = _mm_srai_epi32(_mm_add_epi32(gHi, biasG), ScaleBits);
+			out[1][half] = _mm_packs_epi32(gLo, gHi);
+		}
+
+		StoreBGRA(bgra + 4 * x,
+			_mm_packus_epi16(out[0][0], out[0][1]),
+			_mm_packus_epi16(out[1][0], out[1][1]),
+			_mm_packus_epi16(out[2][0], out[2][1]));
+	}
+	return x;
+}
+
+OGVRT_TARGET_AVX2
+static inline __m256i Channel16(__m256i pairsLo, __m256i pairsHi, __m256i coef, __m256i bias)
+{
+	__m256i lo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(pairsLo, coef), bias), ScaleBits);
+	__m256i hi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(pairsHi, coef), bias), ScaleBits);
+	// Per-lane unpack and pack cancel out, leaving the 16 results in pixel order.
+	return _mm256_packs_epi32(lo, hi);
+}
+
+OGVRT_TARGET_AVX2
+static inline __m128i Narrow16(__m256i v)
+{
+	return _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+}
+
+OGVRT_TARGET_AVX2
+static int ConvertRowAVX2(const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint8_t *bgra, int width, int hdec)
+{
+	const __m256i coefR = _mm256_set1_epi32(CoefPair(CoefY, CoefRCr));
+	const __m256i coefGCb = _mm256_set1_epi32(CoefPair(CoefY, CoefGCb));
+	const __m256i coefGCr = _mm256_set1_epi32(CoefPair(0, CoefGCr));
+	const __m256i coefB = _mm256_set1_epi32(CoefPair(CoefY, CoefBCb));
+	const __m256i biasR = _mm256_set1_epi32(BiasR);
+	const __m256i biasG = _mm256_set1_epi32(BiasG);
+	const __m256i biasB = _mm256_set1_epi32(BiasB);
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		__m256i y16 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x)));
+		__m256i cb16 = _mm256_cvtepu8_epi16(LoadChroma16(cb + (x >> hdec), hdec));
+		__m256i cr16 = _mm256_cvtepu8_epi16(LoadChroma16(cr + (x >> hdec), hdec));
+
+		__m256i yCbLo = _mm256_unpacklo_epi16(y16, cb16), yCbHi = _mm256_unpackhi_epi16(y16, cb16);
+		__m256i yCrLo = _mm256_unpacklo_epi16(y16, cr16), yCrHi = _mm256_unpackhi_epi16(y16, cr16);
+
+		__m256i b = Channel16(yCbLo, yCbHi, coefB, biasB);
+		__m256i r = Channel16(yCrLo, yCrHi, coefR, biasR);
+
+		__m256i gLo = _mm256_add_epi32(_mm256_madd_epi16(yCbLo, coefGCb), _mm256_madd_epi16(yCrLo, coefGCr));
+		__m256i gHi = _mm256_add_epi32(_mm256_madd_epi16(yCbHi, coefGCb), _mm256_madd_epi16(yCrHi, coefGCr));
+		gLo = _mm256_srai_epi32(_mm256_add_epi32(gLo, biasG), ScaleBits);
+		gHi = _mm256_srai_epi32(_mm256_add_epi32(gHi, biasG), ScaleBits);
+		__m256i g = _mm256_packs_epi32(gLo, gHi);
+
+		StoreBGRA(bgra + 4 * x, Narrow16(b), Narrow16(g), Narrow16(r));
+	}
+	return x;
+}
+
+static bool CpuHasAVX2()
+{
+	int info[4];
+#ifdef _MSC_VER
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+	__cpuid(info, 1);
+#else
+	unsigned int a, b, c, d;
+	if (!__get_cpuid(1, &a, &b, &c, &d))
+	{
+		return false;
+	}
+	info[2] = static_cast<int>(c);
+#endif
+	// The OS must save the YMM registers across context switches.
+	const int osxsave = 1 << 27, avx = 1 << 28;
+	if ((info[2] & (osxsave | avx)) != (osxsave | avx))
+	{
+		return false;
+	}
+#ifdef _MSC_VER
+	if ((_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	unsigned int xcr0Lo, xcr0Hi;
+	__asm__("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+	if ((xcr0Lo & 6) != 6)
+	{
+		return false;
+	}
+	if (!__get_cpuid_count(7, 0, &a, &b, &c, &d))
+	{
+		return false;
+	}
+	return (b & (1 << 5)) != 0;
+#endif
+}
+
+// Probed once at startup rather than on first use, as function-local statics
+// aren't initialized thread-safely by every compiler we build with.
+static const bool s_cpuHasAVX2 = CpuHasAVX2();
+#endif
+
+#ifdef OGVRT_YCBCR_NEON
+static inline uint8x8_t ChannelNEON(int32x4_t lo, int32x4_t hi, int32x4_t bias)
+{
+	int16x8_t wide = vcombine_s16(vshrn_n_s32(vaddq_s32(lo, bias), ScaleBits), vshrn_n_s32(vaddq_s32(hi, bias), ScaleBits));
+	return vqmovun_s16(wide);
+}
+
+static int ConvertRowNEON(const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint8_t *bgra, int width, int hdec)
+{
+	const int32x4_t biasR = vdupq_n_s32(BiasR);
+	const int32x4_t biasG = vdupq_n_s32(BiasG);
+	const int32x4_t biasB = vdupq_n_s32(BiasB);
+
+	int x = 0;
+	for (; x + 8 <= width; x += 8)
+	{
+		uint8x8_t cb8, cr8;
+		if (hdec)
+		{
+			// Duplicate 4 chroma samples out to 8 pixels.
+			uint8x8_t cbHalf = vreinterpret_u8_u32(vld1_dup_u32(reinterpret_cast<const uint32_t *>(cb + (x >> 1))));
+			uint8x8_t crHalf = vreinterpret_u8_u32(vld1_dup_u32(reinterpret_cast<const uint32_t *>(cr + (x >> 1))));
+			cb8 = vzip_u8(cbHalf, cbHalf).val[0];
+			cr8 = vzip_u8(crHalf, crHalf).val[0];
+		}
+		else
+		{
+			cb8 = vld1_u8(cb + x);
+			cr8 = vld1_u8(cr + x);
+		}
+
+		int16x8_t y16 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + x)));
+		int16x8_t cb16 = vreinterpretq_s16_u16(vmovl_u8(cb8));
+		int16x8_t cr16 = vreinterpretq_s16_u16(vmovl_u8(cr8));
+
+		int32x4_t lumaLo = vmull_n_s16(vget_low_s16(y16), CoefY);
+		int32x4_t lumaHi = vmull_n_s16(vget_high_s16(y16), CoefY);
+
+		uint8x8x4_t out;
+		out.val[0] = ChannelNEON(
+			vmlal_n_s16(lumaLo, vget_low_s16(cb16), CoefBCb),
+			vmlal_n_s16(lumaHi, vget_high_s16(cb16), CoefBCb), biasB);
+		out.val[1] = ChannelNEON(
+			vmlal_n_s16(vmlal_n_s16(lumaLo, vget_low_s16(cb16), CoefGCb), vget_low_s16(cr16), CoefGCr),
+			vmlal_n_s16(vmlal_n_s16(lumaHi, vget_high_s16(cb16), CoefGCb), vget_high_s16(cr16), CoefGCr), biasG);
+		out.val[2] = ChannelNEON(
+			vmlal_n_s16(lumaLo, vget_low_s16(cr16), CoefRCr),
+			vmlal_n_s16(lumaHi, vget_high_s16(cr16), CoefRCr), biasR);
+		out.val[3] = vdup_n_u8(255);
+		vst4_u8(bgra + 4 * x, out);
+	}
+	return x;
+}
+#endif
+
+bool YCbCrConverter::IsKernelSupported(YCbCrKernel kernel)
+{
+	switch (kernel)
+	{
+	case YCbCrKernelAuto:
+	case YCbCrKernelScalar:
+		return true;
+#ifdef OGVRT_YCBCR_X86
+	case YCbCrKernelSSE2:
+		return true;
+	case YCbCrKernelAVX2:
+		return s_cpuHasAVX2;
+#endif
+#ifdef OGVRT_YCBCR_NEON
+	case YCbCrKernelNEON:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+const char *YCbCrConverter::GetKernelName(YCbCrKernel kernel)
+{
+	switch (kernel)
+	{
+	case YCbCrKernelAuto: return "auto";
+	case YCbCrKernelScalar: return "scalar";
+	case YCbCrKernelSSE2: return "sse2";
+	case YCbCrKernelAVX2: return "avx2";
+	case YCbCrKernelNEON: return "neon";
+	default: return "unknown";
+	}
+}
+
+YCbCrConverter::YCbCrConverter(YCbCrKernel kernel, unsigned threadCount) :
+	m_kernel(kernel),
+	m_threadCount(threadCount)
+{
+	if (m_kernel == YCbCrKernelAuto || !IsKernelSupported(m_kernel))
+	{
+		static const YCbCrKernel preference[] = { YCbCrKernelAVX2, YCbCrKernelNEON, YCbCrKernelSSE2, YCbCrKernelScalar };
+		for (auto candidate : preference)
+		{
+			if (IsKernelSupported(candidate))
+			{
+				m_kernel = candidate;
+				break;
+			}
+		}
+	}
+	if (m_threadCount == 0)
+	{
+		// The shared pool's workers plus the calling thread.
+		m_threadCount = TaskPool::Shared().GetWorkerCount() + 1;
+	}
+}
+
+void YCbCrConverter::Convert(const VideoFrame &frame, uint8_t *dest, size_t destPitch) const
+{
+	int rows = frame.picture.height;
+
+	// Not worth waking other cores for small pictures.
+	static const int MinRowsPerThread = 32;
+	unsigned threads = m_threadCount;
+	if (threads > static_cast<unsigned>(rows / MinRowsPerThread))
+	{
+		threads = rows / MinRowsPerThread;
+	}
+	if (threads <= 1)
+	{
+		ConvertRows(frame, dest, destPitch, 0, rows);
+		return;
+	}
+
+	// Split into even-sized bands so each chroma row belongs to one thread.
+	int band = ((rows + threads - 1) / threads + 1) & ~1;
+	int bands = (rows + band - 1) / band;
+	TaskPool::Shared().ParallelFor(bands, [this, &frame, dest, destPitch, band, rows](int index) {
+		int first = index * band;
+		int last = first + band < rows ? first + band : rows;
+		ConvertRows(frame, dest, destPitch, first, last);
+	});
+}
+
+void YCbCrConverter::ConvertRows(const VideoFrame &frame, uint8_t *dest, size_t destPitch, int firstRow, int lastRow) const
+{
+	const PlaneRect &picture = frame.picture;
+	int hdec = frame.hdec;
+	int phase = picture.x & hdec;
+
+	for (int row = firstRow; row < lastRow; row++)
+	{
+		int lumaRow = picture.y + row;
+		int chromaRow = lumaRow >> frame.vdec;
+		const uint8_t *y = frame.Y.bytes + lumaRow * frame.Y.stride + picture.x;
+		const uint8_t *cb = frame.Cb.bytes + chromaRow * frame.Cb.stride + (picture.x >> hdec);
+		const uint8_t *cr = frame.Cr.bytes + chromaRow * frame.Cr.stride + (picture.x >> hdec);
+		uint8_t *bgra = dest + row * destPitch;
+
+		// The SIMD kernels assume chroma pairs start on the first pixel.
+		int done = 0;
+		if (phase == 0)
+		{
+			switch (m_kernel)
+			{
+#ifdef OGVRT_YCBCR_X86
+			case YCbCrKernelSSE2:
+				done = ConvertRowSSE2(y, cb, cr, bgra, picture.width, hdec);
+				break;
+			case YCbCrKernelAVX2:
+				done = ConvertRowAVX2(y, cb, cr, bgra, picture.width, hdec);
+				break;
+#endif
+#ifdef OGVRT_YCBCR_NEON
+			case YCbCrKernelNEON:
+				done = ConvertRowNEON(y, cb, cr, bgra, picture.width, hdec);
+				break;
+#endif
+			default:
+				break;
+			}
+		}
+		ConvertRowScalar(y + done, cb + (done >> hdec), cr + (done >> hdec), bgra + 4 * done, picture.width - done, hdec, phase);
+	}
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "VideoFrame.h"
+#include "TaskPool.h"
+
+namespace OgvRT
+{
+	enum YCbCrKernel
+	{
+		YCbCrKernelAuto,	// Best kernel the CPU supports.
+		YCbCrKernelScalar,
+		YCbCrKernelSSE2,
+		YCbCrKernelAVX2,
+		YCbCrKernelNEON
+	};
+
+	// Converts decoded 4:2:0, 4:2:2 or 4:4:4 pictures to BGRA8 on the CPU, for
+	// thumbnails, software rendering and checking SamplePixelShader.hlsl.
+	// Uses the shader's BT.601 limited-range coefficients in 12-bit fixed point,
+	// which stays within 1 LSB of the shader's float maths. Chroma is upsampled
+	// by sample replication rather than the GPU's bilinear filter.
+	class YCbCrConverter
+	{
+	public:
+		// Rows are split into up to threadCount bands run on the shared task
+		// pool. A thread count of 0 uses every pool worker and the caller.
+		explicit YCbCrConverter(YCbCrKernel kernel = YCbCrKernelAuto, unsigned threadCount = 0);
+
+		static bool IsKernelSupported(YCbCrKernel kernel);
+		static const char *GetKernelName(YCbCrKernel kernel);
+
+		YCbCrKernel GetKernel() const { return m_kernel; }
+		unsigned GetThreadCount() const { return m_threadCount; }
+
+		// Converts the visible picture of the frame into dest, which must hold
+		// frame.picture.height rows of destPitch bytes each.
+		void Convert(const VideoFrame &frame, uint8_t *dest, size_t destPitch) const;
+
+	private:
+		void ConvertRows(const VideoFrame &frame, uint8_t *dest, size_t destPitch, int firstRow, int lastRow) const;
+
+		YCbCrKernel m_kernel;
+		unsigned m_threadCount;
+	};
+}
@@ -7,11 +7,40 @@ using namespace Windows::Foundation;
 using namespace Windows::System::Threading;
 using namespace Concurrency;
 
+// Input is fed to the decoder in bounded chunks as it arrives, so playback
+// can begin as soon as the headers are in rather than after the whole file.
+static const size_t InputChunkSize = 64 * 1024;
+static const size_t InputReadAheadBytes = 2 * 1024 * 1024;
+static const size_t InputBytesPerUpdate = 256 * 1024;
+
+// Decoded frames buffered between the decode worker and the render loop.
+static const size_t DecodeQueueDepth = 4;
+
+// Enough pooled frames to fill the queue plus the one being decoded and the one on screen.
+static const size_t FramePoolRetained = DecodeQueueDepth + 2;
+
+// Frames between decode profile reports in the debug output.
+static const uint64_t DecodeProfileFrames = 600;
+
+// Copies one of the decoder's planes into pooled storage.
+template<typename TPlane>
+static void CopyPlane(const TPlane &src, uint8_t *storage, VideoPlane &dest)
+{
+	dest.bytes = storage;
+	dest.stride = src.stride;
+	dest.height = src.height;
+	memcpy(dest.bytes, src.bytes, src.stride * src.height);
+}
+
 // Loads and initializes application assets when the application is loaded.
 OgvRTMain::OgvRTMain(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
 	m_deviceResources(deviceResources),
 	m_pointerLocationX(0.0f),
-	m_codec(std::make_unique<OGVCore::Decoder>())
+	m_codec(std::make_unique<OGVCore::Decoder>()),
+	m_input(std::make_shared<StreamingInput>(InputChunkSize, InputReadAheadBytes)),
+	m_framePool(FramePoolRetained),
+	m_clockStarted(false),
+	m_clockOffset(0.0)
 {
 	// Register to be notified if the Device is lost or recreated
 	m_deviceResources->RegisterDeviceNotify(this);
@@ -25,6 +54,10 @@ OgvRTMain::OgvRTMain(const std::shared_ptr<DX::DeviceResources>& deviceResources
 		// how exciting!
 	});
 
+	m_decodeWorker = std::make_unique<DecodeWorker>([this](VideoFrame &frame) {
+		return DecodeNextFrame(frame);
+	}, DecodeQueueDepth, DecodeWorker::BlockWhenFull);
+
 	// TODO: Change the timer settings if you want something other than the default variable timestep mode.
 	// e.g. for 60 FPS fixed timestep update logic, call:
 	/*
@@ -37,6 +70,10 @@ OgvRTMain::~OgvRTMain()
 {
 	// Deregister device notification
 	m_deviceResources->RegisterDeviceNotify(nullptr);
+
+	// Unblock the reader if it is waiting for room in the read-ahead window.
+	m_input->Cancel();
+	m_decodeWorker->Stop();
 }
 
 // Updates application state when the window size changes (e.g. device orientation change)
@@ -72,23 +109,128 @@ void OgvRTMain::StartRenderLoop()
 	// Run task on a dedicated high priority background thread.
 	m_renderLoopWorker = ThreadPool::RunAsync(workItemHandler, WorkItemPriority::High, WorkItemOptions::TimeSliced);
 
+	// Decoding happens on its own thread so slow frames don't stall Present.
+	m_decodeWorker->Start();
+
+	// The input only needs fetching once; it survives the render loop being restarted.
+	if (m_inputWorker != nullptr)
+	{
+		return;
+	}
+
 	// Load up our test image
 	auto src = ref new Platform::String(L"https://upload.wikimedia.org/wikipedia/commons/a/aa/Thresher-Sharks-Use-Tail-Slaps-as-a-Hunting-Strategy-pone.0067380.s003.ogv");
 	auto uri = ref new Windows::Foundation::Uri(src);
-	auto client = ref new Windows::Web::Http::HttpClient();
-	create_task(client->GetAsync(uri)).then([&](Windows::Web::Http::HttpResponseMessage^ message) {
-		return message->Content->ReadAsBufferAsync();
-	}).then([&](Windows::Storage::Streams::IBuffer^ fileBuffer) {
-		std::vector<byte> returnBuffer;
-		returnBuffer.resize(fileBuffer->Length);
-		Windows::Storage::Streams::DataReader::FromBuffer(fileBuffer)->ReadBytes(Platform::ArrayReference<byte>(returnBuffer.data(), fileBuffer->Length));
-		m_codec->receiveInput(returnBuffer);
+	auto readHandler = ref new WorkItemHandler([this, uri](IAsyncAction ^ action)
+	{
+		ReadInput(uri, action);
 	});
+
+	// The reader blocks whenever the read-ahead window is full, so keep it off the render thread.
+	m_inputWorker = ThreadPool::RunAsync(readHandler, WorkItemPriority::Normal, WorkItemOptions::TimeSliced);
+}
+
+// Pulls the response body off the network in chunks as it arrives and queues
+// it for the decoder. Runs on a thread pool thread, so blocking waits are ok.
+void OgvRTMain::ReadInput(Uri^ uri, IAsyncAction^ action)
+{
+	using namespace Windows::Storage::Streams;
+	using namespace Windows::Web::Http;
+
+	auto input = m_input;
+	try
+	{
+		auto client = ref new HttpClient();
+		auto response = create_task(client->GetAsync(uri, HttpCompletionOption::ResponseHeadersRead)).get();
+		response->EnsureSuccessStatusCode();
+
+		auto stream = create_task(response->Content->ReadAsInputStreamAsync()).get();
+		auto buffer = ref new Buffer(static_cast<unsigned int>(input->GetChunkSize()));
+		std::vector<byte> bytes;
+
+		while (action->Status == AsyncStatus::Started)
+		{
+			auto chunk = create_task(stream->ReadAsync(buffer, buffer->Capacity, InputStreamOptions::Partial)).get();
+			if (chunk->Length == 0)
+			{
+				break;
+			}
+
+			bytes.resize(chunk->Length);
+			DataReader::FromBuffer(chunk)->ReadBytes(Platform::ArrayReference<byte>(bytes.data(), chunk->Length));
+			if (!input->Write(bytes.data(), bytes.size()))
+			{
+				break;
+			}
+		}
+	}
+	catch (Platform::Exception^)
+	{
+		// Play whatever we managed to get.
+	}
+	input->EndOfStream();
 }
 
 void OgvRTMain::StopRenderLoop()
 {
 	m_renderLoopWorker->Cancel();
+	m_decodeWorker->Stop();
+}
+
+// Feeds the decoder and decodes one frame. Runs on the decode worker thread,
+// which is the only thread that touches m_codec once playback has started.
+bool OgvRTMain::DecodeNextFrame(VideoFrame &frame)
+{
+	// Top up the decoder from the read-ahead window only when it has nothing
+	// to show, so buffered input stays in our bounded queue instead.
+	if (!m_codec->frameReady())
+	{
+		{
+			DecodeProfiler::Scope scope(m_decodeProfiler, DecodePhaseInput);
+			m_input->Drain(InputBytesPerUpdate, [this](std::vector<uint8_t> &chunk) {
+				m_decodeProfiler.AddInputBytes(chunk.size());
+				m_codec->receiveInput(chunk);
+			});
+		}
+		// There's no audio output yet, so nothing is charged to the audio phase.
+		DecodeProfiler::Scope scope(m_decodeProfiler, DecodePhaseDemux);
+		m_codec->process();
+	}
+
+	bool decoded = false;
+	if (m_codec->frameReady())
+	{
+		DecodeProfiler::Scope scope(m_decodeProfiler, DecodePhaseVideo);
+		m_codec->decodeFrame([this, &frame, &decoded](OGVCore::FrameBuffer &buffer) {
+			DecodeProfiler::Scope scope(m_decodeProfiler, DecodePhaseHandOff);
+			// The decoder reuses its buffers, so copy out into recycled storage
+			// rather than allocating fresh planes every frame.
+			FrameGeometry geometry(buffer.Y.stride, buffer.Y.height, buffer.Cb.stride, buffer.Cb.height);
+			frame.storage = m_framePool.Acquire(geometry);
+			frame.timestamp = buffer.timestamp;
+			frame.picture = PlaneRect(buffer.pictureOffsetX, buffer.pictureOffsetY, buffer.pictureWidth, buffer.pictureHeight);
+			frame.hdec = buffer.Cb.stride < buffer.Y.stride ? 1 : 0;
+			frame.vdec = buffer.Cb.height < buffer.Y.height ? 1 : 0;
+			CopyPlane(buffer.Y, frame.storage->GetPlane(FrameStorage::PlaneY), frame.Y);
+			CopyPlane(buffer.Cb, frame.storage->GetPlane(FrameStorage::PlaneCb), frame.Cb);
+			CopyPlane(buffer.Cr, frame.storage->GetPlane(FrameStorage::PlaneCr), frame.Cr);
+			decoded = true;
+		});
+	}
+
+	if (decoded)
+	{
+		m_decodeProfiler.FrameDone();
+		if (m_decodeProfiler.GetProfile().frames >= DecodeProfileFrames)
+		{
+#if defined(_DEBUG)
+			std::string report = DecodeProfiler::ToJson(m_decodeProfiler.GetProfile(), m_framePool.GetStats()) + "\n";
+			OutputDebugStringA(report.c_str());
+#endif
+			m_decodeProfiler.Reset();
+		}
+	}
+	return decoded;
 }
 
 // Updates the application state once per frame.
@@ -96,11 +238,22 @@ void OgvRTMain::Update()
 {
 	ProcessInput();
 
-	m_codec->process();
-	if (m_codec->frameReady()) {
-		auto ok = m_codec->decodeFrame([this](OGVCore::FrameBuffer &frame) {
-			m_sceneRenderer->UpdateTextures(frame);
-		});
+	// Start the media clock at the first decoded frame, then show whichever
+	// frame is due. Anything slower than that is the decode worker's problem.
+	if (!m_clockStarted)
+	{
+		auto first = m_decodeWorker->PeekNext();
+		if (first != nullptr)
+		{
+			m_clockOffset = m_timer.GetTotalSeconds() - first->timestamp;
+			m_clockStarted = true;
+		}
+	}
+
+	VideoFrame frame;
+	if (m_clockStarted && m_decodeWorker->DequeueDue(m_timer.GetTotalSeconds() - m_clockOffset, frame))
+	{
+		m_sceneRenderer->UpdateTextures(frame);
 	}
 
 	// Update scene objects.
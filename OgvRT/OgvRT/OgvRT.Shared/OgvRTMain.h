@@ -4,6 +4,9 @@
 #include "Common\DeviceResources.h"
 #include "Content\Sample3DSceneRenderer.h"
 #include "Content\SampleFpsTextRenderer.h"
+#include "Media\StreamingInput.h"
+#include "Media\DecodeWorker.h"
+#include "Media\DecodeProfiler.h"
 
 #include <OGVCore.h>
 
@@ -30,6 +33,8 @@ namespace OgvRT
 
 	private:
 		void ProcessInput();
+		void ReadInput(Windows::Foundation::Uri^ uri, Windows::Foundation::IAsyncAction^ action);
+		bool DecodeNextFrame(VideoFrame &frame);
 		void Update();
 		bool Render();
 
@@ -41,6 +46,23 @@ namespace OgvRT
 		std::unique_ptr<SampleFpsTextRenderer> m_fpsTextRenderer;
 		std::unique_ptr<OGVCore::Decoder> m_codec;
 
+		// Network data waiting to be fed to the decoder.
+		std::shared_ptr<StreamingInput> m_input;
+		Windows::Foundation::IAsyncAction^ m_inputWorker;
+
+		// Recycled storage for decoded frames in flight to the renderer.
+		FramePool m_framePool;
+
+		// Where decode time goes; only touched on the decode worker's thread.
+		DecodeProfiler m_decodeProfiler;
+
+		// Owns m_codec once started; frames come back through its queue.
+		std::unique_ptr<DecodeWorker> m_decodeWorker;
+
+		// Maps render timer seconds onto media time, once the first frame is known.
+		bool m_clockStarted;
+		double m_clockOffset;
+
 		Windows::Foundation::IAsyncAction^ m_renderLoopWorker;
 		Concurrency::critical_section m_criticalSection;
 
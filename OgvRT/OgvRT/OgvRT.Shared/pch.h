@@ -1,5 +1,10 @@
 ﻿#pragma once
 
+#include <memory>
+
+// Everything below is Windows-only; the portable media code also builds on
+// its own for the tests under Tests/.
+#ifdef _WIN32
 #include <wrl.h>
 #include <wrl/client.h>
 #include <d3d11_2.h>
@@ -9,8 +14,8 @@
 #include <wincodec.h>
 #include <DirectXColors.h>
 #include <DirectXMath.h>
-#include <memory>
 #include <agile.h>
 #include <concrt.h>
 #include <collection.h>
-#include "App.xaml.h"
\ No newline at end of file
+#include "App.xaml.h"
+#endif
\ No newline at end of file
@@ -0,0 +1,404 @@
+// Headless decode benchmark: runs .ogv files through the same demuxer and
+// frame hand-off the player uses, as fast as they will go, and prints one
+// JSON line per file so runs can be compared between builds.
+//
+//     DecodeBench [--mmap] [--thin] [file.ogv ...]
+//
+// Files are read through stdio into the demuxer's buffer, as a byte stream
+// is, or with --mmap (POSIX only) mapped and parsed in place, as local files
+// are. Peak RSS is for the whole process, so compare the two in separate
+// runs.
+//
+// With --thin each file is run a second time with the demuxer dropping
+// inter frames, as the player does when it falls behind, and that run's
+// line also gives the frames thinned out and the hand-off time saved
+// against the first.
+//
+// With no files it runs a synthetic one. OGVCore and the codec libraries
+// aren't in this tree, so there is no Theora or Vorbis decode yet: the
+// video and audio phases are where the decode calls go once they are, and
+// stay at zero until then. Hand-off copies a picture of the stream's
+// size into pooled storage per frame, as the player does after decoding.
+
+#include "DecodeProfiler.h"
+#include "FramePool.h"
+#include "OggTestFile.h"
+#include "OgvDemuxer.h"
+#include "OgvMappedFile.h"
+#include "OgvSeekIndex.h"
+#include "PlaneUpload.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace OgvRT;
+
+// Every allocation in the process, counted by replacing the global operators.
+static std::atomic<uint64_t> s_allocations(0);
+
+void *operator new(size_t size)
+{
+	s_allocations++;
+	void *p = malloc(size ? size : 1);
+	if (p == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void *p) throw()
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) throw()
+{
+	operator delete(p);
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete[](void *p) throw()
+{
+	operator delete(p);
+}
+
+void operator delete[](void *p, size_t) throw()
+{
+	operator delete(p);
+}
+
+static uint64_t PeakResidentKiB()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return 0;
+	}
+	return counters.PeakWorkingSetSize / 1024;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+	return static_cast<uint64_t>(usage.ru_maxrss);	// Already KiB on Linux.
+#endif
+}
+
+// File names go into the output as JSON strings.
+static std::string JsonString(const std::string &text)
+{
+	static const char hex[] = "0123456789abcdef";
+	std::string json = "\"";
+	for (char c : text)
+	{
+		unsigned char byte = static_cast<unsigned char>(c);
+		if (c == '"' || c == '\\')
+		{
+			json += '\\';
+			json += c;
+		}
+		else if (byte < 0x20)
+		{
+			json += "\\u00";
+			json += hex[byte >> 4];
+			json += hex[byte & 0xf];
+		}
+		else
+		{
+			json += c;
+		}
+	}
+	return json + "\"";
+}
+
+struct Source
+{
+	std::string name;
+	const char *input;
+	OgvReadFunc read;
+	OgvViewFunc view;	// if set, used instead of read
+	uint64_t length;
+};
+
+// Hands out pointers through a view, charging that to the input phase. The
+// page faults behind them land wherever the pages are first read. The same
+// bytes are viewed many times over, so only those past the furthest point
+// viewed so far count as input.
+static OgvViewFunc ProfiledView(const OgvViewFunc &view, DecodeProfiler &profiler)
+{
+	std::shared_ptr<uint64_t> reached = std::make_shared<uint64_t>(0);
+	return [view, &profiler, reached](uint64_t offset, size_t count, const uint8_t *&data) -> size_t {
+		DecodeProfiler::Scope scope(profiler, DecodePhaseInput);
+		size_t available = view(offset, count, data);
+		uint64_t end = offset + std::min(count, available);
+		if (end > *reached)
+		{
+			profiler.AddInputBytes(static_cast<size_t>(end - std::max(offset, *reached)));
+			*reached = end;
+		}
+		return available;
+	};
+}
+
+// Reads through stdio, charging the time to the input phase.
+static bool OpenFile(const char *path, DecodeProfiler &profiler, FILE *&file, Source &source)
+{
+	file = fopen(path, "rb");
+	if (file == nullptr || fseek(file, 0, SEEK_END) != 0)
+	{
+		return false;
+	}
+	long length = ftell(file);
+	if (length <= 0)
+	{
+		return false;
+	}
+
+	source.name = path;
+	source.input = "read";
+	source.length = static_cast<uint64_t>(length);
+	source.read = [file, &profiler](uint64_t offset, uint8_t *buffer, size_t count) -> size_t {
+		DecodeProfiler::Scope scope(profiler, DecodePhaseInput);
+		if (fseek(file, static_cast<long>(offset), SEEK_SET) != 0)
+		{
+			return 0;
+		}
+		size_t got = fread(buffer, 1, count, file);
+		profiler.AddInputBytes(got);
+		return got;
+	};
+	return true;
+}
+
+#ifndef _WIN32
+// Maps the file a window at a time and parses pages in place.
+static bool MapFile(const char *path, DecodeProfiler &profiler, OgvMappedFile &mapped, Source &source)
+{
+	if (!mapped.Open(path))
+	{
+		return false;
+	}
+	source.name = path;
+	source.input = "mmap";
+	source.length = mapped.GetLength();
+	source.view = ProfiledView(mapped.CreateView(), profiler);
+	return true;
+}
+#endif
+
+static FrameGeometry GeometryFor(const OgvTheoraInfo &theora)
+{
+	int hdec = theora.pixelFormat == 3 ? 0 : 1;
+	int vdec = theora.pixelFormat == 0 ? 1 : 0;
+	int width = static_cast<int>(theora.frameWidth);
+	int height = static_cast<int>(theora.frameHeight);
+	return FrameGeometry(width, height, width >> hdec, height >> vdec);
+}
+
+// Prints the run's JSON line. A thinned run reports against the profile of
+// a full one.
+static bool Run(const Source &source, DecodeProfiler &profiler, bool thin, const DecodeProfile *full, DecodeProfile &profile)
+{
+	OgvSeekIndex index;
+	OgvDemuxer demuxer;
+	uint32_t videoSerial = 0;
+	uint32_t audioSerial = 0;
+	FrameGeometry geometry;
+	{
+		DecodeProfiler::Scope scope(profiler, DecodePhaseDemux);
+		if (!index.Open(source.read, source.length, source.view))
+		{
+			return false;
+		}
+		for (auto &stream : index.GetStreams())
+		{
+			if (stream.type == OGV_STREAM_THEORA && videoSerial == 0)
+			{
+				videoSerial = stream.serialno;
+				geometry = GeometryFor(stream.theora);
+			}
+			if (stream.type == OGV_STREAM_VORBIS && audioSerial == 0)
+			{
+				audioSerial = stream.serialno;
+			}
+		}
+		demuxer.Open(source.read, source.length, index.GetStreams(), source.view);
+		if (!demuxer.ReadHeaders(index.GetDataOffset()))
+		{
+			return false;
+		}
+		demuxer.SetThinning(thin);
+	}
+
+	// Stands in for the decoder's output buffers.
+	std::vector<uint8_t> decoded(geometry.lumaStride * geometry.lumaHeight + 2 * geometry.chromaStride * geometry.chromaHeight, 0x80);
+	FramePool pool;
+
+	bool more = true;
+	while (more)
+	{
+		DecodeProfiler::Scope scope(profiler, DecodePhaseDemux);
+		more = demuxer.ReadPage([&](uint32_t serialno, OgvSample &) {
+			if (serialno == audioSerial)
+			{
+				// vorbis_synthesis() on the packet goes here.
+				DecodeProfiler::Scope audio(profiler, DecodePhaseAudio);
+				return;
+			}
+			if (serialno != videoSerial)
+			{
+				return;
+			}
+			{
+				// Decoder::decodeFrame() on the packet goes here.
+				DecodeProfiler::Scope video(profiler, DecodePhaseVideo);
+			}
+			{
+				DecodeProfiler::Scope handOff(profiler, DecodePhaseHandOff);
+				FrameHandle frame = pool.Acquire(geometry);
+				const uint8_t *src = decoded.data();
+				UploadPlane(src, geometry.lumaStride, PlaneRect(0, 0, geometry.lumaStride, geometry.lumaHeight),
+					frame->GetPlane(FrameStorage::PlaneY), geometry.lumaStride);
+				src += geometry.lumaStride * geometry.lumaHeight;
+				PlaneRect chroma(0, 0, geometry.chromaStride, geometry.chromaHeight);
+				UploadPlane(src, geometry.chromaStride, chroma, frame->GetPlane(FrameStorage::PlaneCb), geometry.chromaStride);
+				src += geometry.chromaStride * geometry.chromaHeight;
+				UploadPlane(src, geometry.chromaStride, chroma, frame->GetPlane(FrameStorage::PlaneCr), geometry.chromaStride);
+			}
+			profiler.FrameDone();
+		});
+	}
+
+	profile = profiler.GetProfile();
+	std::string decode = DecodeProfiler::ToJson(profile, pool.GetStats());
+	std::string thinning;
+	if (thin)
+	{
+		char buffer[128];
+		int64_t saved = full ? static_cast<int64_t>(full->nanoseconds[DecodePhaseHandOff]) - static_cast<int64_t>(profile.nanoseconds[DecodePhaseHandOff]) : 0;
+		sprintf(buffer, ",\"thinnedFrames\":%llu,\"handOffNsSaved\":%lld",
+			static_cast<unsigned long long>(demuxer.GetThinnedFrames()),
+			static_cast<long long>(saved));
+		thinning = buffer;
+	}
+	printf("{\"file\":%s,\"input\":\"%s\",\"thin\":%s%s,\"allocations\":%llu,\"peakRssKiB\":%llu,\"decode\":%s}\n",
+		JsonString(source.name).c_str(),
+		source.input,
+		thin ? "true" : "false",
+		thinning.c_str(),
+		static_cast<unsigned long long>(s_allocations.load()),
+		static_cast<unsigned long long>(PeakResidentKiB()),
+		decode.c_str());
+	return true;
+}
+
+// Opens a file, or the synthetic one for a null path, and runs it. Each run
+// opens its input afresh so input counts start from zero.
+static bool RunOnce(const char *path, bool mapped, bool thin, const DecodeProfile *full, DecodeProfile &profile)
+{
+	DecodeProfiler profiler;
+	Source source;
+	s_allocations = 0;
+
+	if (path == nullptr)
+	{
+		// Already in memory, so --mmap can only parse it in place.
+		static const OggTestFile file;
+		source.name = "synthetic";
+		source.input = mapped ? "view" : "read";
+		source.length = file.GetLength();
+		OgvReadFunc read = file.ReadFunc();
+		source.read = [read, &profiler](uint64_t offset, uint8_t *buffer, size_t count) -> size_t {
+			DecodeProfiler::Scope scope(profiler, DecodePhaseInput);
+			size_t got = read(offset, buffer, count);
+			profiler.AddInputBytes(got);
+			return got;
+		};
+		if (mapped)
+		{
+			source.view = ProfiledView(file.ViewFunc(), profiler);
+		}
+		return Run(source, profiler, thin, full, profile);
+	}
+
+	FILE *file = nullptr;
+#ifndef _WIN32
+	OgvMappedFile mappedFile;
+	bool opened = mapped ? MapFile(path, profiler, mappedFile, source) : OpenFile(path, profiler, file, source);
+#else
+	bool opened = OpenFile(path, profiler, file, source);
+#endif
+	bool ran = opened && Run(source, profiler, thin, full, profile);
+	if (file != nullptr)
+	{
+		fclose(file);
+	}
+	return ran;
+}
+
+int main(int argc, char **argv)
+{
+	bool mapped = false;
+	bool thin = false;
+	std::vector<const char *> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--mmap") == 0)
+		{
+			mapped = true;
+		}
+		else if (strcmp(argv[i], "--thin") == 0)
+		{
+			thin = true;
+		}
+		else
+		{
+			paths.push_back(argv[i]);
+		}
+	}
+#ifdef _WIN32
+	if (mapped)
+	{
+		fprintf(stderr, "--mmap needs POSIX mmap\n");
+		return 1;
+	}
+#endif
+
+	if (paths.empty())
+	{
+		paths.push_back(nullptr);
+	}
+
+	int failures = 0;
+	for (const char *path : paths)
+	{
+		DecodeProfile full, thinned;
+		if (!RunOnce(path, mapped, false, nullptr, full) || (thin && !RunOnce(path, mapped, true, &full, thinned)))
+		{
+			fprintf(stderr, "%s: not a playable Ogg file\n", path ? path : "synthetic");
+			failures++;
+		}
+	}
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+#include "DecodeWorker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace OgvRT;
+
+typedef std::chrono::steady_clock Clock;
+
+static const double RefreshSeconds = 1.0 / 60.0;
+static const int Ticks = 300;
+
+// 30 fps video with a keyframe every second that takes several refreshes
+// to decode. Decoding is stood in for by sleeping, as if on another core,
+// so the comparison holds on a single-core machine too.
+static const double FramesPerSecond = 30.0;
+static const int KeyframeInterval = 30;
+static const int KeyframeMs = 45;
+static const int InterFrameMs = 8;
+
+static bool DecodeFrame(int &next, VideoFrame &frame)
+{
+	int ms = next % KeyframeInterval == 0 ? KeyframeMs : InterFrameMs;
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+	frame.timestamp = next++ / FramesPerSecond;
+	return true;
+}
+
+struct Jitter
+{
+	double meanMs;
+	double stddevMs;
+	double maxMs;
+	int missed;		// refreshes that took more than one and a half periods
+	int shown;
+};
+
+// Runs a render loop at the refresh rate, with tick(mediaTime) doing one
+// update's worth of work, and measures how evenly the updates start.
+template<typename TTick>
+static Jitter RenderLoop(TTick tick)
+{
+	std::vector<double> intervals;
+	Clock::time_point start = Clock::now();
+	Clock::time_point last = start;
+	int shown = 0;
+	for (int i = 0; i < Ticks; i++)
+	{
+		Clock::time_point now = Clock::now();
+		if (i > 0)
+		{
+			intervals.push_back(std::chrono::duration<double, std::milli>(now - last).count());
+		}
+		last = now;
+
+		shown += tick(i * RefreshSeconds) ? 1 : 0;
+
+		Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>((i + 1) * RefreshSeconds));
+		std::this_thread::sleep_until(deadline);
+	}
+
+	Jitter jitter = {};
+	double sum = 0.0;
+	for (double interval : intervals)
+	{
+		sum += interval;
+		jitter.maxMs = std::max(jitter.maxMs, interval);
+		jitter.missed += interval > 1.5 * RefreshSeconds * 1000.0 ? 1 : 0;
+	}
+	jitter.meanMs = sum / intervals.size();
+	double squares = 0.0;
+	for (double interval : intervals)
+	{
+		squares += (interval - jitter.meanMs) * (interval - jitter.meanMs);
+	}
+	jitter.stddevMs = std::sqrt(squares / intervals.size());
+	jitter.shown = shown;
+	return jitter;
+}
+
+static void Report(const char *name, const Jitter &jitter)
+{
+	printf("%-8s  interval %6.2f ms  stddev %6.2f ms  max %6.2f ms  missed %3d  shown %3d\n",
+		name, jitter.meanMs, jitter.stddevMs, jitter.maxMs, jitter.missed, jitter.shown);
+}
+
+int main()
+{
+	// Decoding inline, as Update used to: a due frame is decoded before the
+	// refresh can finish.
+	int next = 0;
+	Jitter inlineJitter = RenderLoop([&next](double mediaTime) {
+		if (next / FramesPerSecond > mediaTime)
+		{
+			return false;
+		}
+		VideoFrame frame;
+		return DecodeFrame(next, frame);
+	});
+	Report("inline", inlineJitter);
+
+	// On the worker, the refresh only ever dequeues. The media clock starts
+	// at the first decoded frame, as OgvRTMain's does.
+	next = 0;
+	DecodeWorker worker([&next](VideoFrame &frame) { return DecodeFrame(next, frame); }, DecodeWorker::DefaultQueueDepth, DecodeWorker::BlockWhenFull);
+	worker.Start();
+	while (worker.PeekNext() == nullptr)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	Jitter workerJitter = RenderLoop([&worker](double mediaTime) {
+		VideoFrame frame;
+		return worker.DequeueDue(mediaTime, frame);
+	});
+	worker.Stop();
+	Report("worker", workerJitter);
+
+	DecodeWorkerStats stats = worker.GetStats();
+	printf("worker decoded %llu, skipped %llu, stalled %llu time(s)\n",
+		static_cast<unsigned long long>(stats.framesDecoded),
+		static_cast<unsigned long long>(stats.framesSkipped),
+		static_cast<unsigned long long>(stats.producerStalls));
+	return 0;
+}
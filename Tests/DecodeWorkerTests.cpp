@@ -0,0 +1,143 @@
+#include "DecodeWorker.h"
+#include "SpscQueue.h"
+#include "TestHarness.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace OgvRT;
+
+static void TestQueueBounds()
+{
+	SpscQueue<int> queue(3);
+	CHECK(queue.Capacity() == 3);
+	CHECK(queue.IsEmpty());
+	for (int i = 0; i < 3; i++)
+	{
+		int item = i;
+		CHECK(queue.TryPush(std::move(item)));
+	}
+	int extra = 99;
+	CHECK(!queue.TryPush(std::move(extra)));
+	CHECK(queue.IsFull());
+
+	int item = -1;
+	CHECK(queue.TryPop(item) && item == 0);
+	CHECK(queue.Front() != nullptr && *queue.Front() == 1);
+	CHECK(queue.Size() == 2);
+}
+
+// One producer and one consumer hammering the queue; everything must come
+// out once, in order.
+static void TestQueueAcrossThreads()
+{
+	const int count = 100000;
+	SpscQueue<int> queue(16);
+
+	std::thread producer([&] {
+		for (int i = 0; i < count; i++)
+		{
+			int item = i;
+			while (!queue.TryPush(std::move(item)))
+			{
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	int expected = 0;
+	bool inOrder = true;
+	while (expected < count)
+	{
+		int item;
+		if (queue.TryPop(item))
+		{
+			inOrder = inOrder && item == expected;
+			expected++;
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	CHECK(inOrder);
+	CHECK(queue.IsEmpty());
+}
+
+static bool ProduceFrame(int &next, int limit, VideoFrame &frame)
+{
+	if (next >= limit)
+	{
+		return false;
+	}
+	frame.timestamp = next++ / 30.0;
+	return true;
+}
+
+static void TestWorkerBlocksWhenFull()
+{
+	const int frames = 200;
+	int next = 0;
+	DecodeWorker worker([&](VideoFrame &frame) { return ProduceFrame(next, frames, frame); }, 4, DecodeWorker::BlockWhenFull);
+	worker.Start();
+
+	// Ask for each frame exactly when it is due; none may be lost or reordered.
+	double last = -1.0;
+	int received = 0;
+	bool inOrder = true;
+	for (int i = 0; i < frames; i++)
+	{
+		VideoFrame frame;
+		while (!worker.DequeueDue(i / 30.0, frame))
+		{
+			std::this_thread::yield();
+		}
+		inOrder = inOrder && frame.timestamp > last;
+		last = frame.timestamp;
+		received++;
+	}
+	worker.Stop();
+
+	DecodeWorkerStats stats = worker.GetStats();
+	CHECK(inOrder);
+	CHECK(received == frames);
+	CHECK(stats.framesDecoded == static_cast<uint64_t>(frames));
+	CHECK(stats.framesDropped == 0);
+	CHECK(stats.framesSkipped == 0);
+	CHECK(worker.GetQueuedFrames() <= worker.GetQueueDepth());
+}
+
+static void TestWorkerDropsWhenFull()
+{
+	const int frames = 100;
+	int next = 0;
+	DecodeWorker worker([&](VideoFrame &frame) { return ProduceFrame(next, frames, frame); }, 2, DecodeWorker::DropWhenFull);
+	worker.Start();
+
+	// A frame is counted as decoded before it is queued or dropped, so wait
+	// for every one to land somewhere.
+	while (worker.GetStats().framesDropped + worker.GetQueuedFrames() < static_cast<uint64_t>(frames))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	// Everything is due; only the newest queued frame comes back.
+	VideoFrame frame;
+	CHECK(worker.DequeueDue(1e9, frame));
+	worker.Stop();
+
+	DecodeWorkerStats stats = worker.GetStats();
+	CHECK(stats.framesDropped == static_cast<uint64_t>(frames - 2));
+	CHECK(stats.framesSkipped == 1);
+	CHECK(frame.timestamp == 1 / 30.0);
+}
+
+int main()
+{
+	TestQueueBounds();
+	TestQueueAcrossThreads();
+	TestWorkerBlocksWhenFull();
+	TestWorkerDropsWhenFull();
+	return TEST_RESULT();
+}
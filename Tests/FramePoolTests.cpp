@@ -0,0 +1,156 @@
+#include "FramePool.h"
+#include "TestHarness.h"
+
+#include <thread>
+#include <vector>
+
+using namespace OgvRT;
+
+static const FrameGeometry Geometry420(1920, 1080, 960, 540);
+
+static bool IsAligned(const uint8_t *pointer)
+{
+	return reinterpret_cast<uintptr_t>(pointer) % FrameStorage::PlaneAlignment == 0;
+}
+
+static void TestPlaneLayout()
+{
+	FrameGeometry geometry(37, 11, 19, 6);
+	FrameStorage storage(geometry);
+
+	const uint8_t *y = storage.GetPlane(FrameStorage::PlaneY);
+	const uint8_t *cb = storage.GetPlane(FrameStorage::PlaneCb);
+	const uint8_t *cr = storage.GetPlane(FrameStorage::PlaneCr);
+	CHECK(IsAligned(y) && IsAligned(cb) && IsAligned(cr));
+	CHECK(cb >= y + 37 * 11);
+	CHECK(cr >= cb + 19 * 6);
+	CHECK(y + storage.GetSize() >= cr + 19 * 6);
+}
+
+// Steady playback of one size should allocate once per frame in flight and
+// then only recycle.
+static void TestRecycles()
+{
+	FramePool pool;
+	for (int i = 0; i < 100; i++)
+	{
+		FrameHandle current = pool.Acquire(Geometry420);
+		FrameHandle previous = pool.Acquire(Geometry420);
+		CHECK(current != previous);
+	}
+
+	FramePoolStats stats = pool.GetStats();
+	CHECK(stats.acquisitions == 200);
+	CHECK(stats.allocations == 2);
+	CHECK(stats.hits == 198);
+	CHECK(stats.outstanding == 0);
+	CHECK(stats.highWaterMark == 2);
+	CHECK(stats.retained == 2);
+	CHECK(stats.HitRate() > 0.98);
+}
+
+static void TestGeometryChangeFlushes()
+{
+	FramePool pool;
+	pool.Acquire(Geometry420);
+	CHECK(pool.GetStats().retained == 1);
+
+	FrameGeometry smaller(640, 360, 320, 180);
+	FrameHandle frame = pool.Acquire(smaller);
+	CHECK(frame->GetGeometry() == smaller);
+
+	FramePoolStats stats = pool.GetStats();
+	CHECK(stats.allocations == 2);
+	CHECK(stats.hits == 0);
+	CHECK(stats.retained == 0);
+}
+
+// Frames of the old size still in flight when it changes are freed as they
+// come back, rather than displacing the new ones.
+static void TestStaleReleaseDropped()
+{
+	FramePool pool;
+	FrameHandle old1 = pool.Acquire(Geometry420);
+	FrameHandle old2 = pool.Acquire(Geometry420);
+
+	FrameGeometry smaller(640, 360, 320, 180);
+	pool.Acquire(smaller);
+	CHECK(pool.GetStats().retained == 1);
+	old1.reset();
+	old2.reset();
+	CHECK(pool.GetStats().retained == 1);
+
+	FrameHandle frame = pool.Acquire(smaller);
+	FramePoolStats stats = pool.GetStats();
+	CHECK(frame->GetGeometry() == smaller);
+	CHECK(stats.hits == 1);
+	CHECK(stats.allocations == 3);
+}
+
+static void TestRetentionCap()
+{
+	FramePool pool(3);
+	{
+		std::vector<FrameHandle> frames;
+		for (int i = 0; i < 10; i++)
+		{
+			frames.push_back(pool.Acquire(Geometry420));
+		}
+		CHECK(pool.GetStats().outstanding == 10);
+	}
+	CHECK(pool.GetStats().retained == 3);
+
+	pool.Trim();
+	CHECK(pool.GetStats().retained == 0);
+}
+
+// Frames handed to another thread may outlive the pool.
+static void TestReleaseAfterPoolGone()
+{
+	FrameHandle frame;
+	{
+		FramePool pool;
+		frame = pool.Acquire(Geometry420);
+	}
+	std::thread consumer([&] { frame.reset(); });
+	consumer.join();
+	CHECK(!frame);
+}
+
+static void TestReleaseAcrossThreads()
+{
+	FramePool pool;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++)
+	{
+		threads.push_back(std::thread([&pool] {
+			for (int i = 0; i < 1000; i++)
+			{
+				FrameHandle frame = pool.Acquire(Geometry420);
+				frame->GetPlane(FrameStorage::PlaneY)[0] = static_cast<uint8_t>(i);
+			}
+		}));
+	}
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	FramePoolStats stats = pool.GetStats();
+	CHECK(stats.acquisitions == 4000);
+	CHECK(stats.hits + stats.allocations == 4000);
+	CHECK(stats.outstanding == 0);
+	CHECK(stats.highWaterMark <= 4);
+}
+
+int main()
+{
+	TestPlaneLayout();
+	TestRecycles();
+	TestGeometryChangeFlushes();
+	TestStaleReleaseDropped();
+	TestRetentionCap();
+	TestReleaseAfterPoolGone();
+	TestReleaseAcrossThreads();
+	return TEST_RESULT();
+}
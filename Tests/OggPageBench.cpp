@@ -0,0 +1,114 @@
+#include "OggPage.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const size_t TotalBytes = 256 * 1024 * 1024;
+
+static std::vector<uint8_t> Noise(size_t size)
+{
+	std::vector<uint8_t> data(size);
+	std::minstd_rand random(1);
+	for (auto &byte : data)
+	{
+		byte = static_cast<uint8_t>(random());
+	}
+	return data;
+}
+
+// Checksums the buffer a page at a time, as the demuxer does.
+static double CrcGigabytesPerSecond(OggCrcKernel kernel, const std::vector<uint8_t> &data, size_t pageSize, uint32_t &crc)
+{
+	size_t pages = data.size() / pageSize;
+	size_t rounds = TotalBytes / data.size();
+	crc = 0;
+
+	Clock::time_point start = Clock::now();
+	for (size_t round = 0; round < rounds; round++)
+	{
+		for (size_t page = 0; page < pages; page++)
+		{
+			crc ^= OggCrcUpdate(0, data.data() + page * pageSize, pageSize, kernel);
+		}
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	return static_cast<double>(rounds * pages * pageSize) / seconds / 1e9;
+}
+
+// Scans the buffer end to end, as resynchronizing over damage does; the
+// noise has no capture pattern, only the odd 'O' for the scanners to
+// check and reject.
+static double ScanGigabytesPerSecond(OggScanKernel kernel, const std::vector<uint8_t> &data, size_t &found)
+{
+	size_t rounds = TotalBytes / data.size();
+	found = 0;
+
+	Clock::time_point start = Clock::now();
+	for (size_t round = 0; round < rounds; round++)
+	{
+		found += OggFindCapture(data.data(), data.size(), kernel);
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	return static_cast<double>(rounds * data.size()) / seconds / 1e9;
+}
+
+int main()
+{
+	const OggCrcKernel kernels[] = { OGG_CRC_BYTEWISE, OGG_CRC_SLICING8, OGG_CRC_CLMUL_X86 };
+	const char *names[] = { "bytewise", "slicing-by-8", "pclmulqdq" };
+	const size_t pageSizes[] = { 256, 4096, 65307 };
+
+	// Bigger than most L2 caches, smaller than the last level.
+	std::vector<uint8_t> data = Noise(4 * 1024 * 1024);
+
+	printf("CRC, GB/s by page size\n%-14s", "");
+	for (size_t pageSize : pageSizes)
+	{
+		printf("%10u", static_cast<unsigned>(pageSize));
+	}
+	printf("\n");
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (!OggCrcKernelSupported(kernels[i]))
+		{
+			continue;
+		}
+		printf("%-14s", names[i]);
+		for (size_t pageSize : pageSizes)
+		{
+			uint32_t crc, expected;
+			double rate = CrcGigabytesPerSecond(kernels[i], data, pageSize, crc);
+			CrcGigabytesPerSecond(OGG_CRC_SLICING8, data, pageSize, expected);
+			printf("%10.2f%s", rate, crc == expected ? "" : "!");
+		}
+		printf("\n");
+	}
+
+	const OggScanKernel scanKernels[] = { OGG_SCAN_SCALAR, OGG_SCAN_SSE2, OGG_SCAN_AVX2, OGG_SCAN_NEON };
+	const char *scanNames[] = { "scalar", "sse2", "avx2", "neon" };
+	for (auto &byte : data)
+	{
+		if (byte == 'S')
+		{
+			byte = 's';
+		}
+	}
+
+	printf("\nCapture scan, GB/s\n");
+	for (int i = 0; i < 4; i++)
+	{
+		if (!OggScanKernelSupported(scanKernels[i]))
+		{
+			continue;
+		}
+		size_t found;
+		double rate = ScanGigabytesPerSecond(scanKernels[i], data, found);
+		printf("%-14s%10.2f%s\n", scanNames[i], rate, found % data.size() == 0 ? "" : "!");
+	}
+	return 0;
+}
@@ -0,0 +1,208 @@
+#include "OggPage.h"
+#include "OggTestFile.h"
+#include "TestHarness.h"
+
+#include <random>
+#include <vector>
+
+static const OggCrcKernel CrcKernels[] = { OGG_CRC_AUTO, OGG_CRC_BYTEWISE, OGG_CRC_SLICING8, OGG_CRC_CLMUL_X86 };
+
+static std::vector<uint8_t> Noise(size_t size, uint32_t seed)
+{
+	std::vector<uint8_t> data(size);
+	std::minstd_rand random(seed);
+	for (auto &byte : data)
+	{
+		byte = static_cast<uint8_t>(random());
+	}
+	return data;
+}
+
+static void TestCrcKnownValue()
+{
+	const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+	for (OggCrcKernel kernel : CrcKernels)
+	{
+		if (OggCrcKernelSupported(kernel))
+		{
+			CHECK(OggCrcUpdate(0, check, sizeof(check), kernel) == 0x89a1897f);
+			CHECK(OggCrcUpdate(0x1234, check, 0, kernel) == 0x1234);
+		}
+	}
+	CHECK(OggCrcKernelSupported(OGG_CRC_AUTO));
+	CHECK(OggCrcKernelSupported(OGG_CRC_BYTEWISE));
+	CHECK(OggCrcKernelSupported(OGG_CRC_SLICING8));
+}
+
+// Every kernel agrees with the bytewise one, whatever the alignment,
+// length and running value, including lengths around the folding kernel's
+// block sizes.
+static void TestCrcKernelsAgree()
+{
+	std::vector<uint8_t> data = Noise(70000, 1);
+	std::minstd_rand random(2);
+	for (int i = 0; i < 2000; i++)
+	{
+		size_t offset = random() % 64;
+		size_t length = i < 200 ? static_cast<size_t>(i) : random() % (data.size() - 64);
+		uint32_t initial = static_cast<uint32_t>(random()) * 2654435761u;
+		uint32_t expected = OggCrcUpdate(initial, data.data() + offset, length, OGG_CRC_BYTEWISE);
+		for (OggCrcKernel kernel : CrcKernels)
+		{
+			if (OggCrcKernelSupported(kernel))
+			{
+				CHECK(OggCrcUpdate(initial, data.data() + offset, length, kernel) == expected);
+			}
+		}
+	}
+}
+
+// Continuing over a split gives the same as one pass.
+static void TestCrcContinues()
+{
+	std::vector<uint8_t> data = Noise(5000, 3);
+	uint32_t whole = OggCrcUpdate(0, data.data(), data.size());
+	const size_t splits[] = { 1, 15, 16, 17, 63, 64, 65, 2500, 4999 };
+	for (size_t split : splits)
+	{
+		uint32_t crc = OggCrcUpdate(0, data.data(), split);
+		CHECK(OggCrcUpdate(crc, data.data() + split, data.size() - split) == whole);
+	}
+}
+
+// The test file's pages all verify, and damage anywhere in one is caught.
+static void TestVerifyPage()
+{
+	OggTestFile file(60, 30);
+	std::vector<uint8_t> bytes = file.GetBytes();
+
+	int pages = 0;
+	bool allVerify = true;
+	size_t offset = 0;
+	while (offset < bytes.size())
+	{
+		OggPageHeader header;
+		if (OggParsePageHeader(bytes.data() + offset, bytes.size() - offset, header) != OGG_PAGE_OK)
+		{
+			break;
+		}
+		allVerify = allVerify && OggVerifyPage(bytes.data() + offset, header) &&
+			OggPageChecksum(bytes.data() + offset, header.PageSize()) == header.checksum;
+		offset += header.PageSize();
+		pages++;
+	}
+	CHECK(offset == bytes.size());
+	CHECK(pages > 60);
+	CHECK(allVerify);
+
+	OggPageHeader header;
+	CHECK(OggParsePageHeader(bytes.data(), bytes.size(), header) == OGG_PAGE_OK);
+	const size_t damaged[] = { 5, 22, 26, header.headerSize, header.PageSize() - 1 };
+	for (size_t at : damaged)
+	{
+		bytes[at] ^= 0x10;
+		OggPageHeader reparsed;
+		bool parsed = OggParsePageHeader(bytes.data(), bytes.size(), reparsed) == OGG_PAGE_OK;
+		CHECK(!parsed || !OggVerifyPage(bytes.data(), reparsed));
+		bytes[at] ^= 0x10;
+	}
+}
+
+static const OggScanKernel ScanKernels[] = { OGG_SCAN_AUTO, OGG_SCAN_SCALAR, OGG_SCAN_SSE2, OGG_SCAN_AVX2, OGG_SCAN_NEON };
+
+static size_t FindCaptureReference(const uint8_t *data, size_t length)
+{
+	for (size_t i = 0; i + 4 <= length; i++)
+	{
+		if (data[i] == 'O' && data[i + 1] == 'g' && data[i + 2] == 'g' && data[i + 3] == 'S')
+		{
+			return i;
+		}
+	}
+	return length;
+}
+
+// Every scanner finds the same first capture pattern as a byte-by-byte
+// search, with near misses and patterns straddling vector widths and the
+// end of the buffer thrown in.
+static void TestScanKernelsAgree()
+{
+	CHECK(OggScanKernelSupported(OGG_SCAN_AUTO));
+	CHECK(OggScanKernelSupported(OGG_SCAN_SCALAR));
+
+	std::minstd_rand random(4);
+	std::vector<uint8_t> data(4096);
+	const char *fragments[] = { "OggS", "Ogg", "OOggS", "OgOggS", "gS" };
+	for (int i = 0; i < 3000; i++)
+	{
+		for (auto &byte : data)
+		{
+			// Mostly 'O', 'g' and 'S', so near misses are common.
+			uint32_t r = random();
+			byte = (r & 3) == 0 ? static_cast<uint8_t>(r >> 8) : "OgS"[(r >> 2) % 3];
+		}
+		for (int planted = static_cast<int>(random() % 3); planted > 0; planted--)
+		{
+			const char *fragment = fragments[random() % 5];
+			size_t at = random() % data.size();
+			for (size_t j = 0; fragment[j] != 0 && at + j < data.size(); j++)
+			{
+				data[at + j] = static_cast<uint8_t>(fragment[j]);
+			}
+		}
+		if (i % 2 == 0)
+		{
+			// No full pattern anywhere, to exercise the not-found path.
+			for (size_t j = 0; j + 4 <= data.size(); j++)
+			{
+				if (FindCaptureReference(data.data() + j, 4) == 0)
+				{
+					data[j + 3] = 's';
+				}
+			}
+		}
+
+		size_t offset = random() % 64;
+		size_t length = i < 100 ? static_cast<size_t>(i) : random() % (data.size() - offset + 1);
+		size_t expected = FindCaptureReference(data.data() + offset, length);
+		for (OggScanKernel kernel : ScanKernels)
+		{
+			if (OggScanKernelSupported(kernel))
+			{
+				CHECK(OggFindCapture(data.data() + offset, length, kernel) == expected);
+			}
+		}
+	}
+}
+
+static void TestPagePlausible()
+{
+	OggTestFile file(30, 30);
+	std::vector<uint8_t> bytes = file.GetBytes();
+	OggPageHeader header;
+	CHECK(OggParsePageHeader(bytes.data(), bytes.size(), header) == OGG_PAGE_OK);
+	size_t size = header.PageSize();
+
+	CHECK(OggPagePlausible(bytes.data(), bytes.size(), header));
+	// Too little buffered to see the next page isn't held against it.
+	CHECK(OggPagePlausible(bytes.data(), size, header));
+
+	OggPageHeader unknownFlags = header;
+	unknownFlags.flags |= 0x08;
+	CHECK(!OggPagePlausible(bytes.data(), bytes.size(), unknownFlags));
+
+	bytes[size] = 'X';
+	CHECK(!OggPagePlausible(bytes.data(), bytes.size(), header));
+	CHECK(OggPagePlausible(bytes.data(), size + 3, header));
+}
+
+int main()
+{
+	TestCrcKnownValue();
+	TestCrcKernelsAgree();
+	TestCrcContinues();
+	TestVerifyPage();
+	TestScanKernelsAgree();
+	TestPagePlausible();
+	return TEST_RESULT();
+}
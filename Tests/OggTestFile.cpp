@@ -0,0 +1,263 @@
+#include "OggTestFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+static void PutLE(uint8_t *p, uint64_t value, int bytes)
+{
+	for (int i = 0; i < bytes; i++)
+	{
+		p[i] = static_cast<uint8_t>(value >> (8 * i));
+	}
+}
+
+static void PutBE(uint8_t *p, uint32_t value, int bytes)
+{
+	for (int i = 0; i < bytes; i++)
+	{
+		p[i] = static_cast<uint8_t>(value >> (8 * (bytes - 1 - i)));
+	}
+}
+
+static std::vector<uint8_t> TheoraIdentHeader()
+{
+	std::vector<uint8_t> header(42, 0);
+	memcpy(header.data(), "\x80theora", 7);
+	header[7] = 3;
+	header[8] = 2;
+	header[9] = 1;
+	PutBE(&header[10], 320 / 16, 2);	// frame size in macroblocks
+	PutBE(&header[12], 240 / 16, 2);
+	PutBE(&header[14], 320, 3);			// picture size
+	PutBE(&header[17], 240, 3);
+	PutBE(&header[22], OggTestFile::FramesPerSecond, 4);
+	PutBE(&header[26], 1, 4);
+	PutBE(&header[40], OggTestFile::KeyframeShift << 5, 2);
+	return header;
+}
+
+static std::vector<uint8_t> VorbisIdentHeader()
+{
+	std::vector<uint8_t> header(30, 0);
+	memcpy(header.data(), "\x01vorbis", 7);
+	header[11] = 2;
+	PutLE(&header[12], OggTestFile::SampleRate, 4);
+	header[28] = 0xb8;	// 256 and 2048 sample blocks
+	header[29] = 1;
+	return header;
+}
+
+// Skeleton 4.0, with presentation and base times of zero.
+static std::vector<uint8_t> SkeletonHeadPacket()
+{
+	std::vector<uint8_t> header(80, 0);
+	memcpy(header.data(), "fishead\0", 8);
+	PutLE(&header[8], 4, 2);
+	PutLE(&header[20], 1000, 8);
+	PutLE(&header[36], 1000, 8);
+	return header;
+}
+
+// Skeleton variable-length integers: seven bits a byte, low first, with
+// the top bit marking the last. Always five bytes here, so the index is
+// the same size whatever it holds.
+static void PutVarint(std::vector<uint8_t> &out, uint64_t value)
+{
+	for (int i = 0; i < 5; i++)
+	{
+		out.push_back(static_cast<uint8_t>(((value >> (7 * i)) & 0x7f) | (i == 4 ? 0x80 : 0)));
+	}
+}
+
+static std::vector<uint8_t> LacingFor(size_t length)
+{
+	std::vector<uint8_t> lacing(length / 255, 255);
+	lacing.push_back(static_cast<uint8_t>(length % 255));
+	return lacing;
+}
+
+OggTestFile::OggTestFile(int frames, int keyframeInterval, bool splitKeyframes, bool audio, bool skeletonIndex) :
+	m_frames(frames),
+	m_keyframeInterval(keyframeInterval),
+	m_frameOffsets(frames),
+	m_audioSamples(0)
+{
+	memset(m_sequence, 0, sizeof(m_sequence));
+
+	if (skeletonIndex)
+	{
+		WritePacketPage(SkeletonSerial, OGG_PAGE_BOS, 0, SkeletonHeadPacket());
+	}
+	WritePacketPage(TheoraSerial, OGG_PAGE_BOS, 0, TheoraIdentHeader());
+	if (audio)
+	{
+		WritePacketPage(VorbisSerial, OGG_PAGE_BOS, 0, VorbisIdentHeader());
+	}
+	WritePacketPage(TheoraSerial, 0, 0, std::vector<uint8_t>(20, 0x81));
+	WritePacketPage(TheoraSerial, 0, 0, std::vector<uint8_t>(20, 0x82));
+	if (audio)
+	{
+		WritePacketPage(VorbisSerial, 0, 0, std::vector<uint8_t>(20, 0x03));
+		WritePacketPage(VorbisSerial, 0, 0, std::vector<uint8_t>(20, 0x05));
+	}
+
+	// The index can't be filled in until the frames are laid out; it keeps
+	// its size, so save room for it and patch it in at the end.
+	size_t indexPage = m_bytes.size();
+	if (skeletonIndex)
+	{
+		WritePacketPage(SkeletonSerial, OGG_PAGE_EOS, 0, SkeletonIndexPacket());
+	}
+
+	std::minstd_rand random(1);
+	std::vector<std::vector<uint8_t>> packets(frames);
+	for (int frame = 1; frame <= frames; frame++)
+	{
+		bool keyframe = KeyframeFor(frame) == frame;
+		std::vector<uint8_t> &packet = packets[frame - 1];
+		packet.resize((keyframe ? 2000 : 500) + random() % 3000);
+		for (auto &byte : packet)
+		{
+			byte = static_cast<uint8_t>(random());
+		}
+		packet[0] = keyframe ? 0x00 : 0x40;
+	}
+
+	// Bytes of the current frame's packet already written on the page before.
+	size_t carried = 0;
+	for (int frame = 1; frame <= frames; frame++)
+	{
+		int key = KeyframeFor(frame);
+		int64_t granulepos = (static_cast<int64_t>(key) << KeyframeShift) | (frame - key);
+		const std::vector<uint8_t> &packet = packets[frame - 1];
+
+		if (carried == 0)
+		{
+			m_frameOffsets[frame - 1] = m_bytes.size();
+		}
+		std::vector<uint8_t> body(packet.begin() + carried, packet.end());
+		std::vector<uint8_t> lacing = LacingFor(body.size());
+		uint8_t flags = carried > 0 ? OGG_PAGE_CONTINUED : 0;
+
+		carried = 0;
+		if (splitKeyframes && frame < frames && KeyframeFor(frame + 1) == frame + 1)
+		{
+			// Start the next packet here, with lacing values that say it goes on.
+			const std::vector<uint8_t> &next = packets[frame];
+			carried = 2 * 255;
+			body.insert(body.end(), next.begin(), next.begin() + carried);
+			lacing.push_back(255);
+			lacing.push_back(255);
+			m_frameOffsets[frame] = m_bytes.size();
+		}
+
+		WritePage(TheoraSerial, flags, granulepos, lacing, body);
+		if (audio)
+		{
+			WriteAudioUpTo(static_cast<double>(frame) / FramesPerSecond);
+		}
+	}
+
+	if (skeletonIndex)
+	{
+		std::vector<uint8_t> packet = SkeletonIndexPacket();
+		uint8_t *page = &m_bytes[indexPage];
+		size_t headerSize = OggPageMinHeaderSize + page[26];
+		memcpy(page + headerSize, packet.data(), packet.size());
+		PutLE(page + 22, 0, 4);
+		PutLE(page + 22, OggPageChecksum(page, headerSize + packet.size()), 4);
+	}
+}
+
+// Keypoints for the Theora stream, one per keyframe, with times in frames.
+std::vector<uint8_t> OggTestFile::SkeletonIndexPacket() const
+{
+	int keyframes = (m_frames - 1) / m_keyframeInterval + 1;
+	std::vector<uint8_t> packet(42, 0);
+	memcpy(packet.data(), "index\0", 6);
+	PutLE(&packet[6], TheoraSerial, 4);
+	PutLE(&packet[10], keyframes, 8);
+	PutLE(&packet[18], FramesPerSecond, 8);
+	PutLE(&packet[34], m_frames, 8);
+
+	uint64_t offset = 0;
+	int time = 0;
+	for (int i = 0; i < keyframes; i++)
+	{
+		int key = i * m_keyframeInterval + 1;
+		PutVarint(packet, FrameOffset(key) - offset);
+		PutVarint(packet, key - 1 - time);
+		offset = FrameOffset(key);
+		time = key - 1;
+	}
+	return packet;
+}
+
+int OggTestFile::FrameAt(double time) const
+{
+	int frame = static_cast<int>(floor(time * FramesPerSecond + 1e-9)) + 1;
+	return frame < 1 ? 1 : (frame > m_frames ? m_frames : frame);
+}
+
+OgvReadFunc OggTestFile::ReadFunc() const
+{
+	const std::vector<uint8_t> *bytes = &m_bytes;
+	return [bytes](uint64_t offset, uint8_t *buffer, size_t length) -> size_t {
+		if (offset >= bytes->size())
+		{
+			return 0;
+		}
+		size_t count = std::min<size_t>(length, static_cast<size_t>(bytes->size() - offset));
+		memcpy(buffer, bytes->data() + offset, count);
+		return count;
+	};
+}
+
+OgvViewFunc OggTestFile::ViewFunc() const
+{
+	const std::vector<uint8_t> *bytes = &m_bytes;
+	return [bytes](uint64_t offset, size_t, const uint8_t *&data) -> size_t {
+		if (offset >= bytes->size())
+		{
+			return 0;
+		}
+		data = bytes->data() + offset;
+		return static_cast<size_t>(bytes->size() - offset);
+	};
+}
+
+void OggTestFile::WritePage(uint32_t serialno, uint8_t flags, int64_t granulepos, const std::vector<uint8_t> &lacing, const std::vector<uint8_t> &body)
+{
+	std::vector<uint8_t> page(OggPageMinHeaderSize, 0);
+	memcpy(page.data(), "OggS", 4);
+	page[5] = flags;
+	PutLE(&page[6], static_cast<uint64_t>(granulepos), 8);
+	PutLE(&page[14], serialno, 4);
+	PutLE(&page[18], m_sequence[serialno]++, 4);
+	page[26] = static_cast<uint8_t>(lacing.size());
+	page.insert(page.end(), lacing.begin(), lacing.end());
+	page.insert(page.end(), body.begin(), body.end());
+	PutLE(&page[22], OggPageChecksum(page.data(), page.size()), 4);
+	m_bytes.insert(m_bytes.end(), page.begin(), page.end());
+}
+
+void OggTestFile::WritePacketPage(uint32_t serialno, uint8_t flags, int64_t granulepos, const std::vector<uint8_t> &packet)
+{
+	WritePage(serialno, flags, granulepos, LacingFor(packet.size()), packet);
+}
+
+void OggTestFile::WriteAudioUpTo(double time)
+{
+	std::vector<uint8_t> packet(300);
+	while (m_audioSamples < static_cast<int64_t>(time * SampleRate))
+	{
+		m_audioSamples += SamplesPerPacket;
+		for (size_t i = 0; i < packet.size(); i++)
+		{
+			packet[i] = static_cast<uint8_t>((m_audioSamples + i * 7) & 0xfe);
+		}
+		WritePacketPage(VorbisSerial, 0, m_audioSamples, packet);
+	}
+}
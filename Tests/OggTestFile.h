@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "OgvSeekIndex.h"
+
+// An Ogg file built in memory for the demuxing tests: a 320x240, 30 fps
+// Theora stream and, optionally, a 44.1 kHz Vorbis stream, interleaved the
+// way a muxer would with a page per packet. Packets are noise; only their
+// first byte means anything, marking video keyframes. Frames are counted
+// from 1, as Theora 3.2.1 granule positions do.
+//
+// With skeletonIndex, a Skeleton 4.0 stream comes first, its index listing
+// every video keyframe as a keypoint at the offset FrameOffset gives.
+class OggTestFile
+{
+public:
+	static const uint32_t TheoraSerial = 1;
+	static const uint32_t VorbisSerial = 2;
+	static const uint32_t SkeletonSerial = 3;
+	static const int KeyframeShift = 6;
+	static const int FramesPerSecond = 30;
+	static const int SampleRate = 44100;
+	static const int SamplesPerPacket = 1024;
+
+	// With splitKeyframes, each keyframe packet starts at the end of the
+	// page holding the frame before it and finishes on the next one.
+	OggTestFile(int frames = 3000, int keyframeInterval = 45, bool splitKeyframes = false, bool audio = true, bool skeletonIndex = false);
+
+	const std::vector<uint8_t> &GetBytes() const { return m_bytes; }
+	uint64_t GetLength() const { return m_bytes.size(); }
+
+	int GetFrames() const { return m_frames; }
+	int KeyframeFor(int frame) const { return (frame - 1) / m_keyframeInterval * m_keyframeInterval + 1; }
+	double FrameTime(int frame) const { return static_cast<double>(frame - 1) / FramesPerSecond; }
+	int FrameAt(double time) const;
+
+	// Offset of the page a frame's packet starts on.
+	uint64_t FrameOffset(int frame) const { return m_frameOffsets[frame - 1]; }
+
+	static bool IsKeyframePacket(const uint8_t *packet, size_t length) { return length > 0 && (packet[0] & 0x40) == 0; }
+
+	OgvReadFunc ReadFunc() const;
+	OgvViewFunc ViewFunc() const;
+
+private:
+	void WritePage(uint32_t serialno, uint8_t flags, int64_t granulepos, const std::vector<uint8_t> &lacing, const std::vector<uint8_t> &body);
+	void WritePacketPage(uint32_t serialno, uint8_t flags, int64_t granulepos, const std::vector<uint8_t> &packet);
+	void WriteAudioUpTo(double time);
+	std::vector<uint8_t> SkeletonIndexPacket() const;
+
+	int m_frames;
+	int m_keyframeInterval;
+	std::vector<uint8_t> m_bytes;
+	std::vector<uint64_t> m_frameOffsets;
+	uint32_t m_sequence[4];
+	int64_t m_audioSamples;
+};
@@ -0,0 +1,127 @@
+#include "OggTestFile.h"
+#include "OgvByteCache.h"
+#include "OgvDemuxer.h"
+#include "OgvSeekIndex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Round trip per request, as to a server some way off.
+static const int LatencyMs = 30;
+// Media played in real time after the first page, per run.
+static const double PlaySeconds = 3.0;
+
+// The test file served over one link of a given speed: requests queue for
+// it, and each costs a round trip plus its transfer time.
+class ThrottledSource : public OgvByteSource
+{
+public:
+	ThrottledSource(const std::vector<uint8_t> &data, double bytesPerSecond) : m_data(data), m_bytesPerSecond(bytesPerSecond) {}
+
+	virtual uint64_t GetLength() const { return m_data.GetLength(); }
+
+	virtual size_t ReadAt(uint64_t offset, uint8_t *buffer, size_t length)
+	{
+		std::lock_guard<std::mutex> lock(m_link);
+		size_t count = m_data.ReadAt(offset, buffer, length);
+		double seconds = LatencyMs / 1000.0 + count / m_bytesPerSecond;
+		std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		return count;
+	}
+
+private:
+	OgvMemoryByteSource m_data;
+	double m_bytesPerSecond;
+	std::mutex m_link;
+};
+
+struct Startup
+{
+	double firstPageMs;		// open to the first page with a sample
+	int latePages;			// pages that came in after their samples were due
+	OgvByteCacheStats cache;
+};
+
+static double MillisecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Opens the file as the source does and plays the start of it in real time,
+// demuxing each page no sooner than its samples are due.
+static Startup Play(const OggTestFile &file, double bytesPerSecond, bool cached)
+{
+	std::shared_ptr<OgvByteSource> source = std::make_shared<ThrottledSource>(file.GetBytes(), bytesPerSecond);
+	std::shared_ptr<OgvCachedByteSource> cache;
+	if (cached)
+	{
+		cache = std::make_shared<OgvCachedByteSource>(source, 32, 8);
+		source = cache;
+	}
+	OgvReadFunc read = OgvByteSource::MakeReadFunc(source);
+
+	Startup startup = {};
+	Clock::time_point start = Clock::now();
+	OgvSeekIndex index;
+	OgvDemuxer demuxer;
+	if (!index.Open(read, file.GetLength()))
+	{
+		return startup;
+	}
+	demuxer.Open(read, file.GetLength(), index.GetStreams());
+	demuxer.ReadHeaders(index.GetDataOffset());
+
+	double mediaSeconds = -1.0;
+	auto onSample = [&mediaSeconds](uint32_t, OgvSample &sample) {
+		mediaSeconds = std::max(mediaSeconds, sample.time / 10000000.0);
+	};
+	while (mediaSeconds < 0.0 && demuxer.ReadPage(onSample))
+	{
+	}
+	startup.firstPageMs = MillisecondsSince(start);
+
+	Clock::time_point playStart = Clock::now();
+	while (mediaSeconds < PlaySeconds && demuxer.ReadPage(onSample))
+	{
+		Clock::time_point due = playStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(mediaSeconds));
+		if (Clock::now() > due)
+		{
+			startup.latePages++;
+		}
+		std::this_thread::sleep_until(due);
+	}
+
+	if (cache)
+	{
+		startup.cache = cache->GetStats();
+	}
+	return startup;
+}
+
+int main()
+{
+	// The test file runs at about 95 KB/s; the slowest link can't keep up.
+	const double rates[] = { 64, 256, 1024, 4096 };
+	OggTestFile file;
+
+	printf("%d ms round trip, first %.0f s played in real time\n\n", LatencyMs, PlaySeconds);
+	printf("%8s  %21s  %37s\n", "", "direct", "cached");
+	printf("%8s  %10s %10s  %10s %10s %7s %7s\n", "KB/s", "first ms", "late", "first ms", "late", "stalls", "misses");
+	for (double rate : rates)
+	{
+		Startup direct = Play(file, rate * 1024, false);
+		Startup cached = Play(file, rate * 1024, true);
+		printf("%8.0f  %10.1f %10d  %10.1f %10d %7llu %7llu\n", rate,
+			direct.firstPageMs, direct.latePages,
+			cached.firstPageMs, cached.latePages,
+			static_cast<unsigned long long>(cached.cache.stalls),
+			static_cast<unsigned long long>(cached.cache.misses));
+	}
+	return 0;
+}
@@ -0,0 +1,152 @@
+#include "OgvByteCache.h"
+#include "TestHarness.h"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+static std::vector<uint8_t> MakeData(size_t size)
+{
+	std::vector<uint8_t> data(size);
+	std::minstd_rand random(1);
+	for (auto &byte : data)
+	{
+		byte = static_cast<uint8_t>(random());
+	}
+	return data;
+}
+
+// Memory that can be told to fail its next few reads, and to take a while
+// over each one, like a server having a bad moment.
+class FlakySource : public OgvByteSource
+{
+public:
+	explicit FlakySource(const std::vector<uint8_t> &data) : m_data(data), m_failures(0), m_delayMs(0), m_reads(0) {}
+
+	void FailNext(int count) { m_failures = count; }
+	void SetDelay(int ms) { m_delayMs = ms; }
+	int GetReads() const { return m_reads; }
+
+	virtual uint64_t GetLength() const { return m_data.size(); }
+
+	virtual size_t ReadAt(uint64_t offset, uint8_t *buffer, size_t length)
+	{
+		m_reads++;
+		if (m_delayMs > 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(m_delayMs));
+		}
+		if (m_failures > 0)
+		{
+			m_failures--;
+			return 0;
+		}
+		return OgvMemoryByteSource(m_data).ReadAt(offset, buffer, length);
+	}
+
+private:
+	std::vector<uint8_t> m_data;
+	std::atomic<int> m_failures;
+	std::atomic<int> m_delayMs;
+	std::atomic<int> m_reads;
+};
+
+static bool ReadMatches(OgvByteSource &source, const std::vector<uint8_t> &data, uint64_t offset, size_t length)
+{
+	std::vector<uint8_t> buffer(length);
+	size_t expected = offset < data.size() ? std::min<size_t>(length, static_cast<size_t>(data.size() - offset)) : 0;
+	size_t got = source.ReadAt(offset, buffer.data(), length);
+	return got == expected && std::equal(buffer.begin(), buffer.begin() + got, data.begin() + static_cast<size_t>(std::min<uint64_t>(offset, data.size())));
+}
+
+static void TestMemorySource()
+{
+	std::vector<uint8_t> data = MakeData(1000);
+	OgvMemoryByteSource source(data);
+	CHECK(source.GetLength() == 1000);
+	CHECK(ReadMatches(source, data, 0, 1000));
+	CHECK(ReadMatches(source, data, 990, 100));
+	CHECK(ReadMatches(source, data, 1000, 10));
+	CHECK(ReadMatches(source, data, 5000, 10));
+}
+
+// Reads straddling blocks, from several threads at once, give back
+// exactly the source's bytes.
+static void TestConcurrentReadsMatch()
+{
+	const size_t BlockSize = OgvCachedByteSource::BlockSize;
+	std::vector<uint8_t> data = MakeData(BlockSize * 20 + 123);
+	auto flaky = std::make_shared<FlakySource>(data);
+	OgvCachedByteSource cache(flaky, 6, 2);
+	CHECK(cache.GetLength() == data.size());
+
+	std::atomic<int> mismatches(0);
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; t++)
+	{
+		readers.push_back(std::thread([&cache, &data, &mismatches, t] {
+			std::minstd_rand random(t + 1);
+			for (int i = 0; i < 200; i++)
+			{
+				uint64_t offset = random() % (data.size() + 100);
+				size_t length = random() % (3 * OgvCachedByteSource::BlockSize);
+				mismatches += ReadMatches(cache, data, offset, length) ? 0 : 1;
+			}
+		}));
+	}
+	for (auto &reader : readers)
+	{
+		reader.join();
+	}
+	CHECK(mismatches == 0);
+}
+
+// A failed fetch isn't remembered: the read comes back short, and asking
+// again goes back to the source.
+static void TestFailedFetchIsRetried()
+{
+	std::vector<uint8_t> data = MakeData(OgvCachedByteSource::BlockSize * 4);
+	auto flaky = std::make_shared<FlakySource>(data);
+	OgvCachedByteSource cache(flaky, 8, 0);
+
+	std::vector<uint8_t> buffer(1000);
+	flaky->FailNext(1);
+	CHECK(cache.ReadAt(100, buffer.data(), buffer.size()) == 0);
+	CHECK(ReadMatches(cache, data, 100, buffer.size()));
+	CHECK(cache.GetStats().misses == 2);
+}
+
+// Reading straight through at a steady pace, the read-ahead thread gets
+// to most blocks first.
+static void TestReadAhead()
+{
+	const size_t BlockSize = OgvCachedByteSource::BlockSize;
+	std::vector<uint8_t> data = MakeData(BlockSize * 16);
+	auto flaky = std::make_shared<FlakySource>(data);
+	flaky->SetDelay(2);
+	OgvCachedByteSource cache(flaky, 8, 4);
+
+	bool same = true;
+	for (uint64_t offset = 0; offset < data.size(); offset += BlockSize / 4)
+	{
+		same = same && ReadMatches(cache, data, offset, BlockSize / 4);
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	CHECK(same);
+
+	OgvByteCacheStats stats = cache.GetStats();
+	CHECK(stats.prefetched > 0);
+	CHECK(stats.misses < 16);
+	CHECK(stats.bytesFetched >= data.size());
+}
+
+int main()
+{
+	TestMemorySource();
+	TestConcurrentReadsMatch();
+	TestFailedFetchIsRetried();
+	TestReadAhead();
+	return TEST_RESULT();
+}
@@ -0,0 +1,134 @@
+#include "OggTestFile.h"
+#include "OgvDeadlinePolicy.h"
+#include "OgvDemuxer.h"
+#include "OgvSeekIndex.h"
+#include "TestHarness.h"
+
+#include <algorithm>
+#include <cstdint>
+
+static const int64_t TicksPerMillisecond = 10000;
+
+struct PlaybackResult
+{
+	int delivered;
+	int64_t maxLateness;		// of any frame delivered
+	int64_t maxInterLateness;	// of inter frames delivered
+	int64_t finalLateness;
+	bool resumedOnKeyframes;	// every frame after a drop was a keyframe
+	OgvDeadlineStats stats;
+};
+
+// Plays a file through the demuxer against a virtual clock, with a decoder
+// that takes decodeMs per frame. Demuxing costs nothing, and a frame that
+// is early waits for its time before decoding, as the renderer would hold
+// it. Lateness is how far the clock is past a frame's time when it is
+// demuxed.
+static PlaybackResult Play(const OggTestFile &file, int decodeMs, int64_t skipThreshold)
+{
+	OgvSeekIndex index;
+	CHECK(index.Open(file.ReadFunc(), file.GetLength()));
+	OgvDemuxer demuxer;
+	demuxer.Open(file.ReadFunc(), file.GetLength(), index.GetStreams());
+	CHECK(demuxer.ReadHeaders(index.GetDataOffset()));
+	OgvDeadlinePolicy policy(demuxer, skipThreshold);
+
+	PlaybackResult result = {};
+	result.resumedOnKeyframes = true;
+	int64_t clock = 0;
+	bool dropped = false;
+	while (demuxer.ReadPage([&](uint32_t serialno, OgvSample &sample) {
+		if (serialno != OggTestFile::TheoraSerial)
+		{
+			return;
+		}
+		int64_t lateness = clock - sample.time;
+		if (!policy.FrameDemuxed(lateness, sample.keyframe))
+		{
+			dropped = true;
+			return;
+		}
+		if (dropped)
+		{
+			result.resumedOnKeyframes = result.resumedOnKeyframes && sample.keyframe;
+			dropped = false;
+		}
+
+		result.delivered++;
+		result.maxLateness = std::max(result.maxLateness, lateness);
+		if (!sample.keyframe)
+		{
+			result.maxInterLateness = std::max(result.maxInterLateness, lateness);
+		}
+		result.finalLateness = lateness;
+		clock = std::max(clock, sample.time) + decodeMs * TicksPerMillisecond;
+	}))
+	{
+	}
+	CHECK(demuxer.IsEndOfStream());
+	result.stats = policy.GetStats();
+	return result;
+}
+
+// A decoder that keeps up shows every frame, on time.
+static void TestFastDecoderDropsNothing()
+{
+	OggTestFile file(900, 45);
+	PlaybackResult result = Play(file, 20, OgvDeadlinePolicy::DefaultSkipThreshold);
+	CHECK(result.delivered == file.GetFrames());
+	CHECK(result.stats.framesOnTime == static_cast<uint64_t>(file.GetFrames()));
+	CHECK(result.stats.framesLate == 0);
+	CHECK(result.stats.framesDropped == 0);
+	CHECK(result.stats.keyframeSkips == 0);
+}
+
+// Left alone, a decoder at 50 ms a frame on 30 fps video ends up ten
+// seconds behind by the end of half a minute.
+static void TestSlowDecoderDriftsWithoutSkipping()
+{
+	OggTestFile file(900, 45);
+	PlaybackResult result = Play(file, 50, INT64_MAX);
+	CHECK(result.delivered == file.GetFrames());
+	CHECK(result.stats.framesDropped == 0);
+	CHECK(result.finalLateness > 10000 * TicksPerMillisecond);
+}
+
+// With skipping, the same decoder stays within the threshold: whole runs
+// of inter frames go, playback picks up again at keyframes, and every frame
+// in the file is accounted for.
+static void TestSlowDecoderSkipsToKeyframes()
+{
+	OggTestFile file(900, 45);
+	const int64_t threshold = OgvDeadlinePolicy::DefaultSkipThreshold;
+	PlaybackResult result = Play(file, 50, threshold);
+
+	CHECK(result.stats.keyframeSkips > 0);
+	CHECK(result.stats.framesDropped > result.stats.keyframeSkips);
+	CHECK(result.resumedOnKeyframes);
+	CHECK(result.maxInterLateness <= threshold);
+	CHECK(result.maxLateness <= threshold + 50 * TicksPerMillisecond);
+	CHECK(result.finalLateness <= threshold);
+	CHECK(result.stats.framesLate > 0);
+	CHECK(result.delivered == static_cast<int>(result.stats.framesOnTime + result.stats.framesLate));
+	CHECK(result.stats.framesOnTime + result.stats.framesLate + result.stats.framesDropped == static_cast<uint64_t>(file.GetFrames()));
+}
+
+// Skips are driven by lateness alone: with no threshold at all, every
+// late inter frame sets one off.
+static void TestZeroThreshold()
+{
+	OggTestFile file(300, 30);
+	PlaybackResult result = Play(file, 50, 0);
+	CHECK(result.maxInterLateness <= 0);
+	CHECK(result.resumedOnKeyframes);
+	CHECK(result.stats.framesOnTime + result.stats.framesLate + result.stats.framesDropped == static_cast<uint64_t>(file.GetFrames()));
+}
+
+int main()
+{
+	TestFastDecoderDropsNothing();
+	TestSlowDecoderDriftsWithoutSkipping();
+	TestSlowDecoderSkipsToKeyframes();
+	TestZeroThreshold();
+	return TEST_RESULT();
+}
@@ -0,0 +1,441 @@
+#include "OggTestFile.h"
+#include "OgvDemuxer.h"
+#include "OgvSeekIndex.h"
+#include "TestHarness.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+static const int64_t TicksPerSecond = 10000000;
+
+struct DemuxedSample
+{
+	uint32_t serialno;
+	OgvSample sample;
+};
+
+// An index and a demuxer opened on a test file, ready to read from its first data page.
+struct DemuxFixture
+{
+	OgvSeekIndex index;
+	OgvDemuxer demuxer;
+
+	// With inPlace, pages are parsed straight out of the file's bytes
+	// through a view instead of being read into a buffer.
+	explicit DemuxFixture(const OggTestFile &file, bool inPlace = false)
+	{
+		OgvViewFunc view = inPlace ? file.ViewFunc() : OgvViewFunc();
+		CHECK(index.Open(file.ReadFunc(), file.GetLength(), view));
+		demuxer.Open(file.ReadFunc(), file.GetLength(), index.GetStreams(), view);
+		CHECK(demuxer.ReadHeaders(index.GetDataOffset()));
+	}
+
+	// Demuxes until count samples of the stream have come out, or the end.
+	std::vector<DemuxedSample> Read(uint32_t serialno, size_t count)
+	{
+		std::vector<DemuxedSample> samples;
+		size_t matching = 0;
+		while (matching < count && demuxer.ReadPage([&](uint32_t serial, OgvSample &sample) {
+			DemuxedSample demuxed;
+			demuxed.serialno = serial;
+			demuxed.sample = std::move(sample);
+			samples.push_back(std::move(demuxed));
+			matching += serial == serialno ? 1 : 0;
+		}))
+		{
+		}
+		return samples;
+	}
+
+	std::vector<OgvSample> ReadVideo(size_t count)
+	{
+		std::vector<OgvSample> video;
+		for (auto &demuxed : Read(OggTestFile::TheoraSerial, count))
+		{
+			if (demuxed.serialno == OggTestFile::TheoraSerial)
+			{
+				video.push_back(std::move(demuxed.sample));
+			}
+		}
+		return video;
+	}
+};
+
+static int64_t FrameTicks(const OggTestFile &, int frame)
+{
+	return static_cast<int64_t>(frame - 1) * TicksPerSecond / OggTestFile::FramesPerSecond;
+}
+
+static void TestDemuxWholeFile()
+{
+	OggTestFile file(300, 30);
+	DemuxFixture fixture(file);
+	CHECK(fixture.demuxer.GetHeaders(OggTestFile::TheoraSerial).size() == 3);
+	CHECK(fixture.demuxer.GetHeaders(OggTestFile::VorbisSerial).size() == 3);
+
+	std::vector<OgvSample> video = fixture.ReadVideo(file.GetFrames() + 1);
+	CHECK(video.size() == static_cast<size_t>(file.GetFrames()));
+	CHECK(fixture.demuxer.IsEndOfStream());
+
+	bool timesOk = true;
+	bool keyframesOk = true;
+	for (size_t i = 0; i < video.size(); i++)
+	{
+		int frame = static_cast<int>(i) + 1;
+		timesOk = timesOk && video[i].time == FrameTicks(file, frame);
+		keyframesOk = keyframesOk && video[i].keyframe == (file.KeyframeFor(frame) == frame) &&
+			video[i].keyframe == OggTestFile::IsKeyframePacket(video[i].data.data(), video[i].data.size());
+	}
+	CHECK(timesOk);
+	CHECK(keyframesOk);
+	CHECK(!video.empty() && video[0].discontinuity);
+}
+
+// After a seek the first video sample must be the keyframe decoding
+// restarts from, whatever page the seek landed on.
+static void CheckSeeks(const OggTestFile &file)
+{
+	DemuxFixture fixture(file);
+	const double times[] = { 0.5, 1.5, 10.1, 33.3, 55.0, 99.0 };
+	for (double time : times)
+	{
+		OgvSeekTarget target;
+		CHECK(fixture.index.Seek(time, target));
+		fixture.demuxer.Seek(target.offset);
+
+		std::vector<OgvSample> video = fixture.ReadVideo(1);
+		int key = file.KeyframeFor(file.FrameAt(time));
+		CHECK(video.size() == 1);
+		CHECK(!video.empty() && video[0].keyframe && video[0].discontinuity);
+		CHECK(!video.empty() && video[0].time == FrameTicks(file, key));
+	}
+}
+
+static void TestSeekStartsOnKeyframe()
+{
+	CheckSeeks(OggTestFile());
+	CheckSeeks(OggTestFile(3000, 45, true, false));
+}
+
+// A seek straight to a page in the middle of a group of pictures.
+static void TestSeekMidGroupSkipsToKeyframe()
+{
+	OggTestFile file;
+	DemuxFixture fixture(file);
+	uint64_t thinnedBefore = fixture.demuxer.GetThinnedFrames();
+
+	fixture.demuxer.Seek(file.FrameOffset(100));
+	std::vector<OgvSample> video = fixture.ReadVideo(1);
+	CHECK(video.size() == 1);
+	CHECK(!video.empty() && video[0].keyframe && video[0].time == FrameTicks(file, 136));
+	CHECK(fixture.demuxer.GetThinnedFrames() - thinnedBefore == 36);
+}
+
+// Reading straight through should fetch each byte about once, not a
+// window's worth per page.
+static void TestReadsAreNotRepeated()
+{
+	OggTestFile file;
+	OgvReadFunc read = file.ReadFunc();
+	uint64_t bytesRead = 0;
+	OgvReadFunc counted = [read, &bytesRead](uint64_t offset, uint8_t *buffer, size_t length) -> size_t {
+		size_t got = read(offset, buffer, length);
+		bytesRead += got;
+		return got;
+	};
+
+	OgvSeekIndex index;
+	CHECK(index.Open(file.ReadFunc(), file.GetLength()));
+	OgvDemuxer demuxer;
+	demuxer.Open(counted, file.GetLength(), index.GetStreams());
+	CHECK(demuxer.ReadHeaders(index.GetDataOffset()));
+	while (demuxer.ReadPage([](uint32_t, OgvSample &) {}))
+	{
+	}
+	CHECK(demuxer.IsEndOfStream());
+	CHECK(bytesRead < file.GetLength() * 3 / 2);
+}
+
+static bool SameSamples(const std::vector<DemuxedSample> &a, const std::vector<DemuxedSample> &b)
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		const OgvSample &x = a[i].sample;
+		const OgvSample &y = b[i].sample;
+		if (a[i].serialno != b[i].serialno || x.data != y.data || x.time != y.time || x.duration != y.duration ||
+			x.keyframe != y.keyframe || x.discontinuity != y.discontinuity)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Parsing in place must give exactly what reading through a buffer does,
+// from the start and after seeks.
+static void TestInPlaceMatchesBuffered()
+{
+	OggTestFile file(600, 45, true);
+	DemuxFixture buffered(file);
+	DemuxFixture inPlace(file, true);
+	CHECK(inPlace.index.GetDataOffset() == buffered.index.GetDataOffset());
+	CHECK(inPlace.demuxer.GetHeaders(OggTestFile::TheoraSerial) == buffered.demuxer.GetHeaders(OggTestFile::TheoraSerial));
+
+	CHECK(SameSamples(inPlace.Read(OggTestFile::TheoraSerial, file.GetFrames()), buffered.Read(OggTestFile::TheoraSerial, file.GetFrames())));
+
+	const double times[] = { 3.0, 11.2, 0.7 };
+	for (double time : times)
+	{
+		OgvSeekTarget a, b;
+		CHECK(inPlace.index.Seek(time, a));
+		CHECK(buffered.index.Seek(time, b));
+		CHECK(a.offset == b.offset && a.keyframeGranule == b.keyframeGranule);
+		inPlace.demuxer.Seek(a.offset);
+		buffered.demuxer.Seek(b.offset);
+		CHECK(SameSamples(inPlace.Read(OggTestFile::TheoraSerial, 50), buffered.Read(OggTestFile::TheoraSerial, 50)));
+	}
+	CHECK(inPlace.index.GetReadCount() == 0);
+}
+
+// A read that fails or comes up short partway through the file isn't the
+// end of it: the demuxer reports the error, and carries on from the same
+// page once the source recovers.
+static void TestShortReadIsNotEndOfStream()
+{
+	OggTestFile file(300, 30);
+	OgvReadFunc read = file.ReadFunc();
+	int readsLeft = -1;
+	bool stutter = false;
+	int reads = 0;
+	OgvReadFunc flaky = [read, &readsLeft, &stutter, &reads](uint64_t offset, uint8_t *buffer, size_t length) -> size_t {
+		if (readsLeft == 0)
+		{
+			return 0;
+		}
+		readsLeft--;
+		bool shortRead = stutter && reads++ % 2 == 0;
+		return read(offset, buffer, shortRead ? std::min<size_t>(length, 100) : length);
+	};
+
+	OgvSeekIndex index;
+	CHECK(index.Open(file.ReadFunc(), file.GetLength()));
+	OgvDemuxer demuxer;
+	demuxer.Open(flaky, file.GetLength(), index.GetStreams());
+	CHECK(demuxer.ReadHeaders(index.GetDataOffset()));
+
+	size_t frames = 0;
+	auto onSample = [&frames](uint32_t serialno, OgvSample &) {
+		frames += serialno == OggTestFile::TheoraSerial ? 1 : 0;
+	};
+	while (frames < 100 && demuxer.ReadPage(onSample))
+	{
+	}
+
+	// Cut the source off, then let it back with every other read cut short of a page.
+	readsLeft = 0;
+	bool more = true;
+	for (int i = 0; i < 1000 && more; i++)
+	{
+		more = demuxer.ReadPage(onSample);
+	}
+	CHECK(!more);
+	CHECK(demuxer.HasReadError());
+	CHECK(!demuxer.IsEndOfStream());
+
+	readsLeft = -1;
+	stutter = true;
+	int errors = 0;
+	for (int i = 0; i < 10000 && (demuxer.ReadPage(onSample) || demuxer.HasReadError()); i++)
+	{
+		errors += demuxer.HasReadError() ? 1 : 0;
+	}
+	CHECK(demuxer.IsEndOfStream());
+	CHECK(!demuxer.HasReadError());
+	CHECK(frames == static_cast<size_t>(file.GetFrames()));
+	CHECK(errors > 0);
+}
+
+// Damage in the middle of a file costs only the pages it touches: the
+// demuxer scans past garbage, including stray capture patterns, to the
+// next good page, and flags the stream it lost data from.
+static void TestResyncAfterDamage()
+{
+	OggTestFile file(300, 30);
+	std::vector<uint8_t> bytes = file.GetBytes();
+
+	// Scribble over the body of frame 100's page, with a fake page header
+	// in it, and splice noise full of capture patterns in before frame 200.
+	size_t damaged = static_cast<size_t>(file.FrameOffset(100)) + 40;
+	const char fake[] = "OggS\0\0\0\0\0\0\0\0\0\0\1\0\0\0";
+	std::copy(fake, fake + sizeof(fake), bytes.begin() + damaged);
+	std::vector<uint8_t> noise(20000);
+	for (size_t i = 0; i < noise.size(); i++)
+	{
+		noise[i] = i % 97 < 4 ? "OggS"[i % 97] : static_cast<uint8_t>(i * 2654435761u >> 24);
+	}
+	bytes.insert(bytes.begin() + static_cast<size_t>(file.FrameOffset(200)), noise.begin(), noise.end());
+
+	OgvReadFunc read = [&bytes](uint64_t offset, uint8_t *buffer, size_t length) -> size_t {
+		size_t count = offset < bytes.size() ? std::min<size_t>(length, static_cast<size_t>(bytes.size() - offset)) : 0;
+		std::copy(bytes.begin() + static_cast<size_t>(offset), bytes.begin() + static_cast<size_t>(offset) + count, buffer);
+		return count;
+	};
+	OgvSeekIndex index;
+	CHECK(index.Open(read, bytes.size()));
+	OgvDemuxer demuxer;
+	demuxer.Open(read, bytes.size(), index.GetStreams());
+	CHECK(demuxer.ReadHeaders(index.GetDataOffset()));
+
+	std::vector<OgvSample> video;
+	size_t audio = 0;
+	while (demuxer.ReadPage([&](uint32_t serialno, OgvSample &sample) {
+		if (serialno == OggTestFile::TheoraSerial)
+		{
+			video.push_back(std::move(sample));
+		}
+		audio += serialno == OggTestFile::VorbisSerial ? 1 : 0;
+	}))
+	{
+	}
+	CHECK(demuxer.IsEndOfStream());
+	CHECK(!demuxer.HasReadError());
+	CHECK(audio > 0);
+
+	// Only frame 100 is gone, and what follows the damage is stamped right.
+	CHECK(video.size() == static_cast<size_t>(file.GetFrames() - 1));
+	bool timesOk = true;
+	for (size_t i = 0; i < video.size(); i++)
+	{
+		int frame = static_cast<int>(i) + (i < 99 ? 1 : 2);
+		timesOk = timesOk && video[i].time == FrameTicks(file, frame);
+	}
+	CHECK(timesOk);
+	CHECK(video.size() > 99 && video[99].discontinuity);
+	CHECK(video.size() > 198 && video[198].discontinuity);
+	CHECK(video.size() > 150 && !video[150].discontinuity);
+}
+
+// A disabled stream produces nothing, and doesn't hold up the others.
+// Re-enabled, it picks up flagged as a discontinuity, and video waits for
+// a keyframe, as the frames before it were never decoded.
+static void TestStreamEnabled()
+{
+	OggTestFile file(300, 30);
+	DemuxFixture fixture(file);
+	OgvDemuxer &demuxer = fixture.demuxer;
+
+	demuxer.SetStreamEnabled(OggTestFile::VorbisSerial, false);
+	CHECK(!demuxer.IsStreamEnabled(OggTestFile::VorbisSerial));
+	CHECK(demuxer.IsStreamEnabled(OggTestFile::TheoraSerial));
+	std::vector<DemuxedSample> samples = fixture.Read(OggTestFile::TheoraSerial, 50);
+	bool videoOnly = true;
+	for (auto &demuxed : samples)
+	{
+		videoOnly = videoOnly && demuxed.serialno == OggTestFile::TheoraSerial;
+	}
+	CHECK(videoOnly);
+	CHECK(samples.size() == 50);
+
+	demuxer.SetStreamEnabled(OggTestFile::VorbisSerial, true);
+	demuxer.SetStreamEnabled(OggTestFile::TheoraSerial, false);
+	samples.clear();
+	while (demuxer.GetOffset() < file.FrameOffset(75))
+	{
+		std::vector<DemuxedSample> more = fixture.Read(OggTestFile::VorbisSerial, 1);
+		samples.insert(samples.end(), std::make_move_iterator(more.begin()), std::make_move_iterator(more.end()));
+	}
+	bool audioOnly = !samples.empty() && samples[0].sample.discontinuity;
+	for (auto &demuxed : samples)
+	{
+		audioOnly = audioOnly && demuxed.serialno == OggTestFile::VorbisSerial;
+	}
+	CHECK(audioOnly);
+
+	// Back on in the middle of the group that starts at frame 61.
+	demuxer.SetStreamEnabled(OggTestFile::TheoraSerial, true);
+	uint64_t thinnedBefore = demuxer.GetThinnedFrames();
+	std::vector<OgvSample> video = fixture.ReadVideo(2);
+	CHECK(video.size() == 2);
+	CHECK(!video.empty() && video[0].keyframe && video[0].discontinuity && video[0].time == FrameTicks(file, 91));
+	CHECK(video.size() > 1 && !video[1].keyframe && !video[1].discontinuity && video[1].time == FrameTicks(file, 92));
+	CHECK(demuxer.GetThinnedFrames() - thinnedBefore == 16);
+}
+
+// Thinned, only keyframes come out, the inter frames between them are
+// counted, and audio is untouched. Leaving thinned mode mid-group waits
+// for the next keyframe.
+static void TestThinning()
+{
+	OggTestFile file(300, 30);
+	size_t audio = 0;
+	{
+		DemuxFixture plain(file);
+		for (auto &demuxed : plain.Read(OggTestFile::TheoraSerial, file.GetFrames() + 1))
+		{
+			audio += demuxed.serialno == OggTestFile::VorbisSerial ? 1 : 0;
+		}
+	}
+
+	DemuxFixture thinned(file);
+	thinned.demuxer.SetThinning(true);
+	CHECK(thinned.demuxer.IsThinning());
+	std::vector<OgvSample> video;
+	size_t thinnedAudio = 0;
+	for (auto &demuxed : thinned.Read(OggTestFile::TheoraSerial, file.GetFrames() + 1))
+	{
+		if (demuxed.serialno == OggTestFile::TheoraSerial)
+		{
+			video.push_back(std::move(demuxed.sample));
+		}
+		else
+		{
+			thinnedAudio++;
+		}
+	}
+	CHECK(thinned.demuxer.IsEndOfStream());
+	CHECK(video.size() == 10);
+	bool keyframesOnly = true;
+	for (size_t i = 0; i < video.size(); i++)
+	{
+		keyframesOnly = keyframesOnly && video[i].keyframe && video[i].time == FrameTicks(file, static_cast<int>(i) * 30 + 1);
+	}
+	CHECK(keyframesOnly);
+	CHECK(thinned.demuxer.GetThinnedFrames() == 290);
+	CHECK(thinned.demuxer.GetSkippedFrames() == 0);
+	CHECK(thinnedAudio == audio);
+
+	DemuxFixture resumed(file);
+	OgvDemuxer &demuxer = resumed.demuxer;
+	demuxer.SetThinning(true);
+	while (demuxer.GetOffset() < file.FrameOffset(75))
+	{
+		resumed.Read(OggTestFile::VorbisSerial, 1);
+	}
+	uint64_t thinnedBefore = demuxer.GetThinnedFrames();
+	demuxer.SetThinning(false);
+	CHECK(!demuxer.IsThinning());
+	video = resumed.ReadVideo(2);
+	CHECK(video.size() == 2);
+	CHECK(!video.empty() && video[0].keyframe && video[0].time == FrameTicks(file, 91));
+	CHECK(video.size() > 1 && !video[1].keyframe && video[1].time == FrameTicks(file, 92));
+	CHECK(demuxer.GetThinnedFrames() > thinnedBefore);
+}
+
+int main()
+{
+	TestDemuxWholeFile();
+	TestSeekStartsOnKeyframe();
+	TestSeekMidGroupSkipsToKeyframe();
+	TestReadsAreNotRepeated();
+	TestInPlaceMatchesBuffered();
+	TestShortReadIsNotEndOfStream();
+	TestResyncAfterDamage();
+	TestStreamEnabled();
+	TestThinning();
+	return TEST_RESULT();
+}
@@ -0,0 +1,113 @@
+#include "OggTestFile.h"
+#include "OgvMappedFile.h"
+#include "OgvSeekIndex.h"
+#include "TestHarness.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Writes the test file out to a temporary file, removed again on destruction.
+struct TempFile
+{
+	std::string path;
+
+	explicit TempFile(const std::vector<uint8_t> &bytes)
+	{
+		char name[] = "/tmp/OgvMappedFileTestsXXXXXX";
+		int fd = mkstemp(name);
+		CHECK(fd >= 0);
+		path = name;
+		FILE *file = fdopen(fd, "wb");
+		CHECK(fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size());
+		fclose(file);
+	}
+
+	~TempFile()
+	{
+		unlink(path.c_str());
+	}
+};
+
+static bool ViewMatches(const OgvViewFunc &view, const std::vector<uint8_t> &bytes, uint64_t offset, size_t length)
+{
+	const uint8_t *data = nullptr;
+	size_t available = view(offset, length, data);
+	size_t expected = static_cast<size_t>(std::min<uint64_t>(length, bytes.size() - offset));
+	return available >= expected && memcmp(data, bytes.data() + offset, expected) == 0;
+}
+
+// Two minutes of the test file are bigger than one window, so reading it
+// through has to slide the window along, and going back has to map an
+// earlier one.
+static void TestViewMatchesFile()
+{
+	OggTestFile file(3600);
+	const std::vector<uint8_t> &bytes = file.GetBytes();
+	CHECK(bytes.size() > 8 * 1024 * 1024);
+	TempFile temp(bytes);
+
+	OgvMappedFile mapped;
+	CHECK(mapped.Open(temp.path));
+	CHECK(mapped.GetLength() == bytes.size());
+
+	OgvViewFunc view = mapped.CreateView();
+	CHECK(ViewMatches(view, bytes, 0, 100));
+	CHECK(ViewMatches(view, bytes, 8 * 1024 * 1024 - 10, 100));
+	CHECK(ViewMatches(view, bytes, 12345, 70000));
+	CHECK(ViewMatches(view, bytes, bytes.size() - 50, 100));
+
+	const uint8_t *data = nullptr;
+	CHECK(view(bytes.size() - 50, 100, data) == 50);
+	CHECK(view(bytes.size(), 1, data) == 0);
+
+	// A view keeps the file mapped after it is closed.
+	mapped.Close();
+	CHECK(!mapped.IsOpen());
+	CHECK(ViewMatches(view, bytes, 4096, 4096));
+}
+
+// Parsing in place finds what reading does, without issuing any reads.
+static void TestSeekIndexInPlace()
+{
+	OggTestFile file;
+	TempFile temp(file.GetBytes());
+	OgvMappedFile mapped;
+	CHECK(mapped.Open(temp.path));
+
+	OgvSeekIndex read, inPlace;
+	CHECK(read.Open(file.ReadFunc(), file.GetLength()));
+	CHECK(inPlace.Open(file.ReadFunc(), mapped.GetLength(), mapped.CreateView()));
+	CHECK(inPlace.GetDataOffset() == read.GetDataOffset());
+
+	const double times[] = { 0.5, 10.0, 55.0, 99.0 };
+	for (double time : times)
+	{
+		OgvSeekTarget expected, actual;
+		CHECK(read.Seek(time, expected));
+		CHECK(inPlace.Seek(time, actual));
+		CHECK(actual.offset == expected.offset && actual.keyframeGranule == expected.keyframeGranule);
+	}
+	CHECK(inPlace.GetReadCount() == 0);
+}
+
+static void TestOpenFails()
+{
+	OgvMappedFile mapped;
+	CHECK(!mapped.Open("/nonexistent/file.ogv"));
+	CHECK(!mapped.Open("/tmp"));
+	CHECK(!mapped.IsOpen());
+	CHECK(!mapped.CreateView());
+}
+
+int main()
+{
+	TestViewMatchesFile();
+	TestSeekIndexInPlace();
+	TestOpenFails();
+	return TEST_RESULT();
+}
@@ -0,0 +1,271 @@
+#include "OgvOpScheduler.h"
+#include "TestHarness.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+enum TestOp
+{
+	OP_BLOCK,
+	OP_RATE,
+	OP_REQUEST
+};
+
+// Holds the scheduler's thread inside an op until released, so that ops
+// posted meanwhile are all still queued.
+struct Gate
+{
+	std::mutex mutex;
+	std::condition_variable changed;
+	bool entered;
+	bool open;
+
+	Gate() : entered(false), open(false) {}
+
+	void Block()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		entered = true;
+		changed.notify_all();
+		changed.wait(lock, [this] { return open; });
+	}
+
+	void WaitEntered()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [this] { return entered; });
+	}
+
+	void Open()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		open = true;
+		changed.notify_all();
+	}
+};
+
+static void WaitCompleted(OgvOpScheduler &scheduler, int type, uint64_t count)
+{
+	while (scheduler.GetStats(type).completed < count)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+// Ops that aren't coalesced all run, in order, even when queued back to back.
+static void TestUncoalescedOpsAllRun()
+{
+	OgvOpScheduler scheduler;
+	Gate gate;
+	std::vector<int> ran;
+
+	scheduler.Post(OP_BLOCK, [&gate] { gate.Block(); });
+	gate.WaitEntered();
+	for (int i = 0; i < 5; i++)
+	{
+		CHECK(scheduler.Post(OP_RATE, [&ran, i] { ran.push_back(i); }));
+	}
+	gate.Open();
+	WaitCompleted(scheduler, OP_RATE, 5);
+
+	CHECK(ran.size() == 5);
+	for (size_t i = 0; i < ran.size(); i++)
+	{
+		CHECK(ran[i] == static_cast<int>(i));
+	}
+	CHECK(scheduler.GetStats(OP_RATE).coalesced == 0);
+}
+
+static void TestCoalescedOpsCollapse()
+{
+	OgvOpScheduler scheduler;
+	Gate gate;
+	std::atomic<int> requests(0);
+
+	scheduler.Post(OP_BLOCK, [&gate] { gate.Block(); });
+	gate.WaitEntered();
+	for (int i = 0; i < 5; i++)
+	{
+		CHECK(scheduler.Post(OP_REQUEST, [&requests] { requests++; }, true));
+	}
+	gate.Open();
+	WaitCompleted(scheduler, OP_REQUEST, 1);
+	scheduler.Shutdown();
+
+	CHECK(requests == 1);
+	CHECK(scheduler.GetStats(OP_REQUEST).posted == 5);
+	CHECK(scheduler.GetStats(OP_REQUEST).coalesced == 4);
+}
+
+static void TestShutdown()
+{
+	OgvOpScheduler scheduler;
+	Gate gate;
+	std::atomic<int> ran(0);
+
+	scheduler.Post(OP_BLOCK, [&gate] { gate.Block(); });
+	gate.WaitEntered();
+	scheduler.Post(OP_RATE, [&ran] { ran++; });
+
+	std::thread opener([&gate] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		gate.Open();
+	});
+	scheduler.Shutdown();
+	opener.join();
+
+	CHECK(scheduler.IsShutdown());
+	CHECK(!scheduler.Post(OP_RATE, [&ran] { ran++; }));
+	CHECK(ran == 0);
+	CHECK(scheduler.GetStats(OP_RATE).cancelled == 1);
+}
+
+// Several threads post a mix of coalesced and uncoalesced ops, some of
+// which throw. The ops must never run at once, and every post must be
+// accounted for exactly once.
+struct Stress
+{
+	static const int Threads = 4;
+	static const int PostsPerThread = 2000;
+
+	OgvOpScheduler scheduler;
+	std::atomic<int> running;
+	std::atomic<bool> overlapped;
+	std::atomic<bool> ranAfterShutdown;
+	std::atomic<bool> shutdownReturned;
+
+	Stress() : running(0), overlapped(false), ranAfterShutdown(false), shutdownReturned(false) {}
+
+	void RunOp()
+	{
+		ranAfterShutdown = ranAfterShutdown || shutdownReturned;
+		overlapped = overlapped || running.fetch_add(1) != 0;
+		std::this_thread::yield();
+		running--;
+	}
+
+	void Post(int thread)
+	{
+		for (int i = 0; i < PostsPerThread; i++)
+		{
+			bool posted;
+			if (i % 3 == 0)
+			{
+				posted = scheduler.Post(OP_RATE, [this, i] {
+					RunOp();
+					if (i % 7 == 0)
+					{
+						throw std::runtime_error("failed");
+					}
+				});
+			}
+			else
+			{
+				posted = scheduler.Post(OP_REQUEST, [this] { RunOp(); }, true);
+			}
+			if (!posted)
+			{
+				return;
+			}
+			if ((i + thread) % 64 == 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	bool Balanced(int type) const
+	{
+		OgvOpStats stats = scheduler.GetStats(type);
+		return stats.posted == stats.completed + stats.coalesced + stats.cancelled;
+	}
+};
+
+static void TestConcurrentPosts()
+{
+	Stress stress;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < Stress::Threads; t++)
+	{
+		threads.push_back(std::thread([&stress, t] { stress.Post(t); }));
+	}
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+	while (stress.scheduler.GetPendingOps() > 0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	stress.scheduler.Shutdown();
+
+	CHECK(!stress.overlapped);
+	OgvOpStats rates = stress.scheduler.GetStats(OP_RATE);
+	CHECK(rates.posted == static_cast<uint64_t>(Stress::Threads * ((Stress::PostsPerThread + 2) / 3)));
+	CHECK(rates.coalesced == 0 && rates.cancelled == 0);
+	CHECK(rates.failed == static_cast<uint64_t>(Stress::Threads * ((Stress::PostsPerThread + 20) / 21)));
+	CHECK(stress.Balanced(OP_RATE));
+	CHECK(stress.Balanced(OP_REQUEST));
+}
+
+// Shutting down while the posts are still coming in cancels what's queued,
+// refuses the rest, and runs nothing afterwards.
+static void TestShutdownUnderLoad()
+{
+	Stress stress;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < Stress::Threads; t++)
+	{
+		threads.push_back(std::thread([&stress, t] { stress.Post(t); }));
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	stress.scheduler.Shutdown();
+	stress.shutdownReturned = true;
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	CHECK(!stress.overlapped);
+	CHECK(!stress.ranAfterShutdown);
+	CHECK(stress.scheduler.GetPendingOps() == 0);
+	CHECK(stress.Balanced(OP_RATE));
+	CHECK(stress.Balanced(OP_REQUEST));
+}
+
+static void TestPercentile()
+{
+	OgvOpStats stats;
+	memset(&stats, 0, sizeof(stats));
+	CHECK(stats.Percentile(0.5) == 0);
+
+	stats.latency[0] = 50;
+	stats.latency[3] = 40;
+	stats.latency[10] = 9;
+	stats.latency[OgvOpLatencyBuckets - 1] = 1;
+	stats.maxLatencyMicros = 50000000;
+	CHECK(stats.Percentile(0.0) == 2);
+	CHECK(stats.Percentile(0.5) == 2);
+	CHECK(stats.Percentile(0.51) == 16);
+	CHECK(stats.Percentile(0.9) == 16);
+	CHECK(stats.Percentile(0.99) == 2048);
+	// The last bucket is open-ended; the worst seen stands in for its bound.
+	CHECK(stats.Percentile(1.0) == 50000000);
+}
+
+int main()
+{
+	TestUncoalescedOpsAllRun();
+	TestCoalescedOpsCollapse();
+	TestShutdown();
+	TestConcurrentPosts();
+	TestShutdownUnderLoad();
+	TestPercentile();
+	return TEST_RESULT();
+}
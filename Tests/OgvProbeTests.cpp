@@ -0,0 +1,74 @@
+#include "OggTestFile.h"
+#include "OgvProbe.h"
+#include "TestHarness.h"
+
+#include <cmath>
+#include <memory>
+
+static std::shared_ptr<OgvByteSource> SourceFor(const OggTestFile &file)
+{
+	return std::make_shared<OgvMemoryByteSource>(file.GetBytes());
+}
+
+static void TestMetadata()
+{
+	OggTestFile file;
+	OgvMediaInfo info;
+	CHECK(OgvProbe(SourceFor(file), info));
+
+	CHECK(info.hasVideo);
+	CHECK(info.width == 320 && info.height == 240);
+	CHECK(info.frameRate == OggTestFile::FramesPerSecond);
+	CHECK(info.keyframeIntervalLimit == 1u << OggTestFile::KeyframeShift);
+	CHECK(info.hasAudio);
+	CHECK(info.sampleRate == OggTestFile::SampleRate);
+	CHECK(info.channels == 2);
+	CHECK(fabs(info.duration - file.GetFrames() / static_cast<double>(OggTestFile::FramesPerSecond)) < 0.05);
+	CHECK(!info.hasSkeletonIndex);
+
+	// The tail pages only show part of the last keyframe interval.
+	CHECK(info.keyframeInterval > 0 && info.keyframeInterval <= 45);
+
+	// A read for the headers and one for the end, whatever the length.
+	CHECK(info.reads <= 4);
+	CHECK(info.bytesRead < file.GetLength() / 20);
+}
+
+// With a Skeleton index every keyframe is known.
+static void TestKeyframeIntervalFromIndex()
+{
+	OggTestFile file(3000, 45, false, true, true);
+	OgvMediaInfo info;
+	CHECK(OgvProbe(SourceFor(file), info));
+	CHECK(info.hasSkeletonIndex);
+	CHECK(info.keyframeInterval == 45);
+}
+
+static void TestVideoOnly()
+{
+	OggTestFile file(300, 30, false, false);
+	OgvMediaInfo info;
+	CHECK(OgvProbe(SourceFor(file), info));
+	CHECK(info.hasVideo && !info.hasAudio);
+	CHECK(info.sampleRate == 0 && info.channels == 0);
+	CHECK(fabs(info.duration - 10.0) < 0.05);
+	CHECK(info.keyframeInterval == 30);
+}
+
+static void TestNotOgg()
+{
+	std::vector<uint8_t> noise(100000, 0x5a);
+	OgvMediaInfo info;
+	CHECK(!OgvProbe(std::make_shared<OgvMemoryByteSource>(noise), info));
+	CHECK(!info.hasVideo && !info.hasAudio);
+	CHECK(info.reads > 0);
+}
+
+int main()
+{
+	TestMetadata();
+	TestKeyframeIntervalFromIndex();
+	TestVideoOnly();
+	TestNotOgg();
+	return TEST_RESULT();
+}
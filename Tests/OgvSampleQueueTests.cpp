@@ -0,0 +1,216 @@
+#include "OgvSampleQueue.h"
+#include "TestHarness.h"
+
+#include <vector>
+
+static OgvSample MakeSample(int64_t time)
+{
+	OgvSample sample;
+	sample.time = time;
+	sample.data.assign(4, static_cast<uint8_t>(time));
+	return sample;
+}
+
+static OgvSampleToken MakeToken(int id)
+{
+	return std::make_shared<int>(id);
+}
+
+static int TokenId(const OgvSampleToken &token)
+{
+	return *static_cast<int *>(token.get());
+}
+
+struct Delivery
+{
+	int64_t time;
+	int token;
+};
+
+// Collects what a Dispatch hands out.
+struct Sink
+{
+	std::vector<Delivery> delivered;
+	int ends;
+
+	Sink() : ends(0) {}
+
+	void Dispatch(OgvSampleQueue &queue)
+	{
+		queue.Dispatch([this](OgvSample &sample, const OgvSampleToken &token) {
+			Delivery delivery;
+			delivery.time = sample.time;
+			delivery.token = TokenId(token);
+			delivered.push_back(delivery);
+		}, [this] {
+			ends++;
+		});
+	}
+};
+
+// Samples go to requests one for one, both in the order they arrived, and
+// only as many as there are requests.
+static void TestRequestsPairInOrder()
+{
+	OgvSampleQueue queue;
+	Sink sink;
+	for (int i = 0; i < 5; i++)
+	{
+		queue.Push(MakeSample(i));
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		CHECK(queue.Request(MakeToken(100 + i)));
+	}
+	sink.Dispatch(queue);
+
+	CHECK(sink.delivered.size() == 3);
+	for (size_t i = 0; i < sink.delivered.size(); i++)
+	{
+		CHECK(sink.delivered[i].time == static_cast<int64_t>(i));
+		CHECK(sink.delivered[i].token == 100 + static_cast<int>(i));
+	}
+	CHECK(queue.GetQueuedSamples() == 2);
+	CHECK(queue.GetPendingRequests() == 0);
+
+	// Requests with nothing queued wait for the next push.
+	queue.Request(MakeToken(200));
+	queue.Request(MakeToken(201));
+	queue.Request(MakeToken(202));
+	sink.Dispatch(queue);
+	CHECK(sink.delivered.size() == 5);
+	CHECK(queue.GetPendingRequests() == 1);
+	queue.Push(MakeSample(5));
+	sink.Dispatch(queue);
+	CHECK(sink.delivered.size() == 6);
+	CHECK(sink.delivered.back().time == 5 && sink.delivered.back().token == 202);
+	CHECK(sink.ends == 0);
+}
+
+// The demuxer keeps the preroll depth queued beyond what's been asked for.
+static void TestPrerollDepth()
+{
+	OgvSampleQueue queue(3);
+	CHECK(queue.NeedsData());
+	CHECK(!queue.IsPrerolled());
+
+	for (int i = 0; i < 3; i++)
+	{
+		queue.Push(MakeSample(i));
+	}
+	CHECK(!queue.NeedsData());
+	CHECK(queue.IsPrerolled());
+
+	// An outstanding request raises the mark by one.
+	queue.Request(MakeToken(1));
+	CHECK(queue.NeedsData());
+	queue.Push(MakeSample(3));
+	CHECK(!queue.NeedsData());
+
+	// A short stream is prerolled as soon as it ends.
+	OgvSampleQueue shortQueue(3);
+	shortQueue.Push(MakeSample(0));
+	CHECK(!shortQueue.IsPrerolled());
+	shortQueue.EndOfStream();
+	CHECK(shortQueue.IsPrerolled());
+	CHECK(!shortQueue.NeedsData());
+
+	queue.SetPrerollDepth(0);
+	CHECK(queue.GetPrerollDepth() == 1);
+}
+
+// The end of stream is signalled once, to the first request that finds the
+// queue empty after the last sample has gone out.
+static void TestEndOfStreamOnceDrained()
+{
+	OgvSampleQueue queue;
+	Sink sink;
+	queue.Push(MakeSample(0));
+	queue.Push(MakeSample(1));
+	queue.EndOfStream();
+
+	// Nothing arriving after the end is kept.
+	queue.Push(MakeSample(2));
+	CHECK(queue.GetQueuedSamples() == 2);
+
+	queue.Request(MakeToken(1));
+	queue.Request(MakeToken(2));
+	sink.Dispatch(queue);
+	CHECK(sink.delivered.size() == 2);
+	CHECK(sink.ends == 0);
+	CHECK(!queue.IsEnded());
+
+	queue.Request(MakeToken(3));
+	queue.Request(MakeToken(4));
+	sink.Dispatch(queue);
+	sink.Dispatch(queue);
+	CHECK(sink.ends == 1);
+	CHECK(queue.IsEnded());
+	CHECK(queue.GetPendingRequests() == 0);
+
+	// Once ended, further requests are refused.
+	CHECK(!queue.Request(MakeToken(5)));
+	sink.Dispatch(queue);
+	CHECK(sink.ends == 1);
+}
+
+// A flush for a seek throws away queued samples and the end of stream, but
+// keeps the requests for the samples from the new position.
+static void TestFlushKeepsRequests()
+{
+	OgvSampleQueue queue;
+	Sink sink;
+	queue.Push(MakeSample(0));
+	queue.Push(MakeSample(1));
+	queue.EndOfStream();
+	queue.Request(MakeToken(1));
+	queue.Request(MakeToken(2));
+	queue.Flush();
+	CHECK(queue.GetQueuedSamples() == 0);
+	CHECK(queue.GetPendingRequests() == 2);
+	CHECK(queue.NeedsData());
+	CHECK(!queue.IsPrerolled());
+
+	queue.Push(MakeSample(10));
+	queue.Push(MakeSample(11));
+	sink.Dispatch(queue);
+	CHECK(sink.delivered.size() == 2);
+	CHECK(sink.delivered[0].time == 10 && sink.delivered[0].token == 1);
+	CHECK(sink.delivered[1].time == 11 && sink.delivered[1].token == 2);
+	CHECK(sink.ends == 0);
+
+	// An ended stream takes requests again after a flush.
+	queue.EndOfStream();
+	queue.Request(MakeToken(3));
+	sink.Dispatch(queue);
+	CHECK(queue.IsEnded());
+	queue.Flush();
+	CHECK(queue.Request(MakeToken(4)));
+}
+
+// Clearing for a stop lets go of the requests too.
+static void TestClearDropsRequests()
+{
+	OgvSampleQueue queue;
+	std::weak_ptr<void> dropped;
+	{
+		OgvSampleToken token = MakeToken(1);
+		dropped = token;
+		queue.Request(token);
+	}
+	queue.Push(MakeSample(0));
+	queue.Clear();
+	CHECK(dropped.expired());
+	CHECK(queue.GetPendingRequests() == 0);
+	CHECK(queue.GetQueuedSamples() == 0);
+}
+
+int main()
+{
+	TestRequestsPairInOrder();
+	TestPrerollDepth();
+	TestEndOfStreamOnceDrained();
+	TestFlushKeepsRequests();
+	TestClearDropsRequests();
+	return TEST_RESULT();
+}
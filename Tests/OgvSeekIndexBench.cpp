@@ -0,0 +1,71 @@
+#include "OggTestFile.h"
+#include "OgvSeekIndex.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const int Seeks = 200;
+
+struct SeekCost
+{
+	double reads;
+	double micros;
+};
+
+// Seeks to random times. Cold seeks each get a freshly opened index, as the
+// first seek after opening a file does; warm ones share one, so each starts
+// from what the seeks before it learned.
+static SeekCost MeasureSeeks(const OggTestFile &file, bool cold)
+{
+	std::minstd_rand random(1);
+	std::uniform_real_distribution<double> times(0.0, file.FrameTime(file.GetFrames()));
+
+	OgvSeekIndex index;
+	uint64_t reads = 0;
+	double seconds = 0.0;
+	for (int i = 0; i < Seeks; i++)
+	{
+		if (cold || i == 0)
+		{
+			index.Open(file.ReadFunc(), file.GetLength());
+		}
+		double time = times(random);
+		uint64_t before = index.GetReadCount();
+		Clock::time_point start = Clock::now();
+		OgvSeekTarget target;
+		index.Seek(time, target);
+		seconds += std::chrono::duration<double>(Clock::now() - start).count();
+		reads += index.GetReadCount() - before;
+	}
+
+	SeekCost cost;
+	cost.reads = static_cast<double>(reads) / Seeks;
+	cost.micros = seconds * 1e6 / Seeks;
+	return cost;
+}
+
+int main()
+{
+	// From half a minute to a quarter of an hour of 30 fps video.
+	const int frameCounts[] = { 900, 3600, 14400, 27000 };
+
+	printf("%8s %9s  %22s  %22s  %22s\n", "", "", "cold", "warm", "skeleton index");
+	printf("%8s %9s  %10s %11s  %10s %11s  %10s %11s\n", "frames", "MB",
+		"reads", "us/seek", "reads", "us/seek", "reads", "us/seek");
+	for (int frames : frameCounts)
+	{
+		OggTestFile file(frames);
+		OggTestFile indexed(frames, 45, false, true, true);
+		SeekCost cold = MeasureSeeks(file, true);
+		SeekCost warm = MeasureSeeks(file, false);
+		SeekCost skeleton = MeasureSeeks(indexed, true);
+		printf("%8d %9.1f  %10.2f %11.2f  %10.2f %11.2f  %10.2f %11.2f\n",
+			frames, file.GetLength() / (1024.0 * 1024.0),
+			cold.reads, cold.micros, warm.reads, warm.micros, skeleton.reads, skeleton.micros);
+	}
+	return 0;
+}
@@ -0,0 +1,109 @@
+#include "OggTestFile.h"
+#include "OgvDemuxer.h"
+#include "OgvSeekIndex.h"
+#include "OgvSeekIndexCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Clips in the playlist, opened once each and then all again.
+static const int Clips = 8;
+// Round trip charged per read, as to a server some way off.
+static const int LatencyMs = 30;
+
+struct OpenCost
+{
+	uint64_t reads;
+	double micros;
+};
+
+// Opens a clip the way OgvSource does: headers, a cache lookup, the
+// duration, and a seek to where playback was left off, halfway in.
+// Stores what the index learned on the way out.
+static OpenCost Open(const OggTestFile &file, OgvSeekIndexCache &cache)
+{
+	OgvReadFunc fileRead = file.ReadFunc();
+	uint64_t reads = 0;
+	OgvReadFunc read = [&fileRead, &reads](uint64_t offset, uint8_t *buffer, size_t length) {
+		reads++;
+		return fileRead(offset, buffer, length);
+	};
+
+	Clock::time_point start = Clock::now();
+	OgvSeekIndex index;
+	OgvDemuxer demuxer;
+	index.Open(read, file.GetLength());
+	demuxer.Open(read, file.GetLength(), index.GetStreams());
+	demuxer.ReadHeaders(index.GetDataOffset());
+
+	std::vector<const std::vector<std::vector<uint8_t>> *> headers;
+	for (auto &stream : index.GetStreams())
+	{
+		headers.push_back(&demuxer.GetHeaders(stream.serialno));
+	}
+	OgvSeekIndexCache::Key key = OgvSeekIndexCache::MakeKey(index.GetLength(), headers);
+	std::vector<uint8_t> serialized;
+	if (cache.Lookup(key, serialized))
+	{
+		index.Deserialize(serialized.data(), serialized.size());
+	}
+
+	double duration = index.GetDuration();
+	OgvSeekTarget target;
+	index.Seek(duration / 2, target);
+
+	OpenCost cost;
+	cost.micros = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	cost.reads = reads;
+
+	index.Serialize(serialized);
+	cache.Store(key, serialized);
+	return cost;
+}
+
+int main()
+{
+	// Clips of different lengths, so each gets its own cache entry.
+	std::vector<std::unique_ptr<OggTestFile>> files;
+	for (int i = 0; i < Clips; i++)
+	{
+		files.emplace_back(new OggTestFile(900 + 450 * i));
+	}
+
+	OgvSeekIndexCache cache(1024 * 1024);
+	printf("%d clips, %d ms round trip per read\n\n", Clips, LatencyMs);
+	printf("%6s %9s  %27s  %27s\n", "", "", "cold", "warm");
+	printf("%6s %9s  %6s %9s %10s  %6s %9s %10s\n", "clip", "seconds",
+		"reads", "us", "ms remote", "reads", "us", "ms remote");
+
+	std::vector<OpenCost> cold;
+	for (auto &file : files)
+	{
+		cold.push_back(Open(*file, cache));
+	}
+	OpenCost coldTotal = {}, warmTotal = {};
+	for (int i = 0; i < Clips; i++)
+	{
+		OpenCost warm = Open(*files[i], cache);
+		printf("%6d %9.1f  %6llu %9.1f %10d  %6llu %9.1f %10d\n", i, files[i]->FrameTime(files[i]->GetFrames()),
+			static_cast<unsigned long long>(cold[i].reads), cold[i].micros, static_cast<int>(cold[i].reads) * LatencyMs,
+			static_cast<unsigned long long>(warm.reads), warm.micros, static_cast<int>(warm.reads) * LatencyMs);
+		coldTotal.reads += cold[i].reads;
+		coldTotal.micros += cold[i].micros;
+		warmTotal.reads += warm.reads;
+		warmTotal.micros += warm.micros;
+	}
+	printf("%6s %9s  %6llu %9.1f %10d  %6llu %9.1f %10d\n", "total", "",
+		static_cast<unsigned long long>(coldTotal.reads), coldTotal.micros, static_cast<int>(coldTotal.reads) * LatencyMs,
+		static_cast<unsigned long long>(warmTotal.reads), warmTotal.micros, static_cast<int>(warmTotal.reads) * LatencyMs);
+
+	OgvSeekIndexCacheStats stats = cache.GetStats();
+	printf("\ncache: %llu hits, %llu misses, %llu entries, %llu bytes\n",
+		static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses),
+		static_cast<unsigned long long>(stats.entries), static_cast<unsigned long long>(stats.bytes));
+	return 0;
+}
@@ -0,0 +1,139 @@
+#include "OggTestFile.h"
+#include "OgvDemuxer.h"
+#include "OgvSeekIndex.h"
+#include "OgvSeekIndexCache.h"
+#include "TestHarness.h"
+
+#include <vector>
+
+typedef std::vector<std::vector<uint8_t>> Headers;
+
+static OgvSeekIndexCache::Key KeyFor(uint64_t length, const Headers &theora, const Headers &vorbis)
+{
+	std::vector<const Headers *> headers;
+	headers.push_back(&theora);
+	headers.push_back(&vorbis);
+	return OgvSeekIndexCache::MakeKey(length, headers);
+}
+
+static void TestKeys()
+{
+	Headers theora(3, std::vector<uint8_t>(40, 0x80));
+	Headers vorbis(3, std::vector<uint8_t>(30, 0x01));
+	OgvSeekIndexCache::Key key = KeyFor(1000, theora, vorbis);
+	CHECK(KeyFor(1000, theora, vorbis) == key);
+	CHECK(KeyFor(1001, theora, vorbis) != key);
+	CHECK(KeyFor(1000, vorbis, theora) != key);
+
+	Headers changed = theora;
+	changed[2][39] ^= 1;
+	CHECK(KeyFor(1000, changed, vorbis) != key);
+
+	// Where one packet ends and the next begins counts too.
+	Headers moved = theora;
+	moved[1].push_back(moved[2].back());
+	moved[2].pop_back();
+	CHECK(KeyFor(1000, moved, vorbis) != key);
+
+	CHECK(&OgvSeekIndexCache::Shared() == &OgvSeekIndexCache::Shared());
+}
+
+static void TestLookupAndEviction()
+{
+	OgvSeekIndexCache cache(1000);
+	std::vector<uint8_t> serialized;
+	CHECK(!cache.Lookup(1, serialized));
+
+	cache.Store(1, std::vector<uint8_t>(400, 1));
+	cache.Store(2, std::vector<uint8_t>(400, 2));
+	CHECK(cache.Lookup(1, serialized) && serialized == std::vector<uint8_t>(400, 1));
+
+	// 2 is now the least recently used, so it makes way.
+	cache.Store(3, std::vector<uint8_t>(400, 3));
+	CHECK(!cache.Lookup(2, serialized));
+	CHECK(cache.Lookup(1, serialized));
+	CHECK(cache.Lookup(3, serialized) && serialized == std::vector<uint8_t>(400, 3));
+
+	// Storing again replaces, rather than adding to the total.
+	cache.Store(3, std::vector<uint8_t>(500, 4));
+	CHECK(cache.Lookup(3, serialized) && serialized == std::vector<uint8_t>(500, 4));
+
+	// Too big to keep at all.
+	cache.Store(5, std::vector<uint8_t>(1001, 5));
+	CHECK(!cache.Lookup(5, serialized));
+
+	OgvSeekIndexCacheStats stats = cache.GetStats();
+	CHECK(stats.entries == 2);
+	CHECK(stats.bytes == 900);
+	CHECK(stats.evictions == 1);
+	CHECK(stats.hits == 4);
+	CHECK(stats.misses == 3);
+}
+
+// Opens a test file as OgvSource does, keying it by its header packets.
+struct OpenedFile
+{
+	OgvSeekIndex index;
+	OgvDemuxer demuxer;
+	OgvSeekIndexCache::Key key;
+
+	explicit OpenedFile(const OggTestFile &file)
+	{
+		CHECK(index.Open(file.ReadFunc(), file.GetLength()));
+		demuxer.Open(file.ReadFunc(), file.GetLength(), index.GetStreams());
+		CHECK(demuxer.ReadHeaders(index.GetDataOffset()));
+		key = KeyFor(index.GetLength(), demuxer.GetHeaders(OggTestFile::TheoraSerial), demuxer.GetHeaders(OggTestFile::VorbisSerial));
+	}
+};
+
+// A second open of the same file finds the first one's seek points, and
+// seeks through them with fewer reads.
+static void TestReopenUsesCachedIndex()
+{
+	OggTestFile file;
+	OgvSeekIndexCache cache(64 * 1024);
+	const double times[] = { 12.0, 47.5, 80.0, 3.3 };
+
+	OpenedFile first(file);
+	uint64_t openReads = first.index.GetReadCount();
+	for (double time : times)
+	{
+		OgvSeekTarget target;
+		CHECK(first.index.Seek(time, target));
+	}
+	uint64_t firstReads = first.index.GetReadCount() - openReads;
+	std::vector<uint8_t> serialized;
+	first.index.Serialize(serialized);
+	cache.Store(first.key, serialized);
+
+	OpenedFile second(file);
+	CHECK(second.key == first.key);
+	std::vector<uint8_t> cached;
+	CHECK(cache.Lookup(second.key, cached));
+	CHECK(second.index.Deserialize(cached.data(), cached.size()));
+
+	uint64_t readsBefore = second.index.GetReadCount();
+	bool sameTargets = true;
+	for (double time : times)
+	{
+		OgvSeekTarget a, b;
+		CHECK(first.index.Seek(time, a));
+		CHECK(second.index.Seek(time, b));
+		sameTargets = sameTargets && a.offset == b.offset && a.keyframeGranule == b.keyframeGranule;
+	}
+	CHECK(sameTargets);
+	CHECK(second.index.GetReadCount() - readsBefore < firstReads);
+
+	// A different file doesn't pick it up.
+	OpenedFile other(OggTestFile(600));
+	CHECK(other.key != first.key);
+	CHECK(!cache.Lookup(other.key, cached));
+}
+
+int main()
+{
+	TestKeys();
+	TestLookupAndEviction();
+	TestReopenUsesCachedIndex();
+	return TEST_RESULT();
+}
@@ -0,0 +1,172 @@
+#include "OggTestFile.h"
+#include "OgvSeekIndex.h"
+#include "TestHarness.h"
+
+#include <cmath>
+#include <cstring>
+
+static const double SeekTimes[] = { 0.0, 0.5, 1.49, 1.5, 10.0, 10.1, 33.3, 55.0, 99.0 };
+
+// The target must start at or before the page the keyframe's packet begins
+// on, and not much earlier: audio may pull it back a page or two.
+static bool CheckSeek(OgvSeekIndex &index, const OggTestFile &file, double time, int slackFrames = 2)
+{
+	OgvSeekTarget target;
+	if (!index.Seek(time, target))
+	{
+		return false;
+	}
+	int key = file.KeyframeFor(file.FrameAt(time));
+	if (key == 1)
+	{
+		return target.offset == index.GetDataOffset() && target.keyframeTime == 0.0;
+	}
+	bool offsetOk = target.offset <= file.FrameOffset(key) && target.offset >= file.FrameOffset(key - slackFrames);
+	bool timeOk = fabs(target.keyframeTime - file.FrameTime(key)) < 1e-9;
+	bool granuleOk = target.keyframeGranule == static_cast<int64_t>(key) << OggTestFile::KeyframeShift;
+	return offsetOk && timeOk && granuleOk;
+}
+
+static void TestOpen()
+{
+	OggTestFile file;
+	OgvSeekIndex index;
+	CHECK(index.Open(file.ReadFunc(), file.GetLength()));
+	CHECK(index.GetStreams().size() == 2);
+	CHECK(index.GetDataOffset() == file.FrameOffset(1));
+	CHECK(!index.HasSkeletonIndex());
+	CHECK(fabs(index.GetDuration() - file.FrameTime(file.GetFrames())) < 0.05);
+}
+
+static void TestSeek()
+{
+	OggTestFile file;
+	OgvSeekIndex index;
+	CHECK(index.Open(file.ReadFunc(), file.GetLength()));
+	for (double time : SeekTimes)
+	{
+		CHECK(CheckSeek(index, file, time));
+	}
+}
+
+// A keyframe packet that starts on the page before its own must not be cut.
+// Without audio there's nothing else to pull the target back over it.
+static void TestSeekToSplitKeyframe()
+{
+	OggTestFile file(3000, 45, true, false);
+	OgvSeekIndex index;
+	CHECK(index.Open(file.ReadFunc(), file.GetLength()));
+	for (double time : SeekTimes)
+	{
+		CHECK(CheckSeek(index, file, time, 1));
+	}
+	// Again, now the keyframe offsets are cached.
+	for (double time : SeekTimes)
+	{
+		CHECK(CheckSeek(index, file, time, 1));
+	}
+}
+
+// Later seeks reuse what earlier ones learned.
+static void TestSeeksGetCheaper()
+{
+	OggTestFile file;
+	OgvSeekIndex index;
+	CHECK(index.Open(file.ReadFunc(), file.GetLength()));
+
+	OgvSeekTarget target;
+	uint64_t before = index.GetReadCount();
+	CHECK(index.Seek(42.0, target));
+	uint64_t firstReads = index.GetReadCount() - before;
+
+	before = index.GetReadCount();
+	CHECK(index.Seek(42.0, target));
+	CHECK(index.GetReadCount() - before < firstReads);
+}
+
+// With a Skeleton index, seeking goes straight to the keypoint before the
+// target without reading anything.
+static void TestSeekWithSkeletonIndex()
+{
+	OggTestFile file(3000, 45, false, true, true);
+	OgvSeekIndex index;
+	CHECK(index.Open(file.ReadFunc(), file.GetLength()));
+	CHECK(index.HasSkeletonIndex());
+	CHECK(index.GetStreams().size() == 3);
+	CHECK(index.GetDataOffset() == file.FrameOffset(1));
+
+	for (auto &stream : index.GetStreams())
+	{
+		if (stream.serialno == OggTestFile::TheoraSerial)
+		{
+			CHECK(stream.keypoints.size() == 67);
+			CHECK(stream.keypoints.back().offset == file.FrameOffset(2971));
+		}
+	}
+
+	uint64_t before = index.GetReadCount();
+	for (double time : SeekTimes)
+	{
+		OgvSeekTarget target;
+		CHECK(index.Seek(time, target));
+		int key = file.KeyframeFor(file.FrameAt(time));
+		CHECK(target.offset == file.FrameOffset(key));
+		CHECK(fabs(target.keyframeTime - file.FrameTime(key)) < 1e-9);
+	}
+	CHECK(index.GetReadCount() == before);
+}
+
+static void TestSerializeRoundTrip()
+{
+	OggTestFile file;
+	OgvSeekIndex index;
+	CHECK(index.Open(file.ReadFunc(), file.GetLength()));
+	for (double time : SeekTimes)
+	{
+		OgvSeekTarget target;
+		index.Seek(time, target);
+	}
+	index.GetDuration();
+
+	std::vector<uint8_t> state;
+	index.Serialize(state);
+	CHECK(state.size() > 8 && memcmp(state.data(), "OGVIDX02", 8) == 0);
+
+	OgvSeekIndex fresh;
+	CHECK(fresh.Open(file.ReadFunc(), file.GetLength()));
+	OgvSeekIndex restored;
+	CHECK(restored.Open(file.ReadFunc(), file.GetLength()));
+	CHECK(restored.Deserialize(state.data(), state.size()));
+
+	uint64_t freshBefore = fresh.GetReadCount();
+	uint64_t restoredBefore = restored.GetReadCount();
+	CHECK(fabs(restored.GetDuration() - index.GetDuration()) < 1e-6);
+	for (double time : SeekTimes)
+	{
+		OgvSeekTarget expected, actual, unprimed;
+		index.Seek(time, expected);
+		fresh.Seek(time, unprimed);
+		CHECK(restored.Seek(time, actual));
+		CHECK(actual.offset == expected.offset && actual.keyframeGranule == expected.keyframeGranule);
+	}
+	fresh.GetDuration();
+	CHECK(restored.GetReadCount() - restoredBefore < fresh.GetReadCount() - freshBefore);
+
+	// Truncated or foreign state is refused.
+	OgvSeekIndex other;
+	CHECK(other.Open(file.ReadFunc(), file.GetLength()));
+	CHECK(!other.Deserialize(state.data(), 12));
+	state[0] = 'X';
+	CHECK(!other.Deserialize(state.data(), state.size()));
+}
+
+int main()
+{
+	TestOpen();
+	TestSeek();
+	TestSeekToSplitKeyframe();
+	TestSeeksGetCheaper();
+	TestSeekWithSkeletonIndex();
+	TestSerializeRoundTrip();
+	return TEST_RESULT();
+}
@@ -0,0 +1,65 @@
+#include "PlaneUpload.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace OgvRT;
+
+typedef std::chrono::steady_clock Clock;
+
+static const int Iterations = 200;
+
+// Row-by-row memcpy, what UploadPlane does below the streaming threshold.
+static void CopyRows(const uint8_t *src, size_t srcStride, const PlaneRect &crop, uint8_t *dest, size_t destPitch)
+{
+	const uint8_t *srcRow = src + crop.y * srcStride + crop.x;
+	for (int row = 0; row < crop.height; row++)
+	{
+		memcpy(dest + row * destPitch, srcRow + row * srcStride, crop.width);
+	}
+}
+
+template<typename Upload>
+static double GigabytesPerSecond(Upload upload, const std::vector<uint8_t> &src, size_t srcStride, const PlaneRect &crop, std::vector<uint8_t> &dest, size_t destPitch)
+{
+	upload(src.data(), srcStride, crop, dest.data(), destPitch);
+
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < Iterations; i++)
+	{
+		upload(src.data(), srcStride, crop, dest.data(), destPitch);
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	return static_cast<double>(crop.width) * crop.height * Iterations / seconds / 1e9;
+}
+
+int main()
+{
+	struct Case
+	{
+		const char *name;
+		size_t srcStride;
+		int width;
+		int height;
+		size_t destPitch;
+	};
+	const Case cases[] = {
+		{ "360p luma", 640 + 32, 640, 360, 640 },
+		{ "1080p luma", 1920 + 64, 1920, 1080, 2048 },
+		{ "4K luma", 3840 + 64, 3840, 2160, 3840 },
+	};
+
+	for (const Case &c : cases)
+	{
+		std::vector<uint8_t> src(c.srcStride * (c.height + 16), 0x80);
+		std::vector<uint8_t> dest(c.destPitch * c.height);
+		PlaneRect crop(16, 8, c.width, c.height);
+
+		double rows = GigabytesPerSecond(CopyRows, src, c.srcStride, crop, dest, c.destPitch);
+		double upload = GigabytesPerSecond(UploadPlane, src, c.srcStride, crop, dest, c.destPitch);
+		printf("%-12s memcpy rows %6.2f GB/s   UploadPlane %6.2f GB/s\n", c.name, rows, upload);
+	}
+	return 0;
+}
@@ -0,0 +1,84 @@
+#include "PlaneUpload.h"
+#include "TestHarness.h"
+
+#include <vector>
+
+using namespace OgvRT;
+
+static const uint8_t Untouched = 0xcd;
+
+static uint8_t SourceByte(size_t x, size_t y)
+{
+	return static_cast<uint8_t>(x * 7 + y * 13 + 1);
+}
+
+// Uploads crop out of a patterned plane into a destination with destPitch
+// and destOffset bytes of leading slack, then checks every byte: the crop
+// where it belongs, and nothing written outside it.
+static bool CheckUpload(size_t srcStride, size_t srcHeight, const PlaneRect &crop, size_t destPitch, size_t destOffset)
+{
+	std::vector<uint8_t> src(srcStride * srcHeight);
+	for (size_t y = 0; y < srcHeight; y++)
+	{
+		for (size_t x = 0; x < srcStride; x++)
+		{
+			src[y * srcStride + x] = SourceByte(x, y);
+		}
+	}
+
+	std::vector<uint8_t> dest(destOffset + destPitch * crop.height + 64, Untouched);
+	UploadPlane(src.data(), srcStride, crop, dest.data() + destOffset, destPitch);
+
+	for (size_t i = 0; i < dest.size(); i++)
+	{
+		bool inside = false;
+		size_t x = 0;
+		size_t y = 0;
+		if (i >= destOffset)
+		{
+			x = (i - destOffset) % destPitch;
+			y = (i - destOffset) / destPitch;
+			inside = y < static_cast<size_t>(crop.height) && x < static_cast<size_t>(crop.width);
+		}
+		uint8_t expected = inside ? SourceByte(crop.x + x, crop.y + y) : Untouched;
+		if (dest[i] != expected)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void TestSmallPlanes()
+{
+	// Tightly packed, which takes the single memcpy.
+	CHECK(CheckUpload(64, 16, PlaneRect(0, 0, 64, 16), 64, 0));
+	// Decoder padding on the source, a wider driver pitch on the destination.
+	CHECK(CheckUpload(96, 40, PlaneRect(16, 16, 50, 20), 128, 0));
+	CHECK(CheckUpload(33, 9, PlaneRect(1, 2, 31, 7), 31, 0));
+	CHECK(CheckUpload(33, 9, PlaneRect(0, 0, 1, 1), 1, 3));
+}
+
+// Big enough for the vector copy, with destinations that start off a
+// 16-byte boundary and widths that leave a ragged tail.
+static void TestLargePlanes()
+{
+	CHECK(CheckUpload(1920 + 64, 1088, PlaneRect(32, 4, 1920, 1080), 1920, 0));
+	CHECK(CheckUpload(1920 + 64, 1088, PlaneRect(32, 4, 1920, 1080), 2048, 0));
+	CHECK(CheckUpload(1024, 600, PlaneRect(3, 5, 1001, 590), 1040, 7));
+	CHECK(CheckUpload(1024, 600, PlaneRect(0, 0, 1024, 600), 1024, 9));
+}
+
+static void TestEmptyCrop()
+{
+	CHECK(CheckUpload(64, 16, PlaneRect(0, 0, 0, 16), 64, 0));
+	CHECK(CheckUpload(64, 16, PlaneRect(0, 0, 64, 0), 64, 0));
+}
+
+int main()
+{
+	TestSmallPlanes();
+	TestLargePlanes();
+	TestEmptyCrop();
+	return TEST_RESULT();
+}
@@ -0,0 +1,103 @@
+#include "StreamingInput.h"
+#include "TestHarness.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace OgvRT;
+
+static std::vector<uint8_t> MakeInput(size_t length)
+{
+	std::vector<uint8_t> input(length);
+	srand(1);
+	for (auto &b : input)
+	{
+		b = static_cast<uint8_t>(rand());
+	}
+	return input;
+}
+
+// Writes the input from one thread in uneven pieces while another drains
+// it, and checks the bytes come out the same and in order.
+static void TestStreamsByteIdentical(size_t chunkSize, size_t readAheadBytes)
+{
+	std::vector<uint8_t> input = MakeInput(3 * 1024 * 1024 + 123);
+	StreamingInput streaming(chunkSize, readAheadBytes);
+
+	std::thread writer([&] {
+		size_t offset = 0;
+		size_t piece = 1;
+		while (offset < input.size())
+		{
+			size_t len = std::min(piece, input.size() - offset);
+			if (!streaming.Write(input.data() + offset, len))
+			{
+				break;
+			}
+			offset += len;
+			piece = piece * 3 % 200003 + 1;
+		}
+		streaming.EndOfStream();
+	});
+
+	std::vector<uint8_t> output;
+	size_t maxBuffered = 0;
+	while (!streaming.IsComplete())
+	{
+		maxBuffered = std::max(maxBuffered, streaming.GetBufferedBytes());
+		streaming.Drain(100 * 1024, [&](std::vector<uint8_t> &chunk) {
+			CHECK(chunk.size() <= streaming.GetChunkSize());
+			output.insert(output.end(), chunk.begin(), chunk.end());
+		});
+		std::this_thread::yield();
+	}
+	writer.join();
+
+	CHECK(output == input);
+	CHECK(streaming.GetTotalBytesReceived() == input.size());
+	CHECK(maxBuffered <= streaming.GetReadAheadBytes());
+}
+
+static void TestDefaultsAreClamped()
+{
+	StreamingInput streaming(0, 0);
+	CHECK(streaming.GetChunkSize() == StreamingInput::DefaultChunkSize);
+	CHECK(streaming.GetReadAheadBytes() >= streaming.GetChunkSize());
+
+	// Would wait forever with a window smaller than a chunk.
+	std::vector<uint8_t> input = MakeInput(StreamingInput::DefaultChunkSize);
+	CHECK(streaming.Write(input.data(), input.size()));
+}
+
+static void TestCancelUnblocksWriter()
+{
+	StreamingInput streaming(1024, 4096);
+	std::vector<uint8_t> input = MakeInput(64 * 1024);
+
+	bool result = true;
+	std::thread writer([&] {
+		result = streaming.Write(input.data(), input.size());
+	});
+	while (streaming.GetBufferedBytes() < 4096)
+	{
+		std::this_thread::yield();
+	}
+	streaming.Cancel();
+	writer.join();
+
+	CHECK(!result);
+	CHECK(streaming.IsCancelled());
+	CHECK(streaming.IsComplete());
+}
+
+int main()
+{
+	TestStreamsByteIdentical(StreamingInput::DefaultChunkSize, StreamingInput::DefaultReadAheadBytes);
+	TestStreamsByteIdentical(1000, 1000);
+	TestStreamsByteIdentical(4096, 64 * 1024);
+	TestDefaultsAreClamped();
+	TestCancelUnblocksWriter();
+	return TEST_RESULT();
+}
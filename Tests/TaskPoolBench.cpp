@@ -0,0 +1,93 @@
+#include "TaskPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace OgvRT;
+
+typedef std::chrono::steady_clock Clock;
+
+// Stand-in for decoding one packet: a fixed amount of arithmetic that the
+// compiler can't drop.
+static uint32_t Work(uint32_t seed, int rounds)
+{
+	uint32_t value = seed;
+	for (int i = 0; i < rounds; i++)
+	{
+		value = value * 1664525u + 1013904223u;
+		value ^= value >> 13;
+	}
+	return value;
+}
+
+// Two streams' worth of packets, decoded in order within each stream, as
+// Theora and Vorbis would be: heavy video packets, lighter but more
+// numerous audio ones.
+struct Streams
+{
+	static const int VideoPackets = 300;
+	static const int VideoRounds = 200000;
+	static const int AudioPackets = 430;
+	static const int AudioRounds = 60000;
+
+	uint32_t video;
+	uint32_t audio;
+
+	Streams() : video(1), audio(2) {}
+
+	void DecodeVideo()
+	{
+		for (int i = 0; i < VideoPackets; i++)
+		{
+			video = Work(video, VideoRounds);
+		}
+	}
+
+	void DecodeAudio()
+	{
+		for (int i = 0; i < AudioPackets; i++)
+		{
+			audio = Work(audio, AudioRounds);
+		}
+	}
+};
+
+static double Seconds(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main()
+{
+	Streams serialStreams;
+	Clock::time_point start = Clock::now();
+	serialStreams.DecodeVideo();
+	serialStreams.DecodeAudio();
+	double serial = Seconds(start);
+	printf("serial          %7.3f s\n", serial);
+
+	const unsigned workerCounts[] = { 1, 2, 3 };
+	for (unsigned workers : workerCounts)
+	{
+		TaskPool pool(workers);
+		Streams streams;
+
+		// Each stream is one task, so its packets stay in order; the two
+		// overlap, with the calling thread helping while it waits.
+		pool.ResetStats();
+		start = Clock::now();
+		TaskGroup group;
+		pool.Submit(group, [&streams] { streams.DecodeVideo(); });
+		pool.Submit(group, [&streams] { streams.DecodeAudio(); });
+		pool.Wait(group);
+		double parallel = Seconds(start);
+
+		TaskPoolStats stats = pool.GetStats();
+		bool same = streams.video == serialStreams.video && streams.audio == serialStreams.audio;
+		printf("%u worker(s)     %7.3f s  %.2fx  utilization %3.0f%%%s\n",
+			workers, parallel, serial / parallel, stats.Utilization() * 100.0, same ? "" : "  MISMATCH");
+	}
+	printf("%u hardware thread(s)\n", std::thread::hardware_concurrency());
+	return 0;
+}
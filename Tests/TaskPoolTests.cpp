@@ -0,0 +1,97 @@
+#include "TaskPool.h"
+#include "TestHarness.h"
+
+#include <atomic>
+#include <vector>
+
+using namespace OgvRT;
+
+static void TestWorkerCount()
+{
+	TaskPool pool(3);
+	CHECK(pool.GetWorkerCount() == 3);
+	CHECK(TaskPool::Shared().GetWorkerCount() >= 1);
+	CHECK(&TaskPool::Shared() == &TaskPool::Shared());
+}
+
+static void TestParallelForRunsEachIndexOnce()
+{
+	TaskPool pool(4);
+	std::vector<std::atomic<int>> hits(1000);
+	for (auto &hit : hits)
+	{
+		hit = 0;
+	}
+	pool.ParallelFor(static_cast<int>(hits.size()), [&hits](int i) { hits[i]++; });
+
+	bool once = true;
+	for (auto &hit : hits)
+	{
+		once = once && hit == 1;
+	}
+	CHECK(once);
+
+	// Nothing to do is fine too.
+	pool.ParallelFor(0, [](int) {});
+}
+
+static void TestGroupWait()
+{
+	TaskPool pool(2);
+	TaskGroup group;
+	std::atomic<int> done(0);
+	for (int i = 0; i < 100; i++)
+	{
+		pool.Submit(group, [&done] { done++; });
+	}
+	pool.Wait(group);
+	CHECK(done == 100);
+}
+
+// Tasks waiting on tasks of their own, deeper than there are workers,
+// mustn't deadlock: waiters run queued work meanwhile.
+static void TestNestedWaits()
+{
+	TaskPool pool(2);
+	std::atomic<int> leaves(0);
+	pool.ParallelFor(8, [&pool, &leaves](int) {
+		pool.ParallelFor(8, [&pool, &leaves](int) {
+			pool.ParallelFor(4, [&leaves](int) { leaves++; });
+		});
+	});
+	CHECK(leaves == 8 * 8 * 4);
+}
+
+static void TestStats()
+{
+	TaskPool pool(2);
+	pool.ResetStats();
+	pool.ParallelFor(50, [](int) {
+		volatile int spin = 0;
+		for (int i = 0; i < 10000; i++)
+		{
+			spin += i;
+		}
+	});
+
+	TaskPoolStats stats = pool.GetStats();
+	CHECK(stats.workers == 2);
+	// Index 0 runs on the calling thread outside any task.
+	CHECK(stats.tasksRun == 49);
+	CHECK(stats.tasksStolen <= stats.tasksRun);
+	CHECK(stats.wallSeconds > 0.0);
+	CHECK(stats.Utilization() >= 0.0 && stats.Utilization() <= 1.0);
+
+	pool.ResetStats();
+	CHECK(pool.GetStats().tasksRun == 0);
+}
+
+int main()
+{
+	TestWorkerCount();
+	TestParallelForRunsEachIndexOnce();
+	TestGroupWait();
+	TestNestedWaits();
+	TestStats();
+	return TEST_RESULT();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdio>
+
+// Just enough to write the tests with: a failed check is reported and the
+// run carries on, and TEST_RESULT gives the exit code for CTest.
+static int s_testFailures = 0;
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			s_testFailures++; \
+		} \
+	} while (0)
+
+#define TEST_RESULT() \
+	(s_testFailures == 0 ? (printf("all checks passed\n"), 0) : (fprintf(stderr, "%d check(s) failed\n", s_testFailures), 1))
@@ -0,0 +1,66 @@
+#include "YCbCrConverter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace OgvRT;
+
+typedef std::chrono::steady_clock Clock;
+
+static const int Iterations = 50;
+
+static double MegapixelsPerSecond(const YCbCrConverter &converter, const VideoFrame &frame, std::vector<uint8_t> &bgra)
+{
+	size_t pitch = frame.picture.width * 4;
+	converter.Convert(frame, bgra.data(), pitch);
+
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < Iterations; i++)
+	{
+		converter.Convert(frame, bgra.data(), pitch);
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	return static_cast<double>(frame.picture.width) * frame.picture.height * Iterations / seconds / 1e6;
+}
+
+int main()
+{
+	const int width = 1920;
+	const int height = 1080;
+	const YCbCrKernel kernels[] = { YCbCrKernelScalar, YCbCrKernelSSE2, YCbCrKernelAVX2, YCbCrKernelNEON };
+	const char *layouts[] = { "4:4:4", "4:2:2", "4:2:0" };
+
+	std::vector<uint8_t> y(width * height, 0x60), cb(width * height, 0x70), cr(width * height, 0x90);
+	std::vector<uint8_t> bgra(width * height * 4);
+	unsigned threads = YCbCrConverter().GetThreadCount();
+
+	printf("1080p, megapixels per second; %u thread(s) in the parallel column\n", threads);
+	for (int layout = 0; layout < 3; layout++)
+	{
+		VideoFrame frame;
+		frame.hdec = layout > 0 ? 1 : 0;
+		frame.vdec = layout > 1 ? 1 : 0;
+		frame.Y.bytes = y.data();
+		frame.Y.stride = width;
+		frame.Y.height = height;
+		frame.Cb.bytes = cb.data();
+		frame.Cb.stride = width >> frame.hdec;
+		frame.Cb.height = height >> frame.vdec;
+		frame.Cr = frame.Cb;
+		frame.Cr.bytes = cr.data();
+		frame.picture = PlaneRect(0, 0, width, height);
+
+		for (YCbCrKernel kernel : kernels)
+		{
+			if (!YCbCrConverter::IsKernelSupported(kernel))
+			{
+				continue;
+			}
+			double serial = MegapixelsPerSecond(YCbCrConverter(kernel, 1), frame, bgra);
+			double parallel = MegapixelsPerSecond(YCbCrConverter(kernel, 0), frame, bgra);
+			printf("%s %-7s %8.1f serial %8.1f parallel\n", layouts[layout], YCbCrConverter::GetKernelName(kernel), serial, parallel);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,172 @@
+#include "YCbCrConverter.h"
+#include "TestHarness.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace OgvRT;
+
+static const YCbCrKernel Kernels[] = { YCbCrKernelScalar, YCbCrKernelSSE2, YCbCrKernelAVX2, YCbCrKernelNEON };
+
+// A frame with its own plane storage, padded on every side like the
+// decoder's, filled with noise.
+struct TestFrame
+{
+	std::vector<uint8_t> y, cb, cr;
+	VideoFrame frame;
+
+	TestFrame(int width, int height, int hdec, int vdec, const PlaneRect &picture)
+	{
+		int lumaStride = width + 32;
+		int lumaHeight = height + 32;
+		int chromaStride = lumaStride >> hdec;
+		int chromaHeight = lumaHeight >> vdec;
+		y.resize(lumaStride * lumaHeight);
+		cb.resize(chromaStride * chromaHeight);
+		cr.resize(chromaStride * chromaHeight);
+
+		srand(width * 31 + height);
+		for (auto &byte : y) byte = static_cast<uint8_t>(rand());
+		for (auto &byte : cb) byte = static_cast<uint8_t>(rand());
+		for (auto &byte : cr) byte = static_cast<uint8_t>(rand());
+
+		frame.Y.bytes = y.data();
+		frame.Y.stride = lumaStride;
+		frame.Y.height = lumaHeight;
+		frame.Cb.bytes = cb.data();
+		frame.Cb.stride = chromaStride;
+		frame.Cb.height = chromaHeight;
+		frame.Cr.bytes = cr.data();
+		frame.Cr.stride = chromaStride;
+		frame.Cr.height = chromaHeight;
+		frame.picture = picture;
+		frame.hdec = hdec;
+		frame.vdec = vdec;
+	}
+};
+
+static std::vector<uint8_t> Convert(const YCbCrConverter &converter, const VideoFrame &frame)
+{
+	size_t pitch = frame.picture.width * 4 + 12;
+	std::vector<uint8_t> bgra(pitch * frame.picture.height);
+	converter.Convert(frame, bgra.data(), pitch);
+	return bgra;
+}
+
+// Every kernel, on one thread or many, must give the scalar kernel's output
+// exactly, including for odd widths and pictures that start mid chroma pair.
+static void TestKernelsMatchScalar()
+{
+	struct Case
+	{
+		int hdec, vdec;
+		PlaneRect picture;
+	};
+	const Case cases[] = {
+		{ 1, 1, PlaneRect(0, 0, 320, 240) },
+		{ 1, 1, PlaneRect(1, 3, 317, 233) },
+		{ 1, 0, PlaneRect(8, 2, 301, 200) },
+		{ 0, 0, PlaneRect(5, 5, 257, 130) },
+		{ 1, 1, PlaneRect(0, 0, 7, 5) },
+	};
+
+	YCbCrConverter reference(YCbCrKernelScalar, 1);
+	for (const Case &c : cases)
+	{
+		TestFrame test(c.picture.x + c.picture.width, c.picture.y + c.picture.height, c.hdec, c.vdec, c.picture);
+		std::vector<uint8_t> expected = Convert(reference, test.frame);
+
+		for (YCbCrKernel kernel : Kernels)
+		{
+			if (!YCbCrConverter::IsKernelSupported(kernel))
+			{
+				continue;
+			}
+			CHECK(Convert(YCbCrConverter(kernel, 1), test.frame) == expected);
+			CHECK(Convert(YCbCrConverter(kernel, 4), test.frame) == expected);
+		}
+	}
+}
+
+// What SamplePixelShader.hlsl computes for one pixel, written to a UNORM target.
+static int ShaderChannel(double value)
+{
+	value = value < 0.0 ? 0.0 : (value > 1.0 ? 1.0 : value);
+	return static_cast<int>(floor(value * 255.0 + 0.5));
+}
+
+// Every Y, Cb, Cr combination against the shader's float maths.
+static void TestMatchesShader()
+{
+	// One Cr value per pass: Y across, Cb down.
+	TestFrame test(256, 256, 0, 0, PlaneRect(0, 0, 256, 256));
+	for (int y = 0; y < 256; y++)
+	{
+		for (int x = 0; x < 256; x++)
+		{
+			test.y[y * test.frame.Y.stride + x] = static_cast<uint8_t>(x);
+			test.cb[y * test.frame.Cb.stride + x] = static_cast<uint8_t>(y);
+		}
+	}
+
+	YCbCrConverter converter(YCbCrKernelAuto, 1);
+	int worst = 0;
+	for (int cr = 0; cr < 256; cr++)
+	{
+		for (int y = 0; y < 256; y++)
+		{
+			for (int x = 0; x < 256; x++)
+			{
+				test.cr[y * test.frame.Cr.stride + x] = static_cast<uint8_t>(cr);
+			}
+		}
+		std::vector<uint8_t> bgra = Convert(converter, test.frame);
+		size_t pitch = bgra.size() / 256;
+
+		for (int cb = 0; cb < 256; cb++)
+		{
+			for (int luma = 0; luma < 256; luma++)
+			{
+				double Y = luma / 255.0 * 1.1643828125;
+				double Cb = cb / 255.0;
+				double Cr = cr / 255.0;
+				int expected[3] = {
+					ShaderChannel(Y + 2.017234375 * Cb - 1.081390625),
+					ShaderChannel(Y - 0.39176171875 * Cb - 0.81296875 * Cr + 0.52959375),
+					ShaderChannel(Y + 1.59602734375 * Cr - 0.87078515625),
+				};
+				const uint8_t *pixel = &bgra[cb * pitch + luma * 4];
+				for (int channel = 0; channel < 3; channel++)
+				{
+					int error = abs(pixel[channel] - expected[channel]);
+					worst = error > worst ? error : worst;
+				}
+				CHECK(pixel[3] == 255);
+			}
+		}
+	}
+	CHECK(worst <= 1);
+}
+
+static void TestAutoPicksSupportedKernel()
+{
+	YCbCrConverter converter;
+	CHECK(converter.GetKernel() != YCbCrKernelAuto);
+	CHECK(YCbCrConverter::IsKernelSupported(converter.GetKernel()));
+	CHECK(converter.GetThreadCount() >= 1);
+
+	// An unsupported request falls back rather than failing.
+	for (YCbCrKernel kernel : Kernels)
+	{
+		CHECK(YCbCrConverter::IsKernelSupported(YCbCrConverter(kernel).GetKernel()));
+	}
+}
+
+int main()
+{
+	TestKernelsMatchScalar();
+	TestMatchesShader();
+	TestAutoPicksSupportedKernel();
+	return TEST_RESULT();
+}